@@ -0,0 +1,102 @@
+#include "WorldGen.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace game {
+	//hash of a lattice point to [0, 1)
+	static float latticeValue(int32_t x, int32_t z, uint32_t seed) {
+		uint32_t h = static_cast<uint32_t>(x) * 0x8DA6B343u ^ static_cast<uint32_t>(z) * 0xD8163841u ^ seed * 0xCB1AB31Fu;
+		h ^= h >> 13;
+		h *= 0x5BD1E995u;
+		h ^= h >> 15;
+		return (h & 0xFFFFFF) / static_cast<float>(0x1000000);
+	}
+
+	//smoothstepped between the four lattice points around (x, z)
+	static float valueNoise(float x, float z, uint32_t seed) {
+		const float fx = std::floor(x), fz = std::floor(z);
+		const int32_t ix = static_cast<int32_t>(fx), iz = static_cast<int32_t>(fz);
+		float tx = x - fx, tz = z - fz;
+		tx = tx * tx * (3.f - 2.f * tx);
+		tz = tz * tz * (3.f - 2.f * tz);
+		const float top = glm::mix(latticeValue(ix, iz, seed), latticeValue(ix + 1, iz, seed), tx);
+		const float bottom = glm::mix(latticeValue(ix, iz + 1, seed), latticeValue(ix + 1, iz + 1, seed), tx);
+		return glm::mix(top, bottom, tz);
+	}
+
+	Terrain::Terrain(const TerrainSettings& terrainSettings) : settings{ terrainSettings } {
+		settings.samples = std::max(settings.samples, 2u);
+		settings.octaves = std::max(settings.octaves, 1u);
+		const uint32_t n = settings.samples;
+		heights.resize(static_cast<size_t>(n) * n);
+
+		//the octave heights add up to 1 so settings.height is the full range
+		float total = 0.f, amplitude = 1.f;
+		for (uint32_t o = 0; o < settings.octaves; o++, amplitude *= settings.persistence) total += amplitude;
+		for (uint32_t z = 0; z < n; z++) {
+			for (uint32_t x = 0; x < n; x++) {
+				float sum = 0.f, frequency = settings.frequency;
+				amplitude = 1.f;
+				for (uint32_t o = 0; o < settings.octaves; o++) {
+					sum += valueNoise(x * frequency, z * frequency, settings.seed + o) * amplitude;
+					frequency *= 2.f;
+					amplitude *= settings.persistence;
+				}
+				heights[z * n + x] = -sum / total * settings.height;
+			}
+		}
+	}
+
+	float Terrain::heightAt(float x, float z) const {
+		const uint32_t n = settings.samples;
+		const float half = 0.5f * settings.cellSize * (n - 1);
+		const float gx = glm::clamp((x + half) / settings.cellSize, 0.f, static_cast<float>(n - 1));
+		const float gz = glm::clamp((z + half) / settings.cellSize, 0.f, static_cast<float>(n - 1));
+		const uint32_t cx = std::min(static_cast<uint32_t>(gx), n - 2), cz = std::min(static_cast<uint32_t>(gz), n - 2);
+		const float tx = gx - cx, tz = gz - cz;
+		auto h = [&](uint32_t sx, uint32_t sz) { return heights[sz * n + sx]; };
+		//the same diagonal split as the heightfield's triangles
+		if (tx + tz <= 1.f) return h(cx, cz) + (h(cx + 1, cz) - h(cx, cz)) * tx + (h(cx, cz + 1) - h(cx, cz)) * tz;
+		return h(cx + 1, cz + 1) + (h(cx, cz + 1) - h(cx + 1, cz + 1)) * (1.f - tx) + (h(cx + 1, cz) - h(cx + 1, cz + 1)) * (1.f - tz);
+	}
+
+	mve::BodyHandle Terrain::addToPhysics(mve::PhysicsClass& physics, mve::MveGameObject& obj) const {
+		mve::BodyHandle handle = physics.addRigidBody(obj, 0.f);
+		physics.addHeightFieldCollider(handle, physics.createHeightField(heights, settings.samples, settings.samples, settings.cellSize));
+		return handle;
+	}
+
+	mve::MveModel::Builder Terrain::buildModel() const {
+		const uint32_t n = settings.samples;
+		const float half = 0.5f * settings.cellSize * (n - 1);
+		auto h = [&](int32_t x, int32_t z) {
+			return heights[std::clamp(z, 0, static_cast<int32_t>(n) - 1) * n + std::clamp(x, 0, static_cast<int32_t>(n) - 1)];
+		};
+
+		mve::MveModel::Builder builder;
+		builder.vertices.reserve(static_cast<size_t>(n) * n);
+		for (uint32_t z = 0; z < n; z++) {
+			for (uint32_t x = 0; x < n; x++) {
+				mve::MveModel::Vertex v{};
+				v.position = { x * settings.cellSize - half, h(x, z), z * settings.cellSize - half };
+				//central differences, pointing up (-y)
+				const float dx = (h(x + 1, z) - h(x - 1, z)) / (2.f * settings.cellSize);
+				const float dz = (h(x, z + 1) - h(x, z - 1)) / (2.f * settings.cellSize);
+				v.normal = glm::normalize(glm::vec3{ dx, -1.f, dz });
+				const float t = settings.height > 0.f ? glm::clamp(-v.position.y / settings.height, 0.f, 1.f) : 0.f;
+				v.color = glm::mix(glm::vec3{ .25f, .5f, .2f }, glm::vec3{ .5f, .45f, .4f }, t);
+				v.uv = { x / static_cast<float>(n - 1), z / static_cast<float>(n - 1) };
+				builder.vertices.push_back(v);
+			}
+		}
+		builder.indices.reserve(static_cast<size_t>(n - 1) * (n - 1) * 6);
+		for (uint32_t z = 0; z + 1 < n; z++) {
+			for (uint32_t x = 0; x + 1 < n; x++) {
+				const uint32_t a = z * n + x, b = a + 1, c = a + n, d = c + 1;
+				builder.indices.insert(builder.indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		return builder;
+	}
+}
@@ -1,6 +1,41 @@
 #pragma once
 
+#include "mve_model.h"
+#include "mve_physics.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace game {
+	struct TerrainSettings {
+		uint32_t samples = 129; //per side, the terrain is (samples - 1) * cellSize wide
+		float cellSize = 0.5f;
+		float height = 3.f; //from the deepest valley to the highest peak at most
+		float frequency = 0.04f; //of the broadest octave, in waves per cell
+		uint32_t octaves = 5; //each one twice the frequency and persistence times the height of the last
+		float persistence = 0.5f;
+		uint32_t seed = 1;
+	};
+
+	//fractal value noise terrain. the same grid of heights is used for the heightfield collider and the render model, so what
+	//you see is what bodies land on. heights are y values, hills rise towards -y since +y is down
+	class Terrain {
+	public:
+		explicit Terrain(const TerrainSettings& settings = {});
+
+		const TerrainSettings& getSettings() const { return settings; }
+		//heights[z * samples + x]
+		const std::vector<float>& getHeights() const { return heights; }
+		//interpolated between the samples, x and z centered on the terrain like the collider
+		float heightAt(float x, float z) const;
+
+		//makes the game object's body static and gives it the terrain as a heightfield collider
+		mve::BodyHandle addToPhysics(mve::PhysicsClass& physics, mve::MveGameObject& obj) const;
+		//triangles split the same way as the heightfield's cells, colored from grass in the valleys to rock on the peaks
+		mve::MveModel::Builder buildModel() const;
 
-}
\ No newline at end of file
+	private:
+		TerrainSettings settings;
+		std::vector<float> heights;
+	};
+}
@@ -0,0 +1,30 @@
+//shared helpers for the headless physics benchmarks in physics_bench
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace mve {
+	namespace bench {
+		class Timer {
+		public:
+			Timer() : start{ std::chrono::high_resolution_clock::now() } {}
+			double elapsedMs() const {
+				return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			}
+
+		private:
+			std::chrono::high_resolution_clock::time_point start;
+		};
+
+		//keeps the optimizer from throwing away work whose result is never read
+		inline volatile uint64_t sink = 0;
+
+		//each benchmark takes the arguments after its name and returns the process exit code
+		int runSat(int argc, char** argv);
+		int runSolver(int argc, char** argv);
+		int runScenes(int argc, char** argv);
+		int runReorder(int argc, char** argv);
+	}
+}
@@ -0,0 +1,77 @@
+//step time with and without the morton reordering of the body store. the bodies are added in random order, the way a level
+//streams objects in, so neighbours in space start out scattered through memory. sleeping is off so every step touches everything
+
+#include "bench.h"
+#include "../mve_physics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace mve {
+	namespace bench {
+		static double timeReorder(PhysicsSettings settings, uint32_t bodyCount, int steps) {
+			PhysicsClass physics{ settings };
+
+			//ground, then 4 high stacks of 0.6 boxes with a sphere on top, on a square grid. +y is down
+			const uint32_t levels = 5;
+			const uint32_t stacks = (bodyCount + levels - 1) / levels;
+			const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(stacks))));
+			const float spacing = 0.8f;
+			const float extent = side * spacing;
+
+			std::vector<uint32_t> insertOrder(bodyCount);
+			for (uint32_t i = 0; i < bodyCount; i++) insertOrder[i] = i;
+			std::shuffle(insertOrder.begin(), insertOrder.end(), std::mt19937{ 7 });
+
+			int objId = 0;
+			physics.addRigidBody(objId, { extent * 0.5f, 1.f, extent * 0.5f }, 0.f);
+			physics.addBoxCollider(objId++, { extent * 0.5f + 1.f, 0.25f, extent * 0.5f + 1.f });
+			for (uint32_t i : insertOrder) {
+				uint32_t stack = i / levels, level = i % levels;
+				glm::vec3 position{ (stack % side) * spacing, 0.44f - level * 0.62f, (stack / side) * spacing };
+				physics.addRigidBody(objId, position);
+				if (level == levels - 1) physics.addSphereCollider(objId++, 0.3f);
+				else physics.addBoxCollider(objId++, { 0.3f, 0.3f, 0.3f });
+			}
+
+			//the first check sorts when reordering is on, the timed steps run on whatever order that left
+			const float dt = 1.f / 60.f;
+			for (int s = 0; s < 60; s++) physics.step(dt);
+
+			Timer timer;
+			for (int s = 0; s < steps; s++) physics.step(dt);
+			double ms = timer.elapsedMs() / steps;
+			sink = sink + static_cast<uint64_t>(physics.getBody(1).position.y * 1000.f);
+			return ms;
+		}
+
+		int runReorder(int argc, char** argv) {
+			uint32_t bodyCount = argc > 0 ? static_cast<uint32_t>(std::atoi(argv[0])) : 20000;
+			int steps = argc > 1 ? std::atoi(argv[1]) : 120;
+			uint32_t threads = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 1;
+
+			PhysicsSettings settings;
+			settings.gravity = { 0.f, 9.8f, 0.f };
+			settings.sleepTime = 1e30f;
+			settings.workerThreads = std::max(threads, 1u);
+			settings.solver = threads > 1 ? SolverType::GraphColored : SolverType::Sequential;
+
+			std::cout << bodyCount << " bodies added in random order, " << steps << " steps, " << settings.workerThreads << " threads\n";
+			for (BroadphaseType broadphase : { BroadphaseType::SortedGrid, BroadphaseType::AABBTree }) {
+				settings.broadphase = broadphase;
+				const char* name = broadphase == BroadphaseType::AABBTree ? "tree" : "grid";
+
+				settings.reorderInterval = 0;
+				double before = timeReorder(settings, bodyCount, steps);
+				settings.reorderInterval = PhysicsSettings{}.reorderInterval;
+				double after = timeReorder(settings, bodyCount, steps);
+				std::cout << name << "  insertion order " << before << " ms/step  morton order " << after << " ms/step  speedup " << before / after << "x\n";
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,80 @@
+//compares PhysicsClass::testOBBvsOBB (one pair per call) against testOBBvsOBBBatch on the same random pairs
+
+#include "bench.h"
+#include "../mve_physics.h"
+#include "../mve_simd.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace mve {
+	namespace bench {
+		static OBB randomOBB(std::mt19937& rng, float spread) {
+			std::uniform_real_distribution<float> position(-spread, spread);
+			std::uniform_real_distribution<float> size(0.1f, 1.f);
+			std::normal_distribution<float> gaussian(0.f, 1.f);
+
+			//normalized gaussian 4d vector is a uniformly random rotation
+			glm::quat rotation = glm::normalize(glm::quat{ gaussian(rng), gaussian(rng), gaussian(rng), gaussian(rng) });
+			glm::mat3 rot = glm::mat3_cast(rotation);
+
+			OBB obb;
+			obb.center = { position(rng), position(rng), position(rng) };
+			obb.halfSize = { size(rng), size(rng), size(rng) };
+			obb.axis[0] = rot[0];
+			obb.axis[1] = rot[1];
+			obb.axis[2] = rot[2];
+			return obb;
+		}
+
+		int runSat(int argc, char** argv) {
+			uint32_t pairCount = argc > 0 ? static_cast<uint32_t>(std::atoi(argv[0])) : 100000;
+			int repeats = argc > 1 ? std::atoi(argv[1]) : 20;
+
+			//a spread of 1.5 puts about a quarter of the pairs in contact, similar to what makes it through the broadphase
+			std::mt19937 rng{ 1234 };
+			std::vector<OBB> a(pairCount), b(pairCount);
+			for (uint32_t i = 0; i < pairCount; i++) {
+				a[i] = randomOBB(rng, 1.5f);
+				b[i] = randomOBB(rng, 1.5f);
+			}
+			std::vector<SATResult> scalar(pairCount), batched(pairCount);
+
+			double bestScalar = 1e30, bestBatched = 1e30;
+			for (int r = 0; r < repeats; r++) {
+				Timer timer;
+				for (uint32_t i = 0; i < pairCount; i++) scalar[i] = PhysicsClass::testOBBvsOBB(a[i], b[i]);
+				bestScalar = std::min(bestScalar, timer.elapsedMs());
+
+				Timer batchTimer;
+				PhysicsClass::testOBBvsOBBBatch(a.data(), b.data(), pairCount, batched.data());
+				bestBatched = std::min(bestBatched, batchTimer.elapsedMs());
+				sink = sink + scalar[r % pairCount].hit + batched[r % pairCount].hit;
+			}
+
+			//both paths should agree on every hit. the axis can differ when two axes tie within rounding
+			uint32_t hits = 0, hitMismatch = 0, axisMismatch = 0;
+			float maxPenetrationError = 0.f;
+			for (uint32_t i = 0; i < pairCount; i++) {
+				if (scalar[i].hit) hits++;
+				if (scalar[i].hit != batched[i].hit) { hitMismatch++; continue; }
+				if (!scalar[i].hit) continue;
+				if (scalar[i].axis != batched[i].axis) axisMismatch++;
+				else maxPenetrationError = std::max(maxPenetrationError, std::abs(scalar[i].penetration - batched[i].penetration));
+			}
+
+			std::cout << "pairs " << pairCount << ", hits " << hits << ", lanes " << simd::FloatN::width << "\n";
+			std::cout << "scalar  " << bestScalar * 1e6 / pairCount << " ns/pair\n";
+			std::cout << "batched " << bestBatched * 1e6 / pairCount << " ns/pair (" << bestScalar / bestBatched << "x)\n";
+			std::cout << "hit mismatches " << hitMismatch << ", axis mismatches " << axisMismatch
+				<< ", max penetration error " << maxPenetrationError << "\n";
+			return hitMismatch == 0 ? 0 : 1;
+		}
+	}
+}
@@ -0,0 +1,251 @@
+//stress scenes built straight on PhysicsClass, printed as JSON so runs from different builds can be diffed or plotted.
+//every scene settles for a while first, then the timed steps are averaged per phase from PhysicsClass::getStats
+
+#include "bench.h"
+#include "../mve_physics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace mve {
+	namespace bench {
+		struct Scene {
+			const char* name;
+			const char* description;
+			bool keepAwake; //sleeping off, for scenes that would otherwise settle and go to sleep during the warmup
+			//adds the bodies, returns a hook called before every step (warmup and timed) or nullptr
+			std::function<void(PhysicsClass&, int)> (*build)(PhysicsClass&);
+		};
+
+		//+y is down, the ground's top face is at y = 0.75
+		static void addGround(PhysicsClass& physics, int& objId, float halfSize) {
+			physics.addRigidBody(objId, { 0.f, 1.f, 0.f }, 0.f);
+			physics.addBoxCollider(objId++, { halfSize, 0.25f, halfSize });
+		}
+
+		//square pyramid of 0.6 boxes, 12 on a side at the bottom
+		static std::function<void(PhysicsClass&, int)> buildPyramid(PhysicsClass& physics) {
+			int objId = 0;
+			addGround(physics, objId, 20.f);
+			const int base = 12;
+			for (int level = 0; level < base; level++) {
+				const int side = base - level;
+				const float offset = (side - 1) * 0.3f;
+				for (int x = 0; x < side; x++) {
+					for (int z = 0; z < side; z++) {
+						physics.addRigidBody(objId, { x * 0.6f - offset, 0.45f - level * 0.6f, z * 0.6f - offset });
+						physics.addBoxCollider(objId++, { 0.3f, 0.3f, 0.3f });
+					}
+				}
+			}
+			return nullptr;
+		}
+
+		//10k boxes and spheres dropped in a loose column, they land on each other and spread into a pile
+		static std::function<void(PhysicsClass&, int)> buildPile(PhysicsClass& physics) {
+			int objId = 0;
+			addGround(physics, objId, 60.f);
+			std::mt19937 rng{ 1 };
+			std::uniform_real_distribution<float> jitter{ -0.05f, 0.05f };
+			const int side = 20;
+			for (int i = 0; i < 10000; i++) {
+				int layer = i / (side * side), cell = i % (side * side);
+				glm::vec3 position{ (cell % side - side / 2) * 0.7f + jitter(rng), -layer * 0.7f, (cell / side - side / 2) * 0.7f + jitter(rng) };
+				physics.addRigidBody(objId, position);
+				if (i % 4 == 0) physics.addSphereCollider(objId++, 0.3f);
+				else physics.addBoxCollider(objId++, { 0.3f, 0.3f, 0.3f });
+			}
+			return nullptr;
+		}
+
+		//spheres spawned over a wide area at staggered heights so they keep landing through the whole run
+		static std::function<void(PhysicsClass&, int)> buildRain(PhysicsClass& physics) {
+			int objId = 0;
+			addGround(physics, objId, 40.f);
+			std::mt19937 rng{ 2 };
+			std::uniform_real_distribution<float> across{ -35.f, 35.f };
+			std::uniform_real_distribution<float> height{ 2.f, 150.f };
+			std::uniform_real_distribution<float> radius{ 0.15f, 0.4f };
+			for (int i = 0; i < 5000; i++) {
+				physics.addRigidBody(objId, { across(rng), -height(rng), across(rng) });
+				physics.addSphereCollider(objId++, radius(rng));
+			}
+			return nullptr;
+		}
+
+		//static buildings on a block grid with crates on the roofs and in the streets that fall asleep,
+		//and a few cars driving up and down the streets so some islands stay awake
+		static std::function<void(PhysicsClass&, int)> buildCity(PhysicsClass& physics) {
+			int objId = 0;
+			addGround(physics, objId, 100.f);
+			const int blocks = 16;
+			const float blockSize = 10.f;
+			std::mt19937 rng{ 3 };
+			std::uniform_real_distribution<float> storeys{ 2.f, 12.f };
+			std::uniform_real_distribution<float> spot{ -3.f, 3.f };
+
+			for (int bx = 0; bx < blocks; bx++) {
+				for (int bz = 0; bz < blocks; bz++) {
+					glm::vec3 center{ (bx - blocks / 2) * blockSize, 0.f, (bz - blocks / 2) * blockSize };
+					float halfHeight = storeys(rng);
+					physics.addRigidBody(objId, { center.x, 0.75f - halfHeight, center.z }, 0.f);
+					physics.addBoxCollider(objId++, { 3.5f, halfHeight, 3.5f });
+					for (int crate = 0; crate < 8; crate++) {
+						physics.addRigidBody(objId, { center.x + spot(rng), 0.5f - 2.f * halfHeight - 0.3f, center.z + spot(rng) });
+						physics.addBoxCollider(objId++, { 0.25f, 0.25f, 0.25f });
+					}
+					for (int crate = 0; crate < 4; crate++) {
+						physics.addRigidBody(objId, { center.x + 4.f, 0.45f, center.z + spot(rng) });
+						physics.addBoxCollider(objId++, { 0.3f, 0.3f, 0.3f });
+					}
+				}
+			}
+
+			const int firstCar = objId;
+			const int cars = 32;
+			for (int car = 0; car < cars; car++) {
+				physics.addRigidBody(objId, { (car - cars / 2) * blockSize + 5.5f, 0.35f, 0.f }, 4.f);
+				physics.addBoxCollider(objId++, { 0.9f, 0.4f, 2.f });
+			}
+			//5 m/s along the street, turning around every 300 steps
+			return [firstCar, cars](PhysicsClass& physics, int step) {
+				for (int car = 0; car < cars; car++) {
+					BodyHandle handle = physics.getHandle(firstCar + car);
+					glm::vec3 velocity = physics.getBody(handle).velocity;
+					velocity.z = ((car + step / 300) % 2) ? 5.f : -5.f;
+					physics.setSpeed(handle, velocity);
+				}
+			};
+		}
+
+		static const Scene scenes[] = {
+			{ "pyramid", "650 boxes in a square pyramid, sleeping off", true, buildPyramid },
+			{ "pile", "10k boxes and spheres dropped into a pile", false, buildPile },
+			{ "rain", "5k spheres falling over a wide area", false, buildRain },
+			{ "city", "static buildings, sleeping crates and a few driving cars", false, buildCity },
+		};
+
+		struct PhaseTotals {
+			double sum = 0.0, min = 1e30, max = 0.0;
+			void add(double ms) {
+				sum += ms;
+				min = std::min(min, ms);
+				max = std::max(max, ms);
+			}
+		};
+
+		static void writePhase(std::ostream& out, const char* name, const PhaseTotals& phase, int steps, bool last) {
+			out << "        \"" << name << "\": { \"avg\": " << phase.sum / steps << ", \"min\": " << phase.min << ", \"max\": " << phase.max << " }"
+				<< (last ? "\n" : ",\n");
+		}
+
+		static void runScene(const Scene& scene, PhysicsSettings settings, int warmup, int steps, bool last) {
+			if (scene.keepAwake) settings.sleepTime = 1e30f;
+			PhysicsClass physics{ settings };
+			std::function<void(PhysicsClass&, int)> hook = scene.build(physics);
+			const float dt = 1.f / 60.f;
+			for (int s = 0; s < warmup; s++) {
+				if (hook) hook(physics, s);
+				physics.step(dt);
+			}
+
+			PhaseTotals integrateForces, broadPhase, detectCollisions, resolveCollisions, integrate, step;
+			double rawPairs = 0.0, pairs = 0.0, filteredPairs = 0.0, satTests = 0.0, satHits = 0.0, gjkTests = 0.0, gjkHits = 0.0;
+			double manifolds = 0.0, contacts = 0.0, awake = 0.0;
+			Timer timer;
+			for (int s = 0; s < steps; s++) {
+				if (hook) hook(physics, warmup + s);
+				physics.step(dt);
+				const PhysicsStats& stats = physics.getStats();
+				integrateForces.add(stats.integrateForcesMs);
+				broadPhase.add(stats.broadPhaseMs);
+				detectCollisions.add(stats.detectCollisionsMs);
+				resolveCollisions.add(stats.resolveCollisionsMs);
+				integrate.add(stats.integrateMs);
+				step.add(stats.stepMs);
+				rawPairs += stats.rawPairs;
+				pairs += stats.pairs;
+				filteredPairs += stats.filteredPairs;
+				satTests += stats.satTests;
+				satHits += stats.satHits;
+				gjkTests += stats.gjkTests;
+				gjkHits += stats.gjkHits;
+				manifolds += stats.manifolds;
+				contacts += stats.contacts;
+				awake += stats.awakeBodies;
+			}
+			double total = timer.elapsedMs();
+			sink = sink + physics.getStats().contacts;
+
+			std::cout << "    {\n";
+			std::cout << "      \"name\": \"" << scene.name << "\",\n";
+			std::cout << "      \"description\": \"" << scene.description << "\",\n";
+			std::cout << "      \"bodies\": " << physics.bodyCount() << ",\n";
+			std::cout << "      \"warmupSteps\": " << warmup << ",\n";
+			std::cout << "      \"steps\": " << steps << ",\n";
+			std::cout << "      \"totalMs\": " << total << ",\n";
+			std::cout << "      \"phasesMs\": {\n";
+			writePhase(std::cout, "integrateForces", integrateForces, steps, false);
+			writePhase(std::cout, "broadPhase", broadPhase, steps, false);
+			writePhase(std::cout, "detectCollisions", detectCollisions, steps, false);
+			writePhase(std::cout, "resolveCollisions", resolveCollisions, steps, false);
+			writePhase(std::cout, "integrate", integrate, steps, false);
+			writePhase(std::cout, "step", step, steps, true);
+			std::cout << "      },\n";
+			std::cout << "      \"avgRawPairs\": " << rawPairs / steps << ",\n";
+			std::cout << "      \"avgPairs\": " << pairs / steps << ",\n";
+			std::cout << "      \"avgFilteredPairs\": " << filteredPairs / steps << ",\n";
+			std::cout << "      \"avgSatTests\": " << satTests / steps << ",\n";
+			std::cout << "      \"avgSatHits\": " << satHits / steps << ",\n";
+			std::cout << "      \"avgGjkTests\": " << gjkTests / steps << ",\n";
+			std::cout << "      \"avgGjkHits\": " << gjkHits / steps << ",\n";
+			std::cout << "      \"avgManifolds\": " << manifolds / steps << ",\n";
+			std::cout << "      \"avgContacts\": " << contacts / steps << ",\n";
+			std::cout << "      \"avgAwakeBodies\": " << awake / steps << "\n";
+			std::cout << "    }" << (last ? "\n" : ",\n");
+		}
+
+		int runScenes(int argc, char** argv) {
+			const char* only = argc > 0 ? argv[0] : "all";
+			int steps = argc > 1 ? std::atoi(argv[1]) : 300;
+			uint32_t threads = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 1;
+			bool tree = argc > 3 && std::strcmp(argv[3], "tree") == 0;
+			const int warmup = 60;
+			if (steps < 1) steps = 1;
+
+			std::vector<const Scene*> selected;
+			for (const Scene& scene : scenes) {
+				if (std::strcmp(only, "all") == 0 || std::strcmp(only, scene.name) == 0) selected.push_back(&scene);
+			}
+			if (selected.empty()) {
+				std::cerr << "unknown scene " << only << ", one of: all";
+				for (const Scene& scene : scenes) std::cerr << ", " << scene.name;
+				std::cerr << "\n";
+				return 1;
+			}
+
+			PhysicsSettings settings;
+			settings.gravity = { 0.f, 9.8f, 0.f };
+			settings.workerThreads = std::max(threads, 1u);
+			settings.broadphase = tree ? BroadphaseType::AABBTree : BroadphaseType::SortedGrid;
+			settings.solver = threads > 1 ? SolverType::GraphColored : SolverType::Sequential;
+
+			std::cout << "{\n";
+			std::cout << "  \"workerThreads\": " << settings.workerThreads << ",\n";
+			std::cout << "  \"broadphase\": \"" << (tree ? "tree" : "grid") << "\",\n";
+			std::cout << "  \"solver\": \"" << (threads > 1 ? "graphColored" : "sequential") << "\",\n";
+			std::cout << "  \"solverIterations\": " << settings.solverIterations << ",\n";
+			std::cout << "  \"scenes\": [\n";
+			for (size_t i = 0; i < selected.size(); i++) runScene(*selected[i], settings, warmup, steps, i + 1 == selected.size());
+			std::cout << "  ]\n";
+			std::cout << "}\n";
+			return 0;
+		}
+	}
+}
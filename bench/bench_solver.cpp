@@ -0,0 +1,76 @@
+//times full steps of a scene of box stacks with the sequential solver and with the graph colored solver on 1..N threads.
+//sleeping is off so every step solves every contact
+
+#include "bench.h"
+#include "../mve_physics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace mve {
+	namespace bench {
+		static double timeSteps(const PhysicsSettings& settings, uint32_t boxCount, int steps) {
+			PhysicsClass physics{ settings };
+
+			//ground, then square grid of 10 high stacks of 0.6 boxes with 0.2 gaps between stacks. +y is down
+			const uint32_t levels = 10;
+			const uint32_t stacks = (boxCount + levels - 1) / levels;
+			const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(stacks))));
+			const float spacing = 0.8f;
+			const float extent = side * spacing;
+
+			int objId = 0;
+			physics.addRigidBody(objId, { extent * 0.5f, 1.f, extent * 0.5f }, 0.f);
+			physics.addBoxCollider(objId++, { extent * 0.5f + 1.f, 0.25f, extent * 0.5f + 1.f });
+			for (uint32_t i = 0; i < boxCount; i++) {
+				uint32_t stack = i / levels, level = i % levels;
+				glm::vec3 position{ (stack % side) * spacing, 0.44f - level * 0.62f, (stack / side) * spacing };
+				physics.addRigidBody(objId, position);
+				physics.addBoxCollider(objId++, { 0.3f, 0.3f, 0.3f });
+			}
+
+			//let the stacks land so the timed steps see resting contacts
+			const float dt = 1.f / 60.f;
+			for (int s = 0; s < 60; s++) physics.step(dt);
+
+			Timer timer;
+			for (int s = 0; s < steps; s++) physics.step(dt);
+			double ms = timer.elapsedMs() / steps;
+			sink = sink + static_cast<uint64_t>(physics.getBody(1).position.y * 1000.f);
+			return ms;
+		}
+
+		int runSolver(int argc, char** argv) {
+			uint32_t boxCount = argc > 0 ? static_cast<uint32_t>(std::atoi(argv[0])) : 10000;
+			uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 8;
+			int steps = argc > 2 ? std::atoi(argv[2]) : 60;
+			uint32_t maxThreads = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 1u);
+
+			PhysicsSettings settings;
+			settings.gravity = { 0.f, 9.8f, 0.f };
+			settings.sleepTime = 1e30f;
+			settings.solverIterations = iterations;
+
+			std::cout << boxCount << " boxes, " << iterations << " solver iterations, " << steps << " steps\n";
+
+			settings.solver = SolverType::Sequential;
+			double sequential = timeSteps(settings, boxCount, steps);
+			std::cout << "sequential     1 thread   " << sequential << " ms/step\n";
+
+			settings.solver = SolverType::GraphColored;
+			double single = 0.0;
+			for (uint32_t threads = 1; threads <= maxThreads; threads *= 2) {
+				settings.workerThreads = threads;
+				double ms = timeSteps(settings, boxCount, steps);
+				if (threads == 1) single = ms;
+				std::cout << "graph colored  " << threads << (threads == 1 ? " thread   " : " threads  ") << ms << " ms/step"
+					<< "  speedup " << single / ms << "x (vs sequential " << sequential / ms << "x)\n";
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,34 @@
+//headless benchmarks for the physics code, nothing here touches vulkan or opens a window.
+//usage: physics_bench <benchmark> [args...]
+
+#include "bench.h"
+
+#include <cstring>
+#include <iostream>
+
+struct BenchEntry {
+	const char* name;
+	const char* description;
+	int (*run)(int, char**);
+};
+
+static const BenchEntry benchmarks[] = {
+	{ "sat", "scalar vs batched OBB separating axis test. args: [pairs] [repeats]", mve::bench::runSat },
+	{ "solver", "sequential vs graph colored contact solver over thread counts. args: [boxes] [iterations] [steps] [max threads]", mve::bench::runSolver },
+	{ "scenes", "pyramid, pile, rain and city stress scenes, per phase timings and counts as JSON. args: [scene|all] [steps] [threads] [grid|tree]", mve::bench::runScenes },
+	{ "reorder", "step time with bodies in insertion order vs morton order. args: [bodies] [steps] [threads]", mve::bench::runReorder },
+};
+
+int main(int argc, char** argv) {
+	if (argc >= 2) {
+		for (const BenchEntry& entry : benchmarks) {
+			if (std::strcmp(argv[1], entry.name) == 0) return entry.run(argc - 2, argv + 2);
+		}
+	}
+
+	std::cout << "usage: physics_bench <benchmark> [args...]\n";
+	for (const BenchEntry& entry : benchmarks) {
+		std::cout << "  " << entry.name << "  " << entry.description << "\n";
+	}
+	return 1;
+}
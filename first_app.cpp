@@ -6,6 +6,7 @@
 #include "simple_render_system.h"
 #include "point_light_system.h"
 #include "mve_buffer.h"
+#include "mve_physics_thread.h"
 
 #include <stdexcept>
 
@@ -17,11 +18,31 @@
 
 #include <array> //for std::array
 #include <chrono> //for time related functions
+#include <filesystem>
 #include <cassert> 
 #include <typeinfo>
 #include <iostream> 
 
 namespace mve {
+    //what a cached collision mesh was built from: the model file's size and last write time and the scale baked into its vertices.
+    //touching or editing the model, or changing the scale, gives another key and the cache is rebuilt
+    static uint64_t modelSourceKey(const std::string& path, const glm::vec3& scale) {
+        std::error_code error;
+        const uint64_t size = static_cast<uint64_t>(std::filesystem::file_size(path, error));
+        const int64_t time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+        uint64_t key = 1469598103934665603ull; //FNV-1a
+        auto mix = [&](const void* data, size_t bytes) {
+            for (size_t i = 0; i < bytes; i++) {
+                key ^= static_cast<const uint8_t*>(data)[i];
+                key *= 1099511628211ull;
+            }
+        };
+        mix(&size, sizeof(size));
+        mix(&time, sizeof(time));
+        mix(&scale, sizeof(scale));
+        return key;
+    }
+
 
     FirstApp::FirstApp() {
         globalPool = MveDescriptorPool::Builder(mveDevice)
@@ -119,11 +140,36 @@ namespace mve {
         physics.addRigidBody(gameObjects.at(0));
         physics.addRigidBody(gameObjects.at(1));
         physics.addRigidBody(gameObjects.at(2));
-		physics.rBodies[0].mass = 0; //setting to 0 makes it immovable
+		physics.setMass(0, 0.f); //setting to 0 makes it immovable
 		physics.addBoxCollider(0, { 5.f, -0.25f, 5.f });
-		physics.addBoxCollider(1, {0.3f, 0.3f, 0.3f});
-		physics.addBoxCollider(2, { 0.3f, 0.3f, 0.3f });
+		//the vases collide with the hull of their model, scaled like the game objects
+		MveModel::Builder flatVase, smoothVase;
+		flatVase.loadModel("models/flat_vase.obj");
+		smoothVase.loadModel("models/smooth_vase.obj");
+		physics.addConvexCollider(1, physics.createConvexHull(flatVase, gameObjects.at(1).transform.scale));
+		physics.addConvexCollider(2, physics.createConvexHull(smoothVase, gameObjects.at(2).transform.scale));
+		//the room collides with its own triangles. the BVH is built on the first run and loaded from next to the model after that,
+		//until the model or its scale changes
+		physics.addRigidBody(gameObjects.at(3), 0.f);
+		TriangleMesh vikingRoom;
+		const uint64_t roomKey = modelSourceKey("models/viking_room.obj", gameObjects.at(3).transform.scale);
+		if (!vikingRoom.loadFromFile("models/viking_room.bvh") || vikingRoom.sourceKey() != roomKey) {
+			MveModel::Builder room;
+			room.loadModel("models/viking_room.obj");
+			std::vector<glm::vec3> vertices;
+			for (const MveModel::Vertex& v : room.vertices) vertices.push_back(v.position * gameObjects.at(3).transform.scale);
+			if (vikingRoom.build(vertices, room.indices)) {
+				vikingRoom.setSourceKey(roomKey);
+				vikingRoom.saveToFile("models/viking_room.bvh");
+			}
+		}
+		physics.addMeshCollider(3, physics.addTriangleMesh(std::move(vikingRoom)));
 		physics.applyForce(2, { -150.f, 150.f, 150.f });
+		physics.setContinuous(2, true); //fast enough to pass through the ground between two steps
+
+		//while the physics thread runs, forces and speeds go through physicsThread instead of physics
+		PhysicsThread physicsThread{ physics };
+		if (physicsOnOwnThread) physicsThread.start();
 
         while (!mveWindow.shouldClose()) {
             //checks and processes window level events such as keyboard and mouse input
@@ -158,22 +204,20 @@ namespace mve {
                 ubo.projection = camera.getProjection();
                 ubo.view = camera.getView();
                 ubo.inverseView = camera.getInverseView();
-                physics.step(frameTime);
                 
 				pointLightSystem.update(frameInfo, ubo);
                 //std::cout << "buffer data: " << typeid(&ubo).name() << std::endl;
 				uboBuffers[frameIndex]->writeToBuffer(&ubo); //don't need offset or size because we are using the entire buffer which is set in the constructor which is found at the top of this function
 				uboBuffers[frameIndex]->flush();
 
-                physics.step(frameTime);
-
-				//update game object positions from physics simulation
-                for(auto& body: physics.rBodies){
-                    //std::cout << "Object ID: " << body.objId << " is at position: " << gameObjects.at(body.objId).transform.translation.z << "\n";
-					if (body.sleep) continue;
-                    gameObjects.at(body.objId).transform.translation = body.position;
-                    //gameObjects.at(body.objId).transform.rotation = body.rotation;
-				}
+                //physics runs at a fixed 60 Hz no matter the frame rate, the transforms are blended between the last two steps
+                if (physicsOnOwnThread) {
+                    physicsThread.syncTransforms(gameObjects);
+                }
+                else {
+                    physics.update(frameTime);
+                    physics.syncTransforms(gameObjects);
+                }
 
                 //render
 				mveRenderer.beginSwapChainRenderPass(commandBuffer);
@@ -186,6 +230,7 @@ namespace mve {
 				mveRenderer.endFrame();
             }
         }
+        physicsThread.stop();
         //waits for the device to finish all operations before destroying resources
 		vkDeviceWaitIdle(mveDevice.device());
     }
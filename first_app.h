@@ -28,6 +28,9 @@ namespace mve {
         FirstApp& operator=(const FirstApp&) = delete;
 
         void run();
+        //stepping on its own thread takes the simulation off the frame time, the render loop only blends the published poses.
+        //off by default, physics then steps inline in the render loop. set before run
+        void setPhysicsOnOwnThread(bool onOwnThread) { physicsOnOwnThread = onOwnThread; }
 
     private:
 		//loadGameObjects is where we load models and create game objects
@@ -47,5 +50,6 @@ namespace mve {
 
         MveGameObject::Map gameObjects;
         MveGameObject::id_t roomId = static_cast<MveGameObject::id_t>(-1);
+        bool physicsOnOwnThread = false;
     };
 }
\ No newline at end of file
@@ -2,11 +2,15 @@
 
 // std
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
+int main(int argc, char** argv) {
     mve::FirstApp app{};
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--physics-thread") == 0) app.setPhysicsOnOwnThread(true);
+    }
 
     try {
         app.run();
@@ -0,0 +1,242 @@
+#include "mve_aabb_tree.h"
+
+#include <algorithm>
+
+namespace mve {
+	AABBTree::AABBTree(float margin) : margin{ margin } {}
+
+	int32_t AABBTree::allocateNode() {
+		//grow the pool when the free list is empty. nodes are addressed by index so growing doesn't break anything
+		if (freeList == nullNode) {
+			nodes.emplace_back();
+			return static_cast<int32_t>(nodes.size() - 1);
+		}
+		int32_t nodeId = freeList;
+		freeList = nodes[nodeId].parent;
+		nodes[nodeId] = TreeNode{};
+		return nodeId;
+	}
+
+	void AABBTree::freeNode(int32_t nodeId) {
+		nodes[nodeId].parent = freeList;
+		nodes[nodeId].height = -1;
+		freeList = nodeId;
+	}
+
+	int32_t AABBTree::createProxy(const AABB& aabb, uint32_t userData) {
+		int32_t proxyId = allocateNode();
+		glm::vec3 r{ margin };
+		nodes[proxyId].aabb = { aabb.min - r, aabb.max + r };
+		nodes[proxyId].userData = userData;
+		nodes[proxyId].height = 0;
+		insertLeaf(proxyId);
+		proxyCount++;
+		return proxyId;
+	}
+
+	void AABBTree::destroyProxy(int32_t proxyId) {
+		removeLeaf(proxyId);
+		freeNode(proxyId);
+		proxyCount--;
+	}
+
+	bool AABBTree::moveProxy(int32_t proxyId, const AABB& aabb) {
+		//still inside the fat box, nothing to do
+		if (nodes[proxyId].aabb.contains(aabb)) return false;
+
+		removeLeaf(proxyId);
+		glm::vec3 r{ margin };
+		nodes[proxyId].aabb = { aabb.min - r, aabb.max + r };
+		insertLeaf(proxyId);
+		return true;
+	}
+
+	void AABBTree::insertLeaf(int32_t leaf) {
+		if (root == nullNode) {
+			root = leaf;
+			nodes[root].parent = nullNode;
+			return;
+		}
+
+		//find the best sibling by walking down the cheaper side.
+		//cost of a node is the surface area it adds, inherited cost is the growth of every ancestor
+		AABB leafAABB = nodes[leaf].aabb;
+		int32_t index = root;
+		while (!nodes[index].isLeaf()) {
+			int32_t child1 = nodes[index].child1;
+			int32_t child2 = nodes[index].child2;
+
+			float area = nodes[index].aabb.area();
+			float combinedArea = AABB::combine(nodes[index].aabb, leafAABB).area();
+
+			//cost of making a new parent for this node and the new leaf
+			float cost = 2.f * combinedArea;
+			//minimum cost of pushing the leaf further down the tree
+			float inheritanceCost = 2.f * (combinedArea - area);
+
+			auto descendCost = [&](int32_t child) {
+				float newArea = AABB::combine(leafAABB, nodes[child].aabb).area();
+				if (nodes[child].isLeaf()) return newArea + inheritanceCost;
+				return (newArea - nodes[child].aabb.area()) + inheritanceCost;
+			};
+			float cost1 = descendCost(child1);
+			float cost2 = descendCost(child2);
+
+			if (cost < cost1 && cost < cost2) break;
+			index = (cost1 < cost2) ? child1 : child2;
+		}
+		int32_t sibling = index;
+
+		//new parent for the sibling and the leaf
+		int32_t oldParent = nodes[sibling].parent;
+		int32_t newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].aabb = AABB::combine(leafAABB, nodes[sibling].aabb);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent != nullNode) {
+			if (nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+			else nodes[oldParent].child2 = newParent;
+		}
+		else {
+			root = newParent;
+		}
+
+		//walk back up fixing heights and aabbs
+		index = nodes[leaf].parent;
+		while (index != nullNode) {
+			index = balance(index);
+			int32_t child1 = nodes[index].child1;
+			int32_t child2 = nodes[index].child2;
+			nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+			nodes[index].aabb = AABB::combine(nodes[child1].aabb, nodes[child2].aabb);
+			index = nodes[index].parent;
+		}
+	}
+
+	void AABBTree::removeLeaf(int32_t leaf) {
+		if (leaf == root) {
+			root = nullNode;
+			return;
+		}
+
+		int32_t parent = nodes[leaf].parent;
+		int32_t grandParent = nodes[parent].parent;
+		int32_t sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+
+		if (grandParent == nullNode) {
+			root = sibling;
+			nodes[sibling].parent = nullNode;
+			freeNode(parent);
+			return;
+		}
+
+		//destroy the parent and connect the sibling to the grandparent
+		if (nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+		else nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		int32_t index = grandParent;
+		while (index != nullNode) {
+			index = balance(index);
+			int32_t child1 = nodes[index].child1;
+			int32_t child2 = nodes[index].child2;
+			nodes[index].aabb = AABB::combine(nodes[child1].aabb, nodes[child2].aabb);
+			nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+			index = nodes[index].parent;
+		}
+	}
+
+	//perform a left or right rotation if node A is imbalanced.
+	//A has children B and C, B has children D and E, C has children F and G.
+	//whichever of B or C is taller becomes the new subtree root and A takes its shorter child
+	int32_t AABBTree::balance(int32_t iA) {
+		TreeNode& A = nodes[iA];
+		if (A.isLeaf() || A.height < 2) return iA;
+
+		int32_t iB = A.child1;
+		int32_t iC = A.child2;
+		int32_t heightDiff = nodes[iC].height - nodes[iB].height;
+
+		//rotate C up
+		if (heightDiff > 1) {
+			TreeNode& C = nodes[iC];
+			int32_t iF = C.child1;
+			int32_t iG = C.child2;
+
+			//swap A and C
+			C.child1 = iA;
+			C.parent = A.parent;
+			A.parent = iC;
+
+			//A's old parent should point to C
+			if (C.parent != nullNode) {
+				if (nodes[C.parent].child1 == iA) nodes[C.parent].child1 = iC;
+				else nodes[C.parent].child2 = iC;
+			}
+			else {
+				root = iC;
+			}
+
+			//keep the taller of F and G above A
+			if (nodes[iF].height > nodes[iG].height) {
+				C.child2 = iF;
+				A.child2 = iG;
+				nodes[iG].parent = iA;
+			}
+			else {
+				C.child2 = iG;
+				A.child2 = iF;
+				nodes[iF].parent = iA;
+			}
+			A.aabb = AABB::combine(nodes[iB].aabb, nodes[A.child2].aabb);
+			C.aabb = AABB::combine(A.aabb, nodes[C.child2].aabb);
+			A.height = 1 + std::max(nodes[iB].height, nodes[A.child2].height);
+			C.height = 1 + std::max(A.height, nodes[C.child2].height);
+			return iC;
+		}
+
+		//rotate B up
+		if (heightDiff < -1) {
+			TreeNode& B = nodes[iB];
+			int32_t iD = B.child1;
+			int32_t iE = B.child2;
+
+			//swap A and B
+			B.child1 = iA;
+			B.parent = A.parent;
+			A.parent = iB;
+
+			if (B.parent != nullNode) {
+				if (nodes[B.parent].child1 == iA) nodes[B.parent].child1 = iB;
+				else nodes[B.parent].child2 = iB;
+			}
+			else {
+				root = iB;
+			}
+
+			if (nodes[iD].height > nodes[iE].height) {
+				B.child2 = iD;
+				A.child1 = iE;
+				nodes[iE].parent = iA;
+			}
+			else {
+				B.child2 = iE;
+				A.child1 = iD;
+				nodes[iD].parent = iA;
+			}
+			A.aabb = AABB::combine(nodes[A.child1].aabb, nodes[iC].aabb);
+			B.aabb = AABB::combine(A.aabb, nodes[B.child2].aabb);
+			A.height = 1 + std::max(nodes[A.child1].height, nodes[iC].height);
+			B.height = 1 + std::max(A.height, nodes[B.child2].height);
+			return iB;
+		}
+
+		return iA;
+	}
+}
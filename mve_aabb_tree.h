@@ -0,0 +1,131 @@
+//dynamic bounding volume hierarchy used as a broadphase. based on the dynamic tree in Box2D:
+//https://github.com/erincatto/box2d/blob/v2.4.1/src/collision/b2_dynamic_tree.cpp
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace mve {
+	//AABB (Axis-Aligned Bounding Box) collisions
+	struct AABB {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		bool contains(const AABB& other) const {
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+				other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+		}
+		bool overlaps(const AABB& other) const {
+			return (min.x <= other.max.x && max.x >= other.min.x) &&
+				(min.y <= other.max.y && max.y >= other.min.y) &&
+				(min.z <= other.max.z && max.z >= other.min.z);
+		}
+		//half the surface area, only used to compare costs so the factor of 2 doesn't matter
+		float area() const {
+			glm::vec3 d = max - min;
+			return d.x * d.y + d.y * d.z + d.z * d.x;
+		}
+		static AABB combine(const AABB& a, const AABB& b) {
+			return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+		}
+	};
+
+	//leaves hold a fattened AABB so a body can move a little without touching the tree.
+	//a leaf is only removed and reinserted when the tight AABB leaves its fat AABB (temporal coherence)
+	//internal nodes are kept balanced with AVL style rotations
+	class AABBTree {
+	public:
+		static constexpr int32_t nullNode = -1;
+
+		explicit AABBTree(float margin = 0.1f);
+
+		//returns the proxy (leaf node) id. userData is handed back by query
+		int32_t createProxy(const AABB& aabb, uint32_t userData);
+		void destroyProxy(int32_t proxyId);
+		//returns true if the proxy had to be reinserted because the aabb left the fat aabb
+		bool moveProxy(int32_t proxyId, const AABB& aabb);
+
+		const AABB& getFatAABB(int32_t proxyId) const { return nodes[proxyId].aabb; }
+		uint32_t getUserData(int32_t proxyId) const { return nodes[proxyId].userData; }
+		void setUserData(int32_t proxyId, uint32_t userData) { nodes[proxyId].userData = userData; }
+
+		int32_t getHeight() const { return root == nullNode ? 0 : nodes[root].height; }
+		uint32_t getProxyCount() const { return proxyCount; }
+
+		//calls callback(userData) for every leaf whose fat aabb overlaps aabb. stop early by returning false
+		template<typename Callback>
+		void query(const AABB& aabb, Callback&& callback) const {
+			//the tree is balanced so the depth stays around 1.44 * log2(leaves), 256 is far more than needed
+			int32_t stack[256];
+			int32_t count = 0;
+			if (root != nullNode) stack[count++] = root;
+
+			while (count > 0) {
+				const TreeNode& node = nodes[stack[--count]];
+				if (!node.aabb.overlaps(aabb)) continue;
+
+				if (node.isLeaf()) {
+					if (!callback(node.userData)) return;
+				}
+				else {
+					assert(count + 2 <= 256 && "AABBTree query stack overflow");
+					stack[count++] = node.child1;
+					stack[count++] = node.child2;
+				}
+			}
+		}
+
+		//same walk with a custom node test, for rays and ray packets: descends into every node where test(fatAABB) is true and
+		//calls callback(userData, fatAABB) on the leaves. the test may depend on state the callback changes (a ray shortened by a hit)
+		template<typename Test, typename Callback>
+		void traverse(Test&& test, Callback&& callback) const {
+			int32_t stack[256];
+			int32_t count = 0;
+			if (root != nullNode) stack[count++] = root;
+
+			while (count > 0) {
+				const TreeNode& node = nodes[stack[--count]];
+				if (!test(node.aabb)) continue;
+
+				if (node.isLeaf()) {
+					if (!callback(node.userData, node.aabb)) return;
+				}
+				else {
+					assert(count + 2 <= 256 && "AABBTree traverse stack overflow");
+					stack[count++] = node.child1;
+					stack[count++] = node.child2;
+				}
+			}
+		}
+
+	private:
+		struct TreeNode {
+			AABB aabb;
+			int32_t parent = nullNode; //doubles as the next free node while on the free list
+			int32_t child1 = nullNode;
+			int32_t child2 = nullNode;
+			int32_t height = -1; //leaf = 0, free node = -1
+			uint32_t userData = 0;
+
+			bool isLeaf() const { return child1 == nullNode; }
+		};
+
+		int32_t allocateNode();
+		void freeNode(int32_t nodeId);
+
+		void insertLeaf(int32_t leaf);
+		void removeLeaf(int32_t leaf);
+		//rotates the subtree at iA if it is out of balance, returns the new subtree root
+		int32_t balance(int32_t iA);
+
+		std::vector<TreeNode> nodes;
+		int32_t root = nullNode;
+		int32_t freeList = nullNode;
+		uint32_t proxyCount = 0;
+		float margin;
+	};
+}
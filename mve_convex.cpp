@@ -0,0 +1,783 @@
+#include "mve_convex.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+namespace mve {
+	//quickhull
+
+	struct QuickhullFace {
+		uint32_t v[3];
+		glm::vec3 normal;
+		float offset;
+		std::vector<uint32_t> outside; //points in front of this face that aren't on the hull yet
+		bool alive = true;
+	};
+
+	static QuickhullFace makeFace(const std::vector<glm::vec3>& points, uint32_t a, uint32_t b, uint32_t c) {
+		QuickhullFace face;
+		face.v[0] = a;
+		face.v[1] = b;
+		face.v[2] = c;
+		glm::vec3 n = glm::cross(points[b] - points[a], points[c] - points[a]);
+		float length = glm::length(n);
+		//a sliver from a point almost on an edge gets no normal and is never in front of anything
+		face.normal = length > 1e-20f ? n / length : glm::vec3{ 0.f };
+		face.offset = glm::dot(face.normal, points[a]);
+		return face;
+	}
+
+	bool ConvexHull::build(const std::vector<glm::vec3>& points, uint32_t vertexLimit, ConvexHull& out) {
+		out = ConvexHull{};
+		if (points.size() < 4) return false;
+		vertexLimit = std::clamp(vertexLimit, 4u, maxVertices);
+		const uint32_t count = static_cast<uint32_t>(points.size());
+
+		//extreme points along each axis
+		uint32_t extreme[6] = {};
+		glm::vec3 maxAbs{ 0.f };
+		for (uint32_t i = 0; i < count; i++) {
+			for (int k = 0; k < 3; k++) {
+				if (points[i][k] < points[extreme[k * 2]][k]) extreme[k * 2] = i;
+				if (points[i][k] > points[extreme[k * 2 + 1]][k]) extreme[k * 2 + 1] = i;
+			}
+			maxAbs = glm::max(maxAbs, glm::abs(points[i]));
+		}
+		//plane tolerance grows with the coordinates so big and small models behave the same
+		const float eps = 1e-5f * (maxAbs.x + maxAbs.y + maxAbs.z);
+		if (eps <= 0.f) return false;
+
+		//first tetrahedron: the two extremes furthest apart, the point furthest from their line, then the one furthest from that plane
+		uint32_t i0 = 0, i1 = 0;
+		float best = -1.f;
+		for (int a = 0; a < 6; a++) {
+			for (int b = a + 1; b < 6; b++) {
+				glm::vec3 d = points[extreme[b]] - points[extreme[a]];
+				if (glm::dot(d, d) > best) {
+					best = glm::dot(d, d);
+					i0 = extreme[a];
+					i1 = extreme[b];
+				}
+			}
+		}
+		if (best < eps * eps) return false;
+		const glm::vec3 line = glm::normalize(points[i1] - points[i0]);
+		uint32_t i2 = 0;
+		best = -1.f;
+		for (uint32_t i = 0; i < count; i++) {
+			glm::vec3 c = glm::cross(points[i] - points[i0], line);
+			if (glm::dot(c, c) > best) {
+				best = glm::dot(c, c);
+				i2 = i;
+			}
+		}
+		if (best < eps * eps) return false;
+		const glm::vec3 planeNormal = glm::normalize(glm::cross(points[i1] - points[i0], points[i2] - points[i0]));
+		uint32_t i3 = 0;
+		best = -1.f;
+		for (uint32_t i = 0; i < count; i++) {
+			float d = std::abs(glm::dot(points[i] - points[i0], planeNormal));
+			if (d > best) {
+				best = d;
+				i3 = i;
+			}
+		}
+		if (best < eps) return false; //flat
+
+		std::vector<QuickhullFace> faces;
+		const uint32_t start[4][3] = { { i0, i1, i2 }, { i0, i1, i3 }, { i0, i2, i3 }, { i1, i2, i3 } };
+		const uint32_t opposite[4] = { i3, i2, i1, i0 };
+		for (int f = 0; f < 4; f++) {
+			faces.push_back(makeFace(points, start[f][0], start[f][1], start[f][2]));
+			//wind every face away from the corner it doesn't use
+			if (glm::dot(faces.back().normal, points[opposite[f]]) > faces.back().offset) {
+				faces.back() = makeFace(points, start[f][0], start[f][2], start[f][1]);
+			}
+		}
+
+		//every point goes to the first face it is in front of, the rest are inside already
+		for (uint32_t i = 0; i < count; i++) {
+			if (i == i0 || i == i1 || i == i2 || i == i3) continue;
+			for (QuickhullFace& face : faces) {
+				if (glm::dot(face.normal, points[i]) - face.offset > eps) {
+					face.outside.push_back(i);
+					break;
+				}
+			}
+		}
+
+		std::vector<std::pair<uint32_t, uint32_t>> horizon;
+		std::vector<uint32_t> orphans;
+		for (uint32_t vertexCount = 4; vertexCount < vertexLimit; vertexCount++) {
+			//the point furthest outside adds the most volume, so stopping early keeps the corners that matter
+			uint32_t eye = UINT32_MAX;
+			float furthest = eps;
+			for (const QuickhullFace& face : faces) {
+				if (!face.alive) continue;
+				for (uint32_t i : face.outside) {
+					float d = glm::dot(face.normal, points[i]) - face.offset;
+					if (d > furthest) {
+						furthest = d;
+						eye = i;
+					}
+				}
+			}
+			if (eye == UINT32_MAX) break;
+			const glm::vec3& e = points[eye];
+
+			//faces the eye sees go, the edges between them and the faces it doesn't see make the horizon.
+			//an edge shared by two visible faces shows up once in each direction and cancels out
+			horizon.clear();
+			orphans.clear();
+			const size_t faceCount = faces.size();
+			for (size_t f = 0; f < faceCount; f++) {
+				QuickhullFace& face = faces[f];
+				if (!face.alive || glm::dot(face.normal, e) - face.offset <= eps) continue;
+				face.alive = false;
+				for (uint32_t i : face.outside) if (i != eye) orphans.push_back(i);
+				face.outside.clear();
+				for (int k = 0; k < 3; k++) {
+					uint32_t a = face.v[k], b = face.v[(k + 1) % 3];
+					auto reverse = std::find(horizon.begin(), horizon.end(), std::make_pair(b, a));
+					if (reverse != horizon.end()) {
+						*reverse = horizon.back();
+						horizon.pop_back();
+					}
+					else {
+						horizon.emplace_back(a, b);
+					}
+				}
+			}
+
+			//the horizon keeps the winding of the faces that were removed, so the new faces point outwards too
+			const size_t firstNew = faces.size();
+			for (const auto& [a, b] : horizon) faces.push_back(makeFace(points, a, b, eye));
+			for (uint32_t i : orphans) {
+				for (size_t f = firstNew; f < faces.size(); f++) {
+					if (glm::dot(faces[f].normal, points[i]) - faces[f].offset > eps) {
+						faces[f].outside.push_back(i);
+						break;
+					}
+				}
+			}
+		}
+
+		//compact the vertices the hull uses
+		std::vector<uint32_t> remap(count, UINT32_MAX);
+		struct Triangle {
+			uint32_t v[3];
+			glm::vec3 normal;
+			float offset;
+		};
+		std::vector<Triangle> triangles;
+		for (const QuickhullFace& face : faces) {
+			if (!face.alive || face.normal == glm::vec3{ 0.f }) continue;
+			Triangle t;
+			for (int k = 0; k < 3; k++) {
+				uint32_t& index = remap[face.v[k]];
+				if (index == UINT32_MAX) {
+					index = static_cast<uint32_t>(out.vertices.size());
+					out.vertices.push_back(points[face.v[k]]);
+				}
+				t.v[k] = index;
+			}
+			t.normal = face.normal;
+			t.offset = face.offset;
+			triangles.push_back(t);
+		}
+
+		//coplanar neighbours become one polygon, so a flat side gives a stable manifold instead of a fan of triangles.
+		//a region only grows over triangles facing the same way as its first one, curved surfaces stay triangles
+		std::unordered_map<uint64_t, uint32_t> edgeTriangle;
+		auto edgeKey = [](uint32_t a, uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; };
+		for (uint32_t t = 0; t < triangles.size(); t++) {
+			for (int k = 0; k < 3; k++) edgeTriangle[edgeKey(triangles[t].v[k], triangles[t].v[(k + 1) % 3])] = t;
+		}
+		std::vector<uint32_t> region(triangles.size(), UINT32_MAX);
+		std::vector<uint32_t> members, stack;
+		std::unordered_map<uint32_t, uint32_t> next;
+		auto addFace = [&](const glm::vec3& normal, const uint32_t* loop, uint32_t loopSize) {
+			HullFace face;
+			face.normal = normal;
+			face.offset = -FLT_MAX;
+			for (uint32_t k = 0; k < loopSize; k++) face.offset = std::max(face.offset, glm::dot(normal, out.vertices[loop[k]]));
+			face.first = static_cast<uint16_t>(out.faceIndices.size());
+			face.count = static_cast<uint16_t>(loopSize);
+			for (uint32_t k = 0; k < loopSize; k++) out.faceIndices.push_back(static_cast<uint16_t>(loop[k]));
+			out.faces.push_back(face);
+		};
+
+		for (uint32_t seed = 0; seed < triangles.size(); seed++) {
+			if (region[seed] != UINT32_MAX) continue;
+			const glm::vec3 seedNormal = triangles[seed].normal;
+			members.clear();
+			stack.assign(1, seed);
+			region[seed] = seed;
+			while (!stack.empty()) {
+				uint32_t t = stack.back();
+				stack.pop_back();
+				members.push_back(t);
+				for (int k = 0; k < 3; k++) {
+					auto it = edgeTriangle.find(edgeKey(triangles[t].v[(k + 1) % 3], triangles[t].v[k]));
+					if (it == edgeTriangle.end() || region[it->second] != UINT32_MAX) continue;
+					const Triangle& neighbour = triangles[it->second];
+					if (glm::dot(neighbour.normal, seedNormal) < 1.f - 1e-4f || std::abs(neighbour.offset - triangles[seed].offset) > eps) continue;
+					region[it->second] = seed;
+					stack.push_back(it->second);
+				}
+			}
+
+			//the region's outline is its edges whose other side is in another region, walked into one loop
+			next.clear();
+			bool simple = members.size() > 1;
+			for (uint32_t t : members) {
+				for (int k = 0; k < 3 && simple; k++) {
+					uint32_t a = triangles[t].v[k], b = triangles[t].v[(k + 1) % 3];
+					auto it = edgeTriangle.find(edgeKey(b, a));
+					if (it != edgeTriangle.end() && region[it->second] == seed) continue;
+					simple = next.emplace(a, b).second; //a corner touching the outline twice can't be one loop
+				}
+			}
+			uint32_t loop[maxFaceVertices];
+			uint32_t loopSize = 0;
+			if (simple && next.size() <= maxFaceVertices) {
+				uint32_t v = next.begin()->first;
+				do {
+					loop[loopSize++] = v;
+					auto it = next.find(v);
+					if (it == next.end()) break;
+					v = it->second;
+				} while (v != loop[0] && loopSize < maxFaceVertices);
+				simple = v == loop[0] && loopSize == next.size();
+			}
+			else {
+				simple = false;
+			}
+
+			if (simple) {
+				//Newell's normal averages the slightly different triangle normals
+				glm::vec3 normal{ 0.f };
+				for (uint32_t k = 0; k < loopSize; k++) normal += glm::cross(out.vertices[loop[k]], out.vertices[loop[(k + 1) % loopSize]]);
+				addFace(glm::normalize(normal), loop, loopSize);
+				continue;
+			}
+			for (uint32_t t : members) addFace(triangles[t].normal, triangles[t].v, 3);
+		}
+
+		glm::vec3 min{ FLT_MAX }, max{ -FLT_MAX };
+		for (const glm::vec3& v : out.vertices) {
+			min = glm::min(min, v);
+			max = glm::max(max, v);
+		}
+		out.center = (min + max) * 0.5f;
+		out.halfSize = (max - min) * 0.5f;
+		return true;
+	}
+
+	//corner k has +x for bit 0, +y for bit 1 and +z for bit 2. faces -x, +x, -y, +y, -z, +z, counter clockwise from outside
+	static const uint16_t boxFaceIndices[24] = { 0, 4, 6, 2, 1, 3, 7, 5, 0, 1, 5, 4, 2, 6, 7, 3, 0, 2, 3, 1, 4, 5, 7, 6 };
+
+	BoxPolytope::BoxPolytope(const glm::vec3& halfSize) {
+		for (int k = 0; k < 8; k++) {
+			vertices[k] = { k & 1 ? halfSize.x : -halfSize.x, k & 2 ? halfSize.y : -halfSize.y, k & 4 ? halfSize.z : -halfSize.z };
+		}
+		for (int f = 0; f < 6; f++) {
+			glm::vec3 normal{ 0.f };
+			normal[f / 2] = f & 1 ? 1.f : -1.f;
+			faces[f] = { normal, halfSize[f / 2], static_cast<uint16_t>(f * 4), 4 };
+		}
+	}
+
+	//front face, then the back face wound the other way
+	static const uint16_t triangleFaceIndices[6] = { 0, 1, 2, 0, 2, 1 };
+
+	TrianglePolytope::TrianglePolytope(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		vertices[0] = a;
+		vertices[1] = b;
+		vertices[2] = c;
+		glm::vec3 n = glm::cross(b - a, c - a);
+		float length = glm::length(n);
+		n = length > 1e-20f ? n / length : glm::vec3{ 0.f };
+		faces[0] = { n, glm::dot(n, a), 0, 3 };
+		faces[1] = { -n, -glm::dot(n, a), 3, 3 };
+	}
+
+	ConvexShape ConvexShape::hull(const ConvexHull& hull, const glm::mat3& rotation, const glm::vec3& position) {
+		ConvexShape shape;
+		shape.vertices = hull.vertices.data();
+		shape.vertexCount = static_cast<uint32_t>(hull.vertices.size());
+		shape.faces = hull.faces.data();
+		shape.faceCount = static_cast<uint32_t>(hull.faces.size());
+		shape.faceIndices = hull.faceIndices.data();
+		shape.rotation = rotation;
+		shape.position = position;
+		return shape;
+	}
+
+	ConvexShape ConvexShape::box(const BoxPolytope& box, const glm::mat3& rotation, const glm::vec3& position) {
+		ConvexShape shape;
+		shape.vertices = box.vertices;
+		shape.vertexCount = 8;
+		shape.faces = box.faces;
+		shape.faceCount = 6;
+		shape.faceIndices = boxFaceIndices;
+		shape.rotation = rotation;
+		shape.position = position;
+		return shape;
+	}
+
+	ConvexShape ConvexShape::triangle(const TrianglePolytope& triangle) {
+		ConvexShape shape;
+		shape.vertices = triangle.vertices;
+		shape.vertexCount = 3;
+		shape.faces = triangle.faces;
+		shape.faceCount = 2;
+		shape.faceIndices = triangleFaceIndices;
+		return shape;
+	}
+
+	ConvexShape ConvexShape::sphere(const glm::vec3& center, float radius) {
+		static const glm::vec3 origin{ 0.f };
+		ConvexShape shape;
+		shape.vertices = &origin;
+		shape.vertexCount = 1;
+		shape.position = center;
+		shape.radius = radius;
+		return shape;
+	}
+
+	uint32_t ConvexShape::support(const glm::vec3& direction) const {
+		//into local space once instead of moving every vertex out
+		const glm::vec3 local = glm::transpose(rotation) * direction;
+		uint32_t best = 0;
+		float bestDot = glm::dot(vertices[0], local);
+		for (uint32_t i = 1; i < vertexCount; i++) {
+			float d = glm::dot(vertices[i], local);
+			if (d > bestDot) {
+				bestDot = d;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	//GJK
+
+	static SimplexVertex makeVertex(const ConvexShape& a, const ConvexShape& b, uint32_t indexA, uint32_t indexB) {
+		SimplexVertex v;
+		v.indexA = indexA;
+		v.indexB = indexB;
+		v.a = a.vertex(indexA);
+		v.b = b.vertex(indexB);
+		v.w = v.a - v.b;
+		return v;
+	}
+
+	//keeps the listed vertices of s with their weights
+	static void keep(Simplex& s, std::initializer_list<uint32_t> indices, std::initializer_list<float> weights) {
+		SimplexVertex kept[4];
+		uint32_t n = 0;
+		for (uint32_t i : indices) kept[n++] = s.v[i];
+		for (uint32_t k = 0; k < n; k++) s.v[k] = kept[k];
+		n = 0;
+		for (float w : weights) s.weight[n++] = w;
+		s.count = n;
+	}
+
+	static void solveSegment(Simplex& s) {
+		const glm::vec3 a = s.v[0].w, ab = s.v[1].w - a;
+		const float lengthSq = glm::dot(ab, ab);
+		const float t = lengthSq > 1e-20f ? -glm::dot(a, ab) / lengthSq : 1.f;
+		if (t <= 0.f) keep(s, { 0 }, { 1.f });
+		else if (t >= 1.f) keep(s, { 1 }, { 1.f });
+		else keep(s, { 0, 1 }, { 1.f - t, t });
+	}
+
+	//closest point of triangle s.v[i], s.v[j], s.v[k] to the origin by Voronoi regions, Real-Time Collision Detection 5.1.5
+	static void solveTriangle(Simplex& s, uint32_t i, uint32_t j, uint32_t k) {
+		const glm::vec3 a = s.v[i].w, b = s.v[j].w, c = s.v[k].w;
+		const glm::vec3 ab = b - a, ac = c - a;
+		const float d1 = -glm::dot(ab, a), d2 = -glm::dot(ac, a);
+		if (d1 <= 0.f && d2 <= 0.f) return keep(s, { i }, { 1.f });
+		const float d3 = -glm::dot(ab, b), d4 = -glm::dot(ac, b);
+		if (d3 >= 0.f && d4 <= d3) return keep(s, { j }, { 1.f });
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+			const float t = d1 / (d1 - d3);
+			return keep(s, { i, j }, { 1.f - t, t });
+		}
+		const float d5 = -glm::dot(ab, c), d6 = -glm::dot(ac, c);
+		if (d6 >= 0.f && d5 <= d6) return keep(s, { k }, { 1.f });
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+			const float t = d2 / (d2 - d6);
+			return keep(s, { i, k }, { 1.f - t, t });
+		}
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) {
+			const float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return keep(s, { j, k }, { 1.f - t, t });
+		}
+		const float denom = 1.f / (va + vb + vc);
+		const float v = vb * denom, w = vc * denom;
+		keep(s, { i, j, k }, { 1.f - v - w, v, w });
+	}
+
+	static glm::vec3 closestPoint(const Simplex& s) {
+		glm::vec3 p{ 0.f };
+		for (uint32_t k = 0; k < s.count; k++) p += s.v[k].w * s.weight[k];
+		return p;
+	}
+
+	//false when the origin is inside the tetrahedron, otherwise reduces s to the closest face, edge or corner
+	static bool solveTetrahedron(Simplex& s) {
+		static const uint32_t faces[4][4] = { { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 3, 1 }, { 1, 2, 3, 0 } };
+		Simplex best;
+		float bestDistSq = FLT_MAX;
+		for (const auto& f : faces) {
+			const glm::vec3 a = s.v[f[0]].w;
+			const glm::vec3 n = glm::cross(s.v[f[1]].w - a, s.v[f[2]].w - a);
+			const float toOrigin = -glm::dot(n, a);
+			const float toOpposite = glm::dot(n, s.v[f[3]].w - a);
+			//a flat tetrahedron can't say which side is in, all its faces are tried
+			const bool flat = std::abs(toOpposite) <= 1e-7f * glm::length(n) * glm::length(s.v[f[3]].w - a);
+			if (!flat && toOrigin * toOpposite >= 0.f) continue; //origin on the inner side of this face
+			Simplex face = s;
+			solveTriangle(face, f[0], f[1], f[2]);
+			const glm::vec3 p = closestPoint(face);
+			if (glm::dot(p, p) < bestDistSq) {
+				bestDistSq = glm::dot(p, p);
+				best = face;
+			}
+		}
+		if (bestDistSq == FLT_MAX) return false;
+		s = best;
+		return true;
+	}
+
+	GjkResult gjk(const ConvexShape& a, const ConvexShape& b, GjkCache& cache) {
+		GjkResult result{};
+		Simplex& s = result.simplex;
+		s.count = 0;
+		for (uint32_t k = 0; k < 4; k++) {
+			const uint32_t indexA = (cache.indexA >> (k * 8)) & 0xFF, indexB = (cache.indexB >> (k * 8)) & 0xFF;
+			if (indexA == 0xFF) break;
+			if (indexA >= a.vertexCount || indexB >= b.vertexCount) {
+				s.count = 0;
+				break;
+			}
+			s.v[s.count++] = makeVertex(a, b, indexA, indexB);
+		}
+		if (s.count == 0) {
+			//roughly towards the origin from the middle of the Minkowski difference
+			glm::vec3 d = b.position - a.position;
+			if (glm::dot(d, d) < 1e-12f) d = { 1.f, 0.f, 0.f };
+			s.v[0] = makeVertex(a, b, a.support(d), b.support(-d));
+			s.count = 1;
+		}
+		s.weight[0] = 1.f;
+
+		float lastDistSq = FLT_MAX;
+		glm::vec3 v{ 0.f };
+		for (int iteration = 0; iteration < 48; iteration++) {
+			switch (s.count) {
+			case 1: s.weight[0] = 1.f; break;
+			case 2: solveSegment(s); break;
+			case 3: solveTriangle(s, 0, 1, 2); break;
+			case 4: result.overlap = !solveTetrahedron(s); break;
+			}
+			if (result.overlap) break;
+			v = closestPoint(s);
+			const float distSq = glm::dot(v, v);
+			if (distSq < 1e-12f) {
+				result.overlap = true; //touching counts as overlapping, EPA sorts out the depth
+				break;
+			}
+			//rounding stalled it
+			if (distSq >= lastDistSq) break;
+			lastDistSq = distSq;
+
+			SimplexVertex n = makeVertex(a, b, a.support(-v), b.support(v));
+			bool repeat = false;
+			for (uint32_t k = 0; k < s.count; k++) repeat |= s.v[k].indexA == n.indexA && s.v[k].indexB == n.indexB;
+			//nothing further towards the origin than v itself, v is the closest point
+			if (repeat || distSq - glm::dot(v, n.w) <= 1e-6f * distSq) break;
+			s.v[s.count++] = n;
+		}
+
+		cache.indexA = cache.indexB = 0xFFFFFFFFu;
+		for (uint32_t k = 0; k < s.count; k++) {
+			cache.indexA = (cache.indexA & ~(0xFFu << (k * 8))) | (s.v[k].indexA << (k * 8));
+			cache.indexB = (cache.indexB & ~(0xFFu << (k * 8))) | (s.v[k].indexB << (k * 8));
+		}
+		if (result.overlap) return result;
+
+		result.pointA = result.pointB = glm::vec3{ 0.f };
+		for (uint32_t k = 0; k < s.count; k++) {
+			result.pointA += s.v[k].a * s.weight[k];
+			result.pointB += s.v[k].b * s.weight[k];
+		}
+		result.distance = glm::length(result.pointA - result.pointB);
+		return result;
+	}
+
+	//EPA
+
+	struct EpaFace {
+		uint32_t v[3];
+		glm::vec3 normal;
+		float distance; //of the origin behind the face
+		bool alive;
+	};
+
+	bool epa(const ConvexShape& a, const ConvexShape& b, const Simplex& simplex, glm::vec3& normal, float& depth, glm::vec3& pointA, glm::vec3& pointB) {
+		constexpr uint32_t maxVertices = 64, maxFaces = 128;
+		constexpr float tolerance = 1e-4f;
+		SimplexVertex vertices[maxVertices];
+		EpaFace faces[maxFaces];
+		uint32_t vertexCount = simplex.count, faceCount = 0;
+		std::copy(simplex.v, simplex.v + simplex.count, vertices);
+		auto support = [&](const glm::vec3& d) { return makeVertex(a, b, a.support(d), b.support(-d)); };
+
+		//grow what GJK ended with into a tetrahedron
+		if (vertexCount == 1) {
+			const glm::vec3 axes[6] = { { 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f } };
+			for (const glm::vec3& axis : axes) {
+				SimplexVertex v = support(axis);
+				if (glm::length(v.w - vertices[0].w) > tolerance) {
+					vertices[vertexCount++] = v;
+					break;
+				}
+			}
+		}
+		if (vertexCount == 2) {
+			const glm::vec3 line = glm::normalize(vertices[1].w - vertices[0].w);
+			const glm::vec3 axis = std::abs(line.x) < 0.57f ? glm::vec3{ 1.f, 0.f, 0.f } : glm::vec3{ 0.f, 1.f, 0.f };
+			const glm::vec3 perp = glm::normalize(glm::cross(line, axis));
+			//around the line in 60 degree steps until something sticks out of it
+			for (int k = 0; k < 6; k++) {
+				const float angle = k * 1.0471976f;
+				SimplexVertex v = support(perp * std::cos(angle) + glm::cross(line, perp) * std::sin(angle));
+				if (glm::length(glm::cross(v.w - vertices[0].w, line)) > tolerance) {
+					vertices[vertexCount++] = v;
+					break;
+				}
+			}
+		}
+		if (vertexCount == 3) {
+			const glm::vec3 n = glm::normalize(glm::cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w));
+			for (const glm::vec3& d : { n, -n }) {
+				SimplexVertex v = support(d);
+				if (std::abs(glm::dot(v.w - vertices[0].w, n)) > tolerance) {
+					vertices[vertexCount++] = v;
+					break;
+				}
+			}
+		}
+		if (vertexCount < 4) return false; //the difference is flat, the shapes only touch
+
+		auto addFace = [&](uint32_t i, uint32_t j, uint32_t k) {
+			EpaFace& f = faces[faceCount++];
+			f.v[0] = i;
+			f.v[1] = j;
+			f.v[2] = k;
+			glm::vec3 n = glm::cross(vertices[j].w - vertices[i].w, vertices[k].w - vertices[i].w);
+			float length = glm::length(n);
+			f.normal = length > 1e-20f ? n / length : glm::vec3{ 0.f };
+			f.distance = glm::dot(f.normal, vertices[i].w);
+			f.alive = length > 1e-20f;
+		};
+		const uint32_t start[4][4] = { { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 3, 1 }, { 1, 2, 3, 0 } };
+		for (const auto& f : start) {
+			addFace(f[0], f[1], f[2]);
+			//wind it away from the fourth corner
+			if (glm::dot(faces[faceCount - 1].normal, vertices[f[3]].w) > faces[faceCount - 1].distance) {
+				faceCount--;
+				addFace(f[0], f[2], f[1]);
+			}
+		}
+
+		std::pair<uint32_t, uint32_t> horizon[maxFaces * 3];
+		uint32_t closest = 0;
+		for (int iteration = 0; iteration < 64; iteration++) {
+			float best = FLT_MAX;
+			for (uint32_t f = 0; f < faceCount; f++) {
+				if (faces[f].alive && faces[f].distance < best) {
+					best = faces[f].distance;
+					closest = f;
+				}
+			}
+			if (best == FLT_MAX) return false;
+
+			const EpaFace& face = faces[closest];
+			SimplexVertex v = support(face.normal);
+			if (glm::dot(v.w, face.normal) - face.distance < tolerance || vertexCount == maxVertices) break;
+
+			//drop the faces the new point sees, the edges around the hole are the ones only one removed face had
+			uint32_t horizonCount = 0;
+			for (uint32_t f = 0; f < faceCount; f++) {
+				if (!faces[f].alive || glm::dot(faces[f].normal, v.w - vertices[faces[f].v[0]].w) <= 0.f) continue;
+				faces[f].alive = false;
+				for (int k = 0; k < 3; k++) {
+					const uint32_t i = faces[f].v[k], j = faces[f].v[(k + 1) % 3];
+					auto reverse = std::find(horizon, horizon + horizonCount, std::make_pair(j, i));
+					if (reverse != horizon + horizonCount) *reverse = horizon[--horizonCount];
+					else horizon[horizonCount++] = { i, j };
+				}
+			}
+
+			//make room by packing the live faces together
+			if (faceCount + horizonCount > maxFaces) {
+				uint32_t kept = 0;
+				for (uint32_t f = 0; f < faceCount; f++) if (faces[f].alive) faces[kept++] = faces[f];
+				faceCount = kept;
+				if (faceCount + horizonCount > maxFaces) break;
+			}
+			const uint32_t index = vertexCount;
+			vertices[vertexCount++] = v;
+			for (uint32_t e = 0; e < horizonCount; e++) addFace(horizon[e].first, horizon[e].second, index);
+		}
+
+		const EpaFace& face = faces[closest];
+		normal = face.normal;
+		depth = std::max(face.distance, 0.f);
+
+		//barycentric weights of the origin's projection on the face give the deepest points of each shape
+		const glm::vec3 p = normal * face.distance;
+		const glm::vec3 w0 = vertices[face.v[0]].w;
+		const glm::vec3 e1 = vertices[face.v[1]].w - w0, e2 = vertices[face.v[2]].w - w0, ep = p - w0;
+		const float d11 = glm::dot(e1, e1), d12 = glm::dot(e1, e2), d22 = glm::dot(e2, e2);
+		const float dp1 = glm::dot(ep, e1), dp2 = glm::dot(ep, e2);
+		const float denom = d11 * d22 - d12 * d12;
+		float v = 0.f, w = 0.f;
+		if (std::abs(denom) > 1e-20f) {
+			v = (d22 * dp1 - d12 * dp2) / denom;
+			w = (d11 * dp2 - d12 * dp1) / denom;
+		}
+		const float u = 1.f - v - w;
+		pointA = vertices[face.v[0]].a * u + vertices[face.v[1]].a * v + vertices[face.v[2]].a * w;
+		pointB = vertices[face.v[0]].b * u + vertices[face.v[1]].b * v + vertices[face.v[2]].b * w;
+		return true;
+	}
+
+	//contact points
+
+	struct ConvexClipVertex {
+		glm::vec3 position;
+		uint32_t feature; //0-31 incident corner, 64 and up the crossing of a polygon edge with a side plane
+		uint32_t edge; //line the vertex lies on for what comes after it: 0-31 incident edge, 32 and up side plane
+	};
+
+	static uint32_t clipAgainst(const ConvexClipVertex* in, uint32_t count, ConvexClipVertex* out, const glm::vec3& normal, float offset, uint32_t plane) {
+		uint32_t outCount = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			const ConvexClipVertex& p = in[i];
+			const ConvexClipVertex& q = in[(i + 1) % count];
+			const float dp = glm::dot(p.position, normal) - offset;
+			const float dq = glm::dot(q.position, normal) - offset;
+			if (dp <= 0.f) out[outCount++] = p;
+			if ((dp <= 0.f) != (dq <= 0.f)) {
+				ConvexClipVertex v;
+				v.position = p.position + (q.position - p.position) * (dp / (dp - dq));
+				v.feature = 64 + p.edge * 64 + plane;
+				v.edge = dp <= 0.f ? 32 + plane : p.edge;
+				out[outCount++] = v;
+			}
+		}
+		return outCount;
+	}
+
+	//the face of shape pointing most along direction, and how much
+	static uint32_t alignedFace(const ConvexShape& shape, const glm::vec3& direction, float& alignment) {
+		const glm::vec3 local = glm::transpose(shape.rotation) * direction;
+		uint32_t best = 0;
+		alignment = -FLT_MAX;
+		for (uint32_t f = 0; f < shape.faceCount; f++) {
+			float d = glm::dot(shape.faces[f].normal, local);
+			if (d > alignment) {
+				alignment = d;
+				best = f;
+			}
+		}
+		return best;
+	}
+
+	uint32_t clipContacts(const ConvexShape& a, const ConvexShape& b, const glm::vec3& normal, float margin, ConvexContact* out) {
+		if (a.faceCount == 0 || b.faceCount == 0) return 0;
+		//reference face: whichever shape has a face lined up better with the normal. the small bias towards A keeps the choice
+		//from flipping between steps when both fit about equally
+		float alignA, alignB;
+		const uint32_t faceA = alignedFace(a, normal, alignA);
+		const uint32_t faceB = alignedFace(b, -normal, alignB);
+		const bool referenceIsA = alignA >= alignB - 1e-3f;
+		const ConvexShape& ref = referenceIsA ? a : b;
+		const ConvexShape& inc = referenceIsA ? b : a;
+		const uint32_t refFace = referenceIsA ? faceA : faceB;
+		const HullFace& rf = ref.faces[refFace];
+		const glm::vec3 refNormal = ref.rotation * rf.normal;
+		const float refOffset = glm::dot(refNormal, ref.position) + rf.offset;
+
+		float unused;
+		const uint32_t incFace = alignedFace(inc, -refNormal, unused);
+		const HullFace& f = inc.faces[incFace];
+
+		//every side plane can add one vertex
+		constexpr uint32_t capacity = ConvexHull::maxFaceVertices * 2;
+		ConvexClipVertex polygon[capacity], clipped[capacity];
+		uint32_t count = std::min<uint32_t>(f.count, ConvexHull::maxFaceVertices);
+		for (uint32_t k = 0; k < count; k++) polygon[k] = { inc.vertex(inc.faceIndices[f.first + k]), k, k };
+
+		const uint32_t sides = std::min<uint32_t>(rf.count, ConvexHull::maxFaceVertices);
+		for (uint32_t side = 0; side < sides && count > 0; side++) {
+			const glm::vec3 p0 = ref.vertex(ref.faceIndices[rf.first + side]);
+			const glm::vec3 p1 = ref.vertex(ref.faceIndices[rf.first + (side + 1) % rf.count]);
+			//the face winds counter clockwise around its normal, so edge x normal points out of the face
+			const glm::vec3 sideNormal = glm::cross(p1 - p0, refNormal);
+			if (count + 1 > capacity) break;
+			count = clipAgainst(polygon, count, clipped, sideNormal, glm::dot(sideNormal, p0), side);
+			std::copy(clipped, clipped + count, polygon);
+		}
+
+		uint32_t found = 0;
+		for (uint32_t k = 0; k < count; k++) {
+			const float separation = glm::dot(polygon[k].position, refNormal) - refOffset;
+			if (separation > margin) continue;
+			ConvexContact& c = out[found++];
+			c.point = polygon[k].position - refNormal * (separation * 0.5f);
+			c.penetration = -separation;
+			c.id = ((refFace & 0xFF) << 24) | ((incFace & 0xFF) << 16) | (referenceIsA ? 0u : 0x8000u) | (polygon[k].feature & 0x7FFF);
+		}
+		return found;
+	}
+
+	bool rayConvex(const ConvexShape& shape, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t, glm::vec3& normal) {
+		//the ray is inside every face's half space between entering the last one and leaving the first one
+		float enter = 0.f, exit = maxDistance;
+		int enterFace = -1;
+		for (uint32_t f = 0; f < shape.faceCount; f++) {
+			const glm::vec3 n = shape.rotation * shape.faces[f].normal;
+			const float distance = glm::dot(n, origin) - (glm::dot(n, shape.position) + shape.faces[f].offset);
+			const float speed = glm::dot(n, direction);
+			if (std::abs(speed) < 1e-12f) {
+				if (distance > 0.f) return false; //parallel to this face and outside it
+				continue;
+			}
+			const float at = -distance / speed;
+			if (speed < 0.f) {
+				if (at > enter) {
+					enter = at;
+					enterFace = static_cast<int>(f);
+				}
+			}
+			else {
+				exit = std::min(exit, at);
+			}
+			if (enter > exit) return false;
+		}
+		t = enter;
+		normal = enterFace < 0 ? -direction : shape.rotation * shape.faces[enterFace].normal;
+		return true;
+	}
+}
@@ -0,0 +1,119 @@
+//convex hull shapes and the generic convex collision routines used for them: quickhull to build a hull from a model's vertices,
+//GJK for overlap and distance, EPA for penetration and face clipping for the contact points.
+//boxes and spheres go through the same routines when they meet a hull, a sphere being a point with a radius
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace mve {
+	//a polygon of a hull. its corners are faceIndices[first, first + count), counter clockwise seen from outside
+	struct HullFace {
+		glm::vec3 normal; //outward, unit length
+		float offset; //dot(normal, p) of the face plane
+		uint16_t first;
+		uint16_t count;
+	};
+
+	//convex polyhedron in the local space of the body it is attached to
+	struct ConvexHull {
+		static constexpr uint32_t maxVertices = 255; //GJK caches vertex indices in a byte
+		static constexpr uint32_t maxFaceVertices = 32; //coplanar triangles are only merged into polygons up to this size
+
+		std::vector<glm::vec3> vertices;
+		std::vector<HullFace> faces;
+		std::vector<uint16_t> faceIndices;
+		glm::vec3 center{ 0.f }; //of the local AABB
+		glm::vec3 halfSize{ 0.f };
+
+		//quickhull over points. every round adds the point furthest outside the hull so far, stopping at vertexLimit corners
+		//keeps the ones that matter most and the result stays inside the full hull. false if the points are flat or fewer than 4
+		static bool build(const std::vector<glm::vec3>& points, uint32_t vertexLimit, ConvexHull& out);
+	};
+
+	//eight corners and six faces of a box, for running a box through the hull routines
+	struct BoxPolytope {
+		glm::vec3 vertices[8];
+		HullFace faces[6];
+		explicit BoxPolytope(const glm::vec3& halfSize);
+	};
+
+	//a triangle as a polytope with a front and a back face, for running mesh triangles through the hull routines. world space
+	struct TrianglePolytope {
+		glm::vec3 vertices[3];
+		HullFace faces[2];
+		//the corners wind counter clockwise around the front normal, which is zero for a degenerate triangle
+		TrianglePolytope(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	};
+
+	//a hull, box or point placed in the world. the routines work on the core polytope and add radius on top, so a sphere is a
+	//single vertex with its radius
+	struct ConvexShape {
+		const glm::vec3* vertices = nullptr; //local space
+		uint32_t vertexCount = 0;
+		const HullFace* faces = nullptr; //none for a point
+		uint32_t faceCount = 0;
+		const uint16_t* faceIndices = nullptr;
+		glm::mat3 rotation{ 1.f };
+		glm::vec3 position{ 0.f };
+		float radius = 0.f;
+
+		static ConvexShape hull(const ConvexHull& hull, const glm::mat3& rotation, const glm::vec3& position);
+		static ConvexShape box(const BoxPolytope& box, const glm::mat3& rotation, const glm::vec3& position);
+		static ConvexShape triangle(const TrianglePolytope& triangle);
+		static ConvexShape sphere(const glm::vec3& center, float radius);
+
+		glm::vec3 vertex(uint32_t i) const { return rotation * vertices[i] + position; }
+		//index of the vertex furthest along the world direction
+		uint32_t support(const glm::vec3& direction) const;
+	};
+
+	//the simplex GJK finished with as vertex indices of both shapes, one byte per vertex and 0xFF for unused. starting the next
+	//run of the same pair from it usually finishes in one or two iterations since the shapes barely moved
+	struct GjkCache {
+		uint32_t indexA = 0xFFFFFFFFu;
+		uint32_t indexB = 0xFFFFFFFFu;
+	};
+
+	struct SimplexVertex {
+		glm::vec3 a, b; //support points on each shape
+		glm::vec3 w; //a - b, a point of the Minkowski difference
+		uint32_t indexA, indexB;
+	};
+
+	struct Simplex {
+		SimplexVertex v[4];
+		float weight[4]; //barycentric weights of the point closest to the origin
+		uint32_t count = 0;
+	};
+
+	struct GjkResult {
+		bool overlap; //the cores touch or overlap, distance and the points are 0 and meaningless then
+		float distance; //between the cores
+		glm::vec3 pointA, pointB; //closest points on the cores
+		Simplex simplex;
+	};
+
+	//distance between the cores of a and b. cache is read when it holds a simplex and written with the final one
+	GjkResult gjk(const ConvexShape& a, const ConvexShape& b, GjkCache& cache);
+
+	//how far the overlapping cores of a and b reach into each other, from the simplex gjk ended with.
+	//normal goes from a to b, pointA and pointB are the deepest points of each core. false if the overlap is too thin to measure
+	bool epa(const ConvexShape& a, const ConvexShape& b, const Simplex& simplex, glm::vec3& normal, float& depth, glm::vec3& pointA, glm::vec3& pointB);
+
+	struct ConvexContact {
+		glm::vec3 point; //halfway between the reference face and the incident point
+		float penetration; //negative for a point within the speculative margin
+		uint32_t id; //reference face, incident face and clip feature, stable while the shapes keep the same faces in contact
+	};
+
+	//clips the face of one polytope most opposed to the normal against the face of the other most aligned with it and keeps
+	//what is within margin of the reference face. out needs room for 2 * ConvexHull::maxFaceVertices points, returns how many
+	uint32_t clipContacts(const ConvexShape& a, const ConvexShape& b, const glm::vec3& normal, float margin, ConvexContact* out);
+
+	//first hit of the ray with the hull's faces. t and normal are 0 and -direction when the ray starts inside
+	bool rayConvex(const ConvexShape& shape, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t, glm::vec3& normal);
+}
@@ -0,0 +1,121 @@
+#include "mve_heightfield.h"
+
+#include <cfloat>
+
+namespace mve {
+	bool HeightField::build(const std::vector<float>& heights, uint32_t columns, uint32_t rows, float cellSize) {
+		*this = HeightField{};
+		if (columns < 2 || rows < 2 || heights.size() != static_cast<size_t>(columns) * rows || !(cellSize > 0.f)) return false;
+
+		float lowest = FLT_MAX, highest = -FLT_MAX;
+		for (float h : heights) {
+			lowest = std::min(lowest, h);
+			highest = std::max(highest, h);
+		}
+		sampleColumns = columns;
+		sampleRows = rows;
+		cell = cellSize;
+		originX = -0.5f * cellSize * (columns - 1);
+		originZ = -0.5f * cellSize * (rows - 1);
+		minHeight = lowest;
+		heightStep = (highest - lowest) / 65535.f;
+		samples.resize(heights.size());
+		for (size_t i = 0; i < heights.size(); i++) {
+			samples[i] = heightStep > 0.f ? static_cast<uint16_t>(std::lround((heights[i] - lowest) / heightStep)) : 0;
+		}
+		localBounds = { { originX, lowest, originZ }, { -originX, minHeight + 65535.f * heightStep, -originZ } };
+		return true;
+	}
+
+	void HeightField::triangle(uint32_t t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const {
+		const uint32_t cellIndex = t >> 1;
+		const uint32_t x = cellIndex % (sampleColumns - 1), z = cellIndex / (sampleColumns - 1);
+		//both wind counter clockwise seen from -y, the side that collides
+		if ((t & 1) == 0) {
+			a = corner(x, z);
+			b = corner(x + 1, z);
+			c = corner(x, z + 1);
+		}
+		else {
+			a = corner(x + 1, z);
+			b = corner(x + 1, z + 1);
+			c = corner(x, z + 1);
+		}
+	}
+
+	bool HeightField::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t, glm::vec3& normal) const {
+		if (samples.empty()) return false;
+		//the part of the ray inside the bounds, grown a little so a ray along a flat terrain or an edge isn't clipped away
+		const glm::vec3 pad{ cell * 1e-3f, std::max(heightStep, 1e-4f), cell * 1e-3f };
+		float enter = 0.f, exit = maxDistance;
+		for (int k = 0; k < 3; k++) {
+			if (std::abs(direction[k]) < 1e-12f) {
+				if (origin[k] < localBounds.min[k] - pad[k] || origin[k] > localBounds.max[k] + pad[k]) return false;
+				continue;
+			}
+			float t0 = (localBounds.min[k] - pad[k] - origin[k]) / direction[k];
+			float t1 = (localBounds.max[k] + pad[k] - origin[k]) / direction[k];
+			if (t0 > t1) std::swap(t0, t1);
+			enter = std::max(enter, t0);
+			exit = std::min(exit, t1);
+			if (enter > exit) return false;
+		}
+
+		//cell of the entry point, then one cell boundary crossing after the other along x or z, whichever comes first
+		const uint32_t cellColumns = sampleColumns - 1, cellRows = sampleRows - 1;
+		const glm::vec3 start = origin + direction * enter;
+		int x = static_cast<int>(glm::clamp(std::floor((start.x - originX) / cell), 0.f, static_cast<float>(cellColumns - 1)));
+		int z = static_cast<int>(glm::clamp(std::floor((start.z - originZ) / cell), 0.f, static_cast<float>(cellRows - 1)));
+		const int stepX = direction.x > 0.f ? 1 : -1, stepZ = direction.z > 0.f ? 1 : -1;
+		auto boundary = [&](float o, float d, float gridOrigin, int index, int step) {
+			if (std::abs(d) < 1e-12f) return FLT_MAX;
+			float edge = gridOrigin + (index + (step > 0 ? 1 : 0)) * cell;
+			return (edge - o) / d;
+		};
+		float nextX = boundary(origin.x, direction.x, originX, x, stepX);
+		float nextZ = boundary(origin.z, direction.z, originZ, z, stepZ);
+		const float deltaX = std::abs(direction.x) < 1e-12f ? FLT_MAX : cell / std::abs(direction.x);
+		const float deltaZ = std::abs(direction.z) < 1e-12f ? FLT_MAX : cell / std::abs(direction.z);
+
+		float cellEnter = enter;
+		while (cellEnter <= exit) {
+			const float cellExit = std::min(std::min(nextX, nextZ), exit);
+			//the ray's y over this cell against the cell's heights skips the triangle tests where it passes high above
+			const float y0 = origin.y + direction.y * cellEnter, y1 = origin.y + direction.y * cellExit;
+			const float top = std::min(std::min(height(x, z), height(x + 1, z)), std::min(height(x, z + 1), height(x + 1, z + 1)));
+			const float bottom = std::max(std::max(height(x, z), height(x + 1, z)), std::max(height(x, z + 1), height(x + 1, z + 1)));
+			if (std::max(y0, y1) >= top - pad.y && std::min(y0, y1) <= bottom + pad.y) {
+				//both triangles of a cell can be hit when the ray runs along the diagonal, the nearer one counts
+				float best = FLT_MAX;
+				const uint32_t first = 2 * (z * cellColumns + x);
+				for (uint32_t tri = first; tri < first + 2; tri++) {
+					glm::vec3 a, b, c;
+					triangle(tri, a, b, c);
+					float distance;
+					if (!rayTriangle(origin, direction, a, b, c, distance) || distance > maxDistance || distance >= best) continue;
+					best = distance;
+					normal = glm::normalize(glm::cross(b - a, c - a));
+				}
+				if (best != FLT_MAX) {
+					t = best;
+					return true;
+				}
+			}
+
+			if (nextX < nextZ) {
+				x += stepX;
+				if (x < 0 || x >= static_cast<int>(cellColumns)) return false;
+				cellEnter = nextX;
+				nextX += deltaX;
+			}
+			else {
+				if (nextZ == FLT_MAX) return false; //straight down a single cell
+				z += stepZ;
+				if (z < 0 || z >= static_cast<int>(cellRows)) return false;
+				cellEnter = nextZ;
+				nextZ += deltaZ;
+			}
+		}
+		return false;
+	}
+}
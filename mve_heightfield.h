@@ -0,0 +1,78 @@
+//terrain as a grid of heights instead of boxes or a triangle soup. every sample is 16 bits between the lowest and highest
+//height, so a 1025 x 1025 terrain is 2 MB, and a cell is only ever turned into its two triangles when something is over it
+
+#pragma once
+
+#include "mve_aabb_tree.h"
+#include "mve_mesh_collider.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace mve {
+	//the grid lies in the body's xz plane centered on its origin, a sample is the y of the surface there.
+	//+y is down like everywhere else, the ground is the +y side of the surface and only collides from the -y side
+	class HeightField {
+	public:
+		//heights[z * columns + x], at least 2 x 2 samples cellSize apart. false if the sizes don't fit
+		bool build(const std::vector<float>& heights, uint32_t columns, uint32_t rows, float cellSize);
+
+		bool empty() const { return samples.empty(); }
+		uint32_t columns() const { return sampleColumns; }
+		uint32_t rows() const { return sampleRows; }
+		float cellSize() const { return cell; }
+		//quantized height of a sample, within half a step of what it was built from
+		float height(uint32_t x, uint32_t z) const { return minHeight + samples[z * sampleColumns + x] * heightStep; }
+		const AABB& bounds() const { return localBounds; }
+		//corners of triangle t in body space, cell (x, z) holds triangles 2 * (z * (columns - 1) + x) and the one after
+		void triangle(uint32_t t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const;
+
+		//calls fn(triangle) for both triangles of every cell under box whose surface reaches into it, in body space
+		template<typename Fn>
+		void query(const AABB& box, Fn&& fn) const;
+		//first hit in body space walking the cells under the ray in order (2D DDA), either side counts. normal is the -y facing one
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t, glm::vec3& normal) const;
+
+	private:
+		glm::vec3 corner(uint32_t x, uint32_t z) const { return { originX + x * cell, height(x, z), originZ + z * cell }; }
+
+		std::vector<uint16_t> samples;
+		uint32_t sampleColumns = 0, sampleRows = 0;
+		float cell = 1.f;
+		float originX = 0.f, originZ = 0.f; //body space position of sample (0, 0)
+		float minHeight = 0.f;
+		float heightStep = 0.f; //height of one quantization step, 0 for flat terrain
+		AABB localBounds{ glm::vec3{ 0.f }, glm::vec3{ 0.f } };
+	};
+
+	template<typename Fn>
+	void HeightField::query(const AABB& box, Fn&& fn) const {
+		if (samples.empty() || !box.overlaps(localBounds)) return;
+		const uint32_t cellColumns = sampleColumns - 1, cellRows = sampleRows - 1;
+		auto cellRange = [&](float lo, float hi, float origin, uint32_t cells, uint32_t& first, uint32_t& last) {
+			first = static_cast<uint32_t>(glm::clamp(std::floor((lo - origin) / cell), 0.f, static_cast<float>(cells - 1)));
+			last = static_cast<uint32_t>(glm::clamp(std::floor((hi - origin) / cell), 0.f, static_cast<float>(cells - 1)));
+		};
+		uint32_t x0, x1, z0, z1;
+		cellRange(box.min.x, box.max.x, originX, cellColumns, x0, x1);
+		cellRange(box.min.z, box.max.z, originZ, cellRows, z0, z1);
+		//the box only reaches the ground of a cell if it goes past the cell's highest corner (smallest y)
+		const uint32_t reach = heightStep > 0.f ?
+			static_cast<uint32_t>(glm::clamp(std::floor((box.max.y - minHeight) / heightStep), -1.f, 65535.f) + 1.f) :
+			box.max.y >= minHeight;
+		for (uint32_t z = z0; z <= z1; z++) {
+			const uint16_t* row = samples.data() + z * sampleColumns;
+			for (uint32_t x = x0; x <= x1; x++) {
+				const uint32_t top = std::min(std::min(row[x], row[x + 1]), std::min(row[x + sampleColumns], row[x + sampleColumns + 1]));
+				if (top >= reach) continue;
+				const uint32_t first = 2 * (z * cellColumns + x);
+				fn(first);
+				fn(first + 1);
+			}
+		}
+	}
+}
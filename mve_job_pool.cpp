@@ -0,0 +1,74 @@
+#include "mve_job_pool.h"
+
+namespace mve {
+	JobPool::JobPool(uint32_t threadCount) {
+		for (uint32_t i = 1; i < threadCount; i++) {
+			workers.emplace_back([this] { workerLoop(); });
+		}
+	}
+
+	JobPool::~JobPool() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			quit = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	void JobPool::dispatch(uint32_t jobCount, JobFn fn, void* context) {
+		if (jobCount == 0) return;
+		//not worth waking anyone for a single job
+		if (workers.empty() || jobCount == 1) {
+			for (uint32_t i = 0; i < jobCount; i++) fn(context, i);
+			return;
+		}
+
+		{
+			//a worker that woke up late for the previous batch may still be inside drain(), let it leave before the batch changes
+			std::unique_lock<std::mutex> lock{ mutex };
+			finished.wait(lock, [this] { return workersInBatch == 0; });
+			batchFn = fn;
+			batchContext = context;
+			batchSize = jobCount;
+			nextJob.store(0, std::memory_order_relaxed);
+			generation++;
+		}
+		wake.notify_all();
+
+		drain();
+
+		//every job is claimed at this point, wait for workers still running one.
+		//a worker that never woke up for this batch will find nothing left to claim
+		std::unique_lock<std::mutex> lock{ mutex };
+		finished.wait(lock, [this] { return workersInBatch == 0; });
+	}
+
+	void JobPool::drain() {
+		uint32_t index;
+		while ((index = nextJob.fetch_add(1, std::memory_order_relaxed)) < batchSize) {
+			batchFn(batchContext, index);
+		}
+	}
+
+	void JobPool::workerLoop() {
+		uint64_t seenGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				wake.wait(lock, [&] { return quit || generation != seenGeneration; });
+				if (quit) return;
+				seenGeneration = generation;
+				workersInBatch++;
+			}
+
+			drain();
+
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				workersInBatch--;
+			}
+			finished.notify_all();
+		}
+	}
+}
@@ -0,0 +1,58 @@
+//a small fixed pool of worker threads for data parallel loops in the physics step
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mve {
+	class JobPool {
+	public:
+		//threadCount includes the calling thread, so JobPool(4) starts 3 workers
+		explicit JobPool(uint32_t threadCount);
+		~JobPool();
+
+		JobPool(const JobPool&) = delete;
+		JobPool& operator=(const JobPool&) = delete;
+
+		uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+		//calls job(index) for every index in [0, jobCount) spread over the workers and the calling thread.
+		//returns once every job has finished. jobs are claimed in order but may finish in any order,
+		//so anything that needs a fixed order should write into per-job outputs and merge afterwards
+		template<typename Job>
+		void run(uint32_t jobCount, Job&& job) {
+			using JobType = std::remove_reference_t<Job>;
+			//go through a plain function pointer so dispatching doesn't allocate a std::function
+			auto trampoline = [](void* context, uint32_t index) { (*static_cast<JobType*>(context))(index); };
+			dispatch(jobCount, trampoline, const_cast<void*>(static_cast<const void*>(&job)));
+		}
+
+	private:
+		using JobFn = void (*)(void*, uint32_t);
+
+		void dispatch(uint32_t jobCount, JobFn fn, void* context);
+		//claims and runs jobs of the current batch until none are left
+		void drain();
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake; //workers wait here for a new batch
+		std::condition_variable finished; //the caller waits here for workers to leave the batch
+		uint64_t generation = 0;
+		uint32_t workersInBatch = 0;
+		bool quit = false;
+
+		//current batch, only written under the mutex while no worker is draining
+		JobFn batchFn = nullptr;
+		void* batchContext = nullptr;
+		uint32_t batchSize = 0;
+		std::atomic<uint32_t> nextJob{ 0 };
+	};
+}
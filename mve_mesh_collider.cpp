@@ -0,0 +1,372 @@
+#include "mve_mesh_collider.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace mve {
+	//build
+
+	namespace {
+		struct BuildTriangle {
+			AABB bounds;
+			glm::vec3 centroid;
+			uint32_t source; //first index in the input index list
+		};
+
+		struct Bin {
+			AABB bounds{ glm::vec3{ FLT_MAX }, glm::vec3{ -FLT_MAX } };
+			uint32_t count = 0;
+		};
+
+		constexpr uint32_t binCount = 12;
+		constexpr uint32_t targetLeafTriangles = 4; //below this a leaf is never split
+		constexpr uint32_t maxSahDepth = 48; //past this ranges are split at the median, bounding how deep the tree gets
+		constexpr float traversalCost = 1.f; //relative to testing one triangle
+
+		struct Builder {
+			std::vector<BuildTriangle>& triangles;
+			std::vector<MeshBvhNode>& nodes;
+			std::vector<AABB>& bounds; //float bounds of every node, quantized once the tree is done
+
+			void build(uint32_t begin, uint32_t end, uint32_t depth) {
+				AABB box{ glm::vec3{ FLT_MAX }, glm::vec3{ -FLT_MAX } };
+				AABB centroids{ glm::vec3{ FLT_MAX }, glm::vec3{ -FLT_MAX } };
+				for (uint32_t i = begin; i < end; i++) {
+					box = AABB::combine(box, triangles[i].bounds);
+					centroids.min = glm::min(centroids.min, triangles[i].centroid);
+					centroids.max = glm::max(centroids.max, triangles[i].centroid);
+				}
+				const uint32_t index = static_cast<uint32_t>(nodes.size());
+				nodes.push_back({});
+				bounds.push_back(box);
+				const uint32_t count = end - begin;
+
+				uint32_t mid = split(begin, end, depth, box, centroids);
+				if (mid == begin) {
+					nodes[index].index = begin << 3 | count;
+					return;
+				}
+				build(begin, mid, depth + 1);
+				nodes[index].index = static_cast<uint32_t>(nodes.size()) << 3;
+				build(mid, end, depth + 1);
+			}
+
+			//where to split [begin, end) after partitioning it, or begin to make it a leaf
+			uint32_t split(uint32_t begin, uint32_t end, uint32_t depth, const AABB& box, const AABB& centroids) {
+				const uint32_t count = end - begin;
+				if (count <= targetLeafTriangles && count <= TriangleMesh::maxLeafTriangles) return begin;
+				const glm::vec3 extent = centroids.max - centroids.min;
+				int axis = 0;
+				if (extent.y > extent[axis]) axis = 1;
+				if (extent.z > extent[axis]) axis = 2;
+
+				if (depth < maxSahDepth && extent[axis] > 0.f) {
+					//binned SAH over every axis with centroids spread along it
+					float bestCost = FLT_MAX;
+					int bestAxis = -1;
+					uint32_t bestPlane = 0;
+					for (int k = 0; k < 3; k++) {
+						if (extent[k] <= 0.f) continue;
+						const float scale = binCount / extent[k];
+						Bin bins[binCount];
+						for (uint32_t i = begin; i < end; i++) {
+							uint32_t b = std::min(binCount - 1, static_cast<uint32_t>((triangles[i].centroid[k] - centroids.min[k]) * scale));
+							bins[b].count++;
+							bins[b].bounds = AABB::combine(bins[b].bounds, triangles[i].bounds);
+						}
+						//areas of everything left of each plane sweeping forwards, right of it sweeping backwards
+						float leftArea[binCount - 1];
+						uint32_t leftCount[binCount - 1];
+						Bin sweep;
+						for (uint32_t p = 0; p < binCount - 1; p++) {
+							sweep.count += bins[p].count;
+							sweep.bounds = AABB::combine(sweep.bounds, bins[p].bounds);
+							leftCount[p] = sweep.count;
+							leftArea[p] = sweep.count > 0 ? sweep.bounds.area() : 0.f;
+						}
+						sweep = Bin{};
+						for (uint32_t p = binCount - 1; p > 0; p--) {
+							sweep.count += bins[p].count;
+							sweep.bounds = AABB::combine(sweep.bounds, bins[p].bounds);
+							if (leftCount[p - 1] == 0 || sweep.count == 0) continue;
+							float cost = leftArea[p - 1] * leftCount[p - 1] + sweep.bounds.area() * sweep.count;
+							if (cost < bestCost) {
+								bestCost = cost;
+								bestAxis = k;
+								bestPlane = p;
+							}
+						}
+					}
+
+					const float area = box.area();
+					const float splitCost = traversalCost + (area > 0.f ? bestCost / area : static_cast<float>(count));
+					if (bestAxis >= 0 && (count > TriangleMesh::maxLeafTriangles || splitCost < static_cast<float>(count))) {
+						const float scale = binCount / extent[bestAxis];
+						const float minimum = centroids.min[bestAxis];
+						auto middle = std::partition(triangles.begin() + begin, triangles.begin() + end, [&](const BuildTriangle& t) {
+							return std::min(binCount - 1, static_cast<uint32_t>((t.centroid[bestAxis] - minimum) * scale)) < bestPlane;
+						});
+						return static_cast<uint32_t>(middle - triangles.begin());
+					}
+				}
+
+				if (count <= TriangleMesh::maxLeafTriangles) return begin;
+				//too deep or every centroid in the same spot, halve by position along the widest axis (or by order when they coincide)
+				const uint32_t mid = begin + count / 2;
+				std::nth_element(triangles.begin() + begin, triangles.begin() + mid, triangles.begin() + end,
+					[axis](const BuildTriangle& a, const BuildTriangle& b) { return a.centroid[axis] < b.centroid[axis]; });
+				return mid;
+			}
+		};
+	}
+
+	bool TriangleMesh::build(const std::vector<glm::vec3>& sourceVertices, const std::vector<uint32_t>& sourceIndices) {
+		vertices.clear();
+		indices.clear();
+		nodes.clear();
+
+		std::vector<BuildTriangle> triangles;
+		triangles.reserve(sourceIndices.size() / 3);
+		for (size_t i = 0; i + 2 < sourceIndices.size(); i += 3) {
+			if (sourceIndices[i] >= sourceVertices.size() || sourceIndices[i + 1] >= sourceVertices.size() || sourceIndices[i + 2] >= sourceVertices.size()) continue;
+			const glm::vec3& a = sourceVertices[sourceIndices[i]];
+			const glm::vec3& b = sourceVertices[sourceIndices[i + 1]];
+			const glm::vec3& c = sourceVertices[sourceIndices[i + 2]];
+			glm::vec3 n = glm::cross(b - a, c - a);
+			if (glm::dot(n, n) <= 1e-20f) continue;
+			BuildTriangle t;
+			t.bounds = { glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)) };
+			t.centroid = (a + b + c) / 3.f;
+			t.source = static_cast<uint32_t>(i);
+			triangles.push_back(t);
+		}
+		if (triangles.empty()) return false;
+
+		std::vector<AABB> bounds;
+		nodes.reserve(triangles.size() / 2);
+		bounds.reserve(triangles.size() / 2);
+		Builder builder{ triangles, nodes, bounds };
+		builder.build(0, static_cast<uint32_t>(triangles.size()), 0);
+
+		//triangles in leaf order, so a leaf reads one run of the index list. vertices are copied as they are
+		vertices = sourceVertices;
+		indices.resize(triangles.size() * 3);
+		for (size_t t = 0; t < triangles.size(); t++) {
+			for (int k = 0; k < 3; k++) indices[t * 3 + k] = sourceIndices[triangles[t].source + k];
+		}
+
+		meshBounds = bounds[0];
+		const glm::vec3 size = meshBounds.max - meshBounds.min;
+		for (int k = 0; k < 3; k++) quantizeScale[k] = size[k] > 0.f ? 65535.f / size[k] : 0.f;
+		//same arithmetic as query, so a node and a box that touch in floats still touch after rounding
+		for (size_t i = 0; i < nodes.size(); i++) {
+			for (int k = 0; k < 3; k++) {
+				float lo = (bounds[i].min[k] - meshBounds.min[k]) * quantizeScale[k];
+				float hi = (bounds[i].max[k] - meshBounds.min[k]) * quantizeScale[k];
+				nodes[i].min[k] = static_cast<uint16_t>(glm::clamp(std::floor(lo), 0.f, 65535.f));
+				nodes[i].max[k] = static_cast<uint16_t>(glm::clamp(std::ceil(hi), 0.f, 65535.f));
+			}
+		}
+		return true;
+	}
+
+	//serialization
+
+	static constexpr uint32_t meshMagic = 0x4D54564D; //"MVTM"
+	static constexpr uint32_t meshVersion = 2; //2: source key
+
+	void TriangleMesh::serialize(std::vector<uint8_t>& out) const {
+		const uint32_t header[7] = { meshMagic, meshVersion, static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(nodes.size()),
+			static_cast<uint32_t>(source), static_cast<uint32_t>(source >> 32) };
+		const size_t sizes[6] = { sizeof(header), sizeof(AABB), sizeof(glm::vec3),
+			vertices.size() * sizeof(glm::vec3), indices.size() * sizeof(uint32_t), nodes.size() * sizeof(MeshBvhNode) };
+		const void* parts[6] = { header, &meshBounds, &quantizeScale, vertices.data(), indices.data(), nodes.data() };
+		size_t total = 0;
+		for (size_t size : sizes) total += size;
+		out.resize(total);
+		size_t offset = 0;
+		for (int i = 0; i < 6; i++) {
+			if (sizes[i] > 0) std::memcpy(out.data() + offset, parts[i], sizes[i]);
+			offset += sizes[i];
+		}
+	}
+
+	bool TriangleMesh::deserialize(const uint8_t* data, size_t size) {
+		*this = TriangleMesh{};
+		uint32_t header[7];
+		if (size < sizeof(header) + sizeof(AABB) + sizeof(glm::vec3)) return false;
+		std::memcpy(header, data, sizeof(header));
+		if (header[0] != meshMagic || header[1] != meshVersion) return false;
+		const uint64_t vertexCount = header[2], indexCount = header[3], nodeCount = header[4];
+		if (indexCount == 0 || indexCount % 3 != 0 || nodeCount == 0) return false;
+		const uint64_t expected = sizeof(header) + sizeof(AABB) + sizeof(glm::vec3) +
+			vertexCount * sizeof(glm::vec3) + indexCount * sizeof(uint32_t) + nodeCount * sizeof(MeshBvhNode);
+		if (size != expected) return false;
+
+		TriangleMesh mesh;
+		mesh.source = header[5] | static_cast<uint64_t>(header[6]) << 32;
+		size_t offset = sizeof(header);
+		std::memcpy(&mesh.meshBounds, data + offset, sizeof(AABB));
+		offset += sizeof(AABB);
+		std::memcpy(&mesh.quantizeScale, data + offset, sizeof(glm::vec3));
+		offset += sizeof(glm::vec3);
+		mesh.vertices.resize(vertexCount);
+		if (vertexCount > 0) std::memcpy(mesh.vertices.data(), data + offset, vertexCount * sizeof(glm::vec3));
+		offset += vertexCount * sizeof(glm::vec3);
+		mesh.indices.resize(indexCount);
+		std::memcpy(mesh.indices.data(), data + offset, indexCount * sizeof(uint32_t));
+		offset += indexCount * sizeof(uint32_t);
+		mesh.nodes.resize(nodeCount);
+		std::memcpy(mesh.nodes.data(), data + offset, nodeCount * sizeof(MeshBvhNode));
+
+		//a damaged file shouldn't be able to send a query out of bounds or loop it
+		for (uint32_t index : mesh.indices) {
+			if (index >= vertexCount) return false;
+		}
+		const uint32_t triangles = mesh.triangleCount();
+		std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0u, 0u } };
+		while (!stack.empty()) {
+			auto [index, depth] = stack.back();
+			stack.pop_back();
+			const MeshBvhNode& node = mesh.nodes[index];
+			if (node.isLeaf()) {
+				if (node.offset() + node.count() > triangles) return false;
+				continue;
+			}
+			if (depth + 2 >= 128 || index + 1 >= nodeCount || node.offset() <= index + 1 || node.offset() >= nodeCount) return false;
+			stack.push_back({ index + 1, depth + 1 });
+			stack.push_back({ node.offset(), depth + 1 });
+		}
+		*this = std::move(mesh);
+		return true;
+	}
+
+	bool TriangleMesh::saveToFile(const std::string& path) const {
+		std::vector<uint8_t> data;
+		serialize(data);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return file.good();
+	}
+
+	bool TriangleMesh::loadFromFile(const std::string& path) {
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) return false;
+		std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!file) return false;
+		return deserialize(data.data(), data.size());
+	}
+
+	//queries
+
+	glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		//which voronoi region of the triangle p falls in: a corner, an edge or the face
+		const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.f && d2 <= 0.f) return a;
+		const glm::vec3 bp = p - b;
+		const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.f && d4 <= d3) return b;
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) return a + ab * (d1 / (d1 - d3));
+		const glm::vec3 cp = p - c;
+		const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.f && d5 <= d6) return c;
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) return a + ac * (d2 / (d2 - d6));
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		const float denom = 1.f / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	bool rayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t) {
+		const glm::vec3 e1 = b - a, e2 = c - a;
+		const glm::vec3 p = glm::cross(direction, e2);
+		const float det = glm::dot(e1, p);
+		if (std::abs(det) < 1e-12f) return false; //parallel to the plane
+		const float invDet = 1.f / det;
+		const glm::vec3 s = origin - a;
+		const float u = glm::dot(s, p) * invDet;
+		if (u < 0.f || u > 1.f) return false;
+		const glm::vec3 q = glm::cross(s, e1);
+		const float v = glm::dot(direction, q) * invDet;
+		if (v < 0.f || u + v > 1.f) return false;
+		t = glm::dot(e2, q) * invDet;
+		return t >= 0.f;
+	}
+
+	AABB TriangleMesh::nodeBounds(const MeshBvhNode& node) const {
+		AABB box = meshBounds;
+		for (int k = 0; k < 3; k++) {
+			if (quantizeScale[k] == 0.f) continue;
+			box.min[k] = meshBounds.min[k] + node.min[k] / quantizeScale[k];
+			box.max[k] = meshBounds.min[k] + node.max[k] / quantizeScale[k];
+		}
+		//the division rounds either way, a hair of padding keeps a ray grazing a triangle from missing its node
+		const glm::vec3 pad = (meshBounds.max - meshBounds.min) * 1e-5f + 1e-6f;
+		return { box.min - pad, box.max + pad };
+	}
+
+	//entry distance of the ray into box, FLT_MAX on a miss
+	static float raySlab(const AABB& box, const glm::vec3& origin, const glm::vec3& inverse, float maxDistance) {
+		float tMin = 0.f, tMax = maxDistance;
+		for (int k = 0; k < 3; k++) {
+			float t0 = (box.min[k] - origin[k]) * inverse[k];
+			float t1 = (box.max[k] - origin[k]) * inverse[k];
+			if (t0 > t1) std::swap(t0, t1);
+			//a ray parallel to the slab gives nan from 0 * inf, which fails neither test and leaves the range alone
+			if (t0 > tMin) tMin = t0;
+			if (t1 < tMax) tMax = t1;
+			if (tMin > tMax) return FLT_MAX;
+		}
+		return tMin;
+	}
+
+	bool TriangleMesh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t, glm::vec3& normal) const {
+		if (nodes.empty()) return false;
+		const glm::vec3 inverse = 1.f / direction;
+		float best = maxDistance;
+		bool hit = false;
+
+		uint32_t stack[128];
+		uint32_t top = 0;
+		if (raySlab(nodeBounds(nodes[0]), origin, inverse, best) == FLT_MAX) return false;
+		stack[top++] = 0;
+		while (top > 0) {
+			const uint32_t index = stack[--top];
+			const MeshBvhNode& node = nodes[index];
+			if (node.isLeaf()) {
+				for (uint32_t tri = node.offset(); tri < node.offset() + node.count(); tri++) {
+					glm::vec3 a, b, c;
+					triangle(tri, a, b, c);
+					float distance;
+					if (!rayTriangle(origin, direction, a, b, c, distance) || distance > best) continue;
+					best = distance;
+					normal = glm::normalize(glm::cross(b - a, c - a));
+					hit = true;
+				}
+				continue;
+			}
+			//nearer child on top of the stack so a close hit prunes the far one
+			const uint32_t left = index + 1, right = node.offset();
+			const float tLeft = raySlab(nodeBounds(nodes[left]), origin, inverse, best);
+			const float tRight = raySlab(nodeBounds(nodes[right]), origin, inverse, best);
+			if (tLeft <= tRight) {
+				if (tRight != FLT_MAX) stack[top++] = right;
+				if (tLeft != FLT_MAX) stack[top++] = left;
+			} else {
+				if (tLeft != FLT_MAX) stack[top++] = left;
+				stack[top++] = right;
+			}
+		}
+		if (hit) t = best;
+		return hit;
+	}
+}
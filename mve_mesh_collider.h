@@ -0,0 +1,111 @@
+//static triangle meshes for level geometry, each with its own bounding volume hierarchy over its triangles.
+//the BVH is built once with the surface area heuristic and keeps its bounds as 16 bit integers, and the whole mesh
+//serializes to a byte buffer so a level can load it prebuilt instead of building it on every start
+
+#pragma once
+
+#include "mve_aabb_tree.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mve {
+	//16 bytes. bounds are quantized against the mesh bounds and rounded outwards, so a node never gets smaller than what it holds.
+	//the left child of an inner node is the node right after it, only the right child is stored
+	struct MeshBvhNode {
+		uint16_t min[3];
+		uint16_t max[3];
+		uint32_t index; //low 3 bits: triangle count of a leaf or 0 for an inner node. the rest: first triangle or right child
+
+		bool isLeaf() const { return (index & 7) != 0; }
+		uint32_t count() const { return index & 7; }
+		uint32_t offset() const { return index >> 3; }
+	};
+
+	//closest point of triangle abc to p, Real-Time Collision Detection (Ericson) 5.1.5
+	glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	//Moller-Trumbore from either side. t is along direction, which doesn't need to be unit length
+	bool rayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t);
+
+	class TriangleMesh {
+	public:
+		static constexpr uint32_t maxLeafTriangles = 7; //what fits in the count bits, the SAH picks smaller leaves when they pay off
+
+		//triangle k is indices[3k], indices[3k + 1], indices[3k + 2], counter clockwise seen from the side that collides.
+		//degenerate triangles are dropped, false if none are left
+		bool build(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices);
+
+		//whatever the caller built the mesh from, e.g. a hash of the source file and the scale baked into the vertices. it is saved
+		//with the mesh so a cached file can be checked against its source before it is used, 0 until set
+		uint64_t sourceKey() const { return source; }
+		void setSourceKey(uint64_t key) { source = key; }
+
+		//the built mesh as bytes, out is overwritten
+		void serialize(std::vector<uint8_t>& out) const;
+		//false, leaving the mesh empty, if data isn't a mesh serialized by this version
+		bool deserialize(const uint8_t* data, size_t size);
+		bool saveToFile(const std::string& path) const;
+		bool loadFromFile(const std::string& path);
+
+		bool empty() const { return nodes.empty(); }
+		uint32_t triangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+		uint32_t nodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+		const AABB& bounds() const { return meshBounds; }
+		//corners of triangle t in mesh space. triangles are numbered in BVH leaf order, not in the order they were built from
+		void triangle(uint32_t t, glm::vec3& a, glm::vec3& b, glm::vec3& c) const {
+			a = vertices[indices[t * 3]];
+			b = vertices[indices[t * 3 + 1]];
+			c = vertices[indices[t * 3 + 2]];
+		}
+
+		//calls fn(triangle) for every triangle in a leaf whose bounds overlap box, in mesh space
+		template<typename Fn>
+		void query(const AABB& box, Fn&& fn) const;
+		//closest hit in mesh space, either side of a triangle counts. normal is the triangle's front normal
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t, glm::vec3& normal) const;
+
+	private:
+		AABB nodeBounds(const MeshBvhNode& node) const;
+
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t> indices; //3 per triangle in leaf order
+		std::vector<MeshBvhNode> nodes; //depth first, the root is nodes[0]
+		AABB meshBounds{ glm::vec3{ 0.f }, glm::vec3{ 0.f } };
+		glm::vec3 quantizeScale{ 0.f }; //65535 / size of the bounds per axis, 0 for a flat axis
+		uint64_t source = 0;
+	};
+
+	template<typename Fn>
+	void TriangleMesh::query(const AABB& box, Fn&& fn) const {
+		if (nodes.empty() || !box.overlaps(meshBounds)) return;
+		//the query box quantized outwards once, every node is then tested on integers
+		uint16_t qMin[3], qMax[3];
+		for (int k = 0; k < 3; k++) {
+			float lo = (box.min[k] - meshBounds.min[k]) * quantizeScale[k];
+			float hi = (box.max[k] - meshBounds.min[k]) * quantizeScale[k];
+			qMin[k] = static_cast<uint16_t>(glm::clamp(std::floor(lo), 0.f, 65535.f));
+			qMax[k] = static_cast<uint16_t>(glm::clamp(std::ceil(hi), 0.f, 65535.f));
+		}
+
+		//the build caps the depth well below this
+		uint32_t stack[128];
+		uint32_t top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const uint32_t index = stack[--top];
+			const MeshBvhNode& node = nodes[index];
+			if (node.min[0] > qMax[0] || node.max[0] < qMin[0] ||
+				node.min[1] > qMax[1] || node.max[1] < qMin[1] ||
+				node.min[2] > qMax[2] || node.max[2] < qMin[2]) continue;
+			if (node.isLeaf()) {
+				for (uint32_t t = node.offset(); t < node.offset() + node.count(); t++) fn(t);
+				continue;
+			}
+			stack[top++] = node.offset();
+			stack[top++] = index + 1;
+		}
+	}
+}
@@ -1,446 +1,3688 @@
 #include "mve_physics.h"
+#include "mve_simd.h"
+
+#include <glm/gtx/euler_angles.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
 namespace mve {
-	PhysicsClass::PhysicsClass() {
+	void BodyStore::push(const RigidBody& body, uint32_t bodySlot) {
+		posX.push_back(body.position.x); posY.push_back(body.position.y); posZ.push_back(body.position.z);
+		velX.push_back(body.velocity.x); velY.push_back(body.velocity.y); velZ.push_back(body.velocity.z);
+		forceX.push_back(body.force.x); forceY.push_back(body.force.y); forceZ.push_back(body.force.z);
+		invMass.push_back(body.mass == 0.f ? 0.f : 1.f / body.mass);
+		mass.push_back(body.mass);
+		angVelX.push_back(body.angularVelocity.x); angVelY.push_back(body.angularVelocity.y); angVelZ.push_back(body.angularVelocity.z);
+		torqueX.push_back(body.torque.x); torqueY.push_back(body.torque.y); torqueZ.push_back(body.torque.z);
+		rotW.push_back(body.rotation.w); rotX.push_back(body.rotation.x); rotY.push_back(body.rotation.y); rotZ.push_back(body.rotation.z);
+		invInertiaX.push_back(0.f); invInertiaY.push_back(0.f); invInertiaZ.push_back(0.f); //set once the body has a collider
+		objId.push_back(body.objId);
+		sleepTimer.push_back(body.sleepTimer);
+		sleep.push_back(body.sleep);
+		island.push_back(0);
+		collidable.push_back(body.collidable);
+		continuous.push_back(body.continuous);
+		queryLayers.push_back(body.queryLayers);
+		slot.push_back(bodySlot);
+		boxCollider.push_back(noCollider);
+		sphereCollider.push_back(noCollider);
+		convexCollider.push_back(noCollider);
+		meshCollider.push_back(noCollider);
+		heightFieldCollider.push_back(noCollider);
+	}
+
+	void BodyStore::pop() {
+		posX.pop_back(); posY.pop_back(); posZ.pop_back();
+		velX.pop_back(); velY.pop_back(); velZ.pop_back();
+		forceX.pop_back(); forceY.pop_back(); forceZ.pop_back();
+		invMass.pop_back();
+		mass.pop_back();
+		angVelX.pop_back(); angVelY.pop_back(); angVelZ.pop_back();
+		torqueX.pop_back(); torqueY.pop_back(); torqueZ.pop_back();
+		rotW.pop_back(); rotX.pop_back(); rotY.pop_back(); rotZ.pop_back();
+		invInertiaX.pop_back(); invInertiaY.pop_back(); invInertiaZ.pop_back();
+		objId.pop_back();
+		sleepTimer.pop_back();
+		sleep.pop_back();
+		island.pop_back();
+		collidable.pop_back();
+		continuous.pop_back();
+		queryLayers.pop_back();
+		slot.pop_back();
+		boxCollider.pop_back();
+		sphereCollider.pop_back();
+		convexCollider.pop_back();
+		meshCollider.pop_back();
+		heightFieldCollider.pop_back();
+	}
+
+	void BodyStore::swap(uint32_t a, uint32_t b) {
+		if (a == b) return;
+		std::swap(posX[a], posX[b]); std::swap(posY[a], posY[b]); std::swap(posZ[a], posZ[b]);
+		std::swap(velX[a], velX[b]); std::swap(velY[a], velY[b]); std::swap(velZ[a], velZ[b]);
+		std::swap(forceX[a], forceX[b]); std::swap(forceY[a], forceY[b]); std::swap(forceZ[a], forceZ[b]);
+		std::swap(invMass[a], invMass[b]);
+		std::swap(mass[a], mass[b]);
+		std::swap(angVelX[a], angVelX[b]); std::swap(angVelY[a], angVelY[b]); std::swap(angVelZ[a], angVelZ[b]);
+		std::swap(torqueX[a], torqueX[b]); std::swap(torqueY[a], torqueY[b]); std::swap(torqueZ[a], torqueZ[b]);
+		std::swap(rotW[a], rotW[b]); std::swap(rotX[a], rotX[b]); std::swap(rotY[a], rotY[b]); std::swap(rotZ[a], rotZ[b]);
+		std::swap(invInertiaX[a], invInertiaX[b]); std::swap(invInertiaY[a], invInertiaY[b]); std::swap(invInertiaZ[a], invInertiaZ[b]);
+		std::swap(objId[a], objId[b]);
+		std::swap(sleepTimer[a], sleepTimer[b]);
+		std::swap(sleep[a], sleep[b]);
+		std::swap(island[a], island[b]);
+		std::swap(collidable[a], collidable[b]);
+		std::swap(continuous[a], continuous[b]);
+		std::swap(queryLayers[a], queryLayers[b]);
+		std::swap(slot[a], slot[b]);
+		std::swap(boxCollider[a], boxCollider[b]);
+		std::swap(sphereCollider[a], sphereCollider[b]);
+		std::swap(convexCollider[a], convexCollider[b]);
+		std::swap(meshCollider[a], meshCollider[b]);
+		std::swap(heightFieldCollider[a], heightFieldCollider[b]);
+	}
+
+	//moves v[order[k]] to v[k] in place by following the cycles of order, one element is held aside per cycle.
+	//visited is scratch that keeps its capacity, so a warmed up step doesn't allocate here
+	template<typename T>
+	static void permuteStream(std::vector<T>& v, const std::vector<uint32_t>& order, std::vector<uint8_t>& visited) {
+		visited.assign(order.size(), 0);
+		for (uint32_t start = 0; start < order.size(); start++) {
+			if (visited[start]) continue;
+			T first = std::move(v[start]);
+			uint32_t k = start;
+			while (order[k] != start) {
+				v[k] = std::move(v[order[k]]);
+				visited[k] = 1;
+				k = order[k];
+			}
+			v[k] = std::move(first);
+			visited[k] = 1;
+		}
+	}
+
+	void BodyStore::permute(const std::vector<uint32_t>& order, std::vector<uint8_t>& visited) {
+		permuteStream(posX, order, visited); permuteStream(posY, order, visited); permuteStream(posZ, order, visited);
+		permuteStream(velX, order, visited); permuteStream(velY, order, visited); permuteStream(velZ, order, visited);
+		permuteStream(forceX, order, visited); permuteStream(forceY, order, visited); permuteStream(forceZ, order, visited);
+		permuteStream(invMass, order, visited);
+		permuteStream(mass, order, visited);
+		permuteStream(angVelX, order, visited); permuteStream(angVelY, order, visited); permuteStream(angVelZ, order, visited);
+		permuteStream(torqueX, order, visited); permuteStream(torqueY, order, visited); permuteStream(torqueZ, order, visited);
+		permuteStream(rotW, order, visited); permuteStream(rotX, order, visited); permuteStream(rotY, order, visited); permuteStream(rotZ, order, visited);
+		permuteStream(invInertiaX, order, visited); permuteStream(invInertiaY, order, visited); permuteStream(invInertiaZ, order, visited);
+		permuteStream(objId, order, visited);
+		permuteStream(sleepTimer, order, visited);
+		permuteStream(sleep, order, visited);
+		permuteStream(island, order, visited);
+		permuteStream(collidable, order, visited);
+		permuteStream(continuous, order, visited);
+		permuteStream(queryLayers, order, visited);
+		permuteStream(slot, order, visited);
+		permuteStream(boxCollider, order, visited);
+		permuteStream(sphereCollider, order, visited);
+		permuteStream(convexCollider, order, visited);
+		permuteStream(meshCollider, order, visited);
+		permuteStream(heightFieldCollider, order, visited);
+	}
+
+	RigidBody BodyStore::get(uint32_t i) const {
+		RigidBody body;
+		body.position = position(i);
+		body.velocity = velocity(i);
+		body.angularVelocity = angularVelocity(i);
+		body.rotation = rotation(i);
+		body.force = force(i);
+		body.torque = torque(i);
+		body.objId = objId[i];
+		body.mass = mass[i];
+		body.sleepTimer = sleepTimer[i];
+		body.sleep = sleep[i] != 0;
+		body.collidable = collidable[i] != 0;
+		body.continuous = continuous[i] != 0;
+		body.queryLayers = queryLayers[i];
+		return body;
+	}
 
+	PhysicsClass::PhysicsClass(const PhysicsSettings& settings) 
+		: settings{ settings }, staticTree{ settings.treeMargin }, dynamicTree{ settings.treeMargin } {
+		if (settings.workerThreads > 1) {
+			jobPool = std::make_unique<JobPool>(settings.workerThreads);
+		}
 	}
 	PhysicsClass::~PhysicsClass() {
 	}
 	void PhysicsClass::step(float dt) {
+		using Clock = std::chrono::steady_clock;
+		auto since = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+		const Clock::time_point stepStart = Clock::now();
+
+		stepDt = dt;
+		Clock::time_point phase = Clock::now();
+		updateBodyAxes(); //torques need the world inertia
 		integrateForces(dt);
+		stats.integrateForcesMs = since(phase);
 
+		phase = Clock::now();
 		broadPhase();
+		awakeAtBroadphase = bodies.awakeCount;
+		stats.broadPhaseMs = since(phase);
 		
+		phase = Clock::now();
 		detectCollisions();
+		wakeTouchedIslands();
+		stats.detectCollisionsMs = since(phase);
+
+		phase = Clock::now();
 		resolveCollisions();
+		updateContactEvents(); //after solving so the events carry the impulses
+		stats.resolveCollisionsMs = since(phase);
 
+		phase = Clock::now();
 		integrateVelocity(dt);
+		integrateRotation(dt);
 
-		//applySleep(dt); //sleep logic in integrate Velocity. 
-	}
-
-	void PhysicsClass::addSphereCollider(int objId, float radius){
-
-		SphereCollider sCollider;
-		sCollider.radius = 0.3f; //default radius
+		updateIslands();
+		stats.integrateMs = since(phase);
 
-		int foundIndex = -1;
-		for(int i = 0; i < rBodies.size(); i++) {
-			if(rBodies[i].objId == objId) {
-				rBodies[i].collidable = true;
-				break;
+		if (settings.reorderInterval > 0 && ++stepsSinceReorderCheck >= settings.reorderInterval) {
+			stepsSinceReorderCheck = 0;
+			float scatter = contactScatter();
+			if (scatterAfterReorder < 0.f) scatterAfterReorder = scatter;
+			else if (scatter > scatterAfterReorder + settings.reorderThreshold) reorderBodies();
+		}
+		queryMarginDirty = true; //bodies moved away from the AABBs the broadphase stored
+
+		stats.step++;
+		const bool grid = settings.broadphase == BroadphaseType::SortedGrid;
+		stats.gridCellSize = grid ? gridCellSize : 0.f;
+		stats.gridCells = grid ? gridCells : 0;
+		stats.restingGridCells = grid ? restingGridCells : 0;
+		stats.rawPairs = rawPairs;
+		stats.pairs = static_cast<uint32_t>(aabbPairs.size());
+		stats.filteredPairs = filteredPairs;
+		stats.manifolds = static_cast<uint32_t>(manifolds.size());
+		stats.contacts = 0;
+		for (const ContactManifold& m : manifolds) stats.contacts += m.pointCount;
+		stats.awakeBodies = bodies.awakeCount;
+		stats.sleepingBodies = bodies.dynamicCount - bodies.awakeCount;
+		stats.solverIterations = manifolds.empty() ? 0 : settings.solverIterations;
+		stats.solverColors = settings.solver == SolverType::GraphColored && !manifolds.empty() ? static_cast<uint32_t>(colorOffsets.size() - 1) : 0;
+		stats.stepMs = since(stepStart);
+
+		if (statsLog) {
+			if (statsLogFormat == StatsFormat::Json) {
+				stats.writeJson(*statsLog);
+			}
+			else {
+				if (statsLogHeader) PhysicsStats::writeCsvHeader(*statsLog);
+				statsLogHeader = false;
+				stats.writeCsv(*statsLog);
 			}
 		}
-		/*
-		if (foundIndex < 0) {
-			std::cout << "object ID: " << objId << " needs a rigidbody to add a collider.\n";
-			return;
-		}*/
-		sCollider.bodyIndex = static_cast<uint32_t>(foundIndex);
-		sphereColliders.push_back(sCollider);
 	}
 
-	void PhysicsClass::addBoxCollider(int objId, const glm::vec3& halfSize) {
+	void PhysicsClass::setStatsLog(std::ostream* out, StatsFormat format) {
+		statsLog = out;
+		statsLogFormat = format;
+		statsLogHeader = out && format == StatsFormat::Csv;
+	}
 
-		BoxCollider bCollider;
-		bCollider.halfSize = halfSize; //default radius
+	//one list of the columns so the header, the rows and the json keys can't drift apart
+	template<typename Fn>
+	static void statsColumns(const PhysicsStats& s, Fn&& fn) {
+		fn("step", s.step);
+		fn("integrateForcesMs", s.integrateForcesMs);
+		fn("broadPhaseMs", s.broadPhaseMs);
+		fn("detectCollisionsMs", s.detectCollisionsMs);
+		fn("resolveCollisionsMs", s.resolveCollisionsMs);
+		fn("integrateMs", s.integrateMs);
+		fn("stepMs", s.stepMs);
+		fn("gridCellSize", s.gridCellSize);
+		fn("gridCells", s.gridCells);
+		fn("restingGridCells", s.restingGridCells);
+		fn("rawPairs", s.rawPairs);
+		fn("pairs", s.pairs);
+		fn("filteredPairs", s.filteredPairs);
+		fn("satTests", s.satTests);
+		fn("satHits", s.satHits);
+		fn("gjkTests", s.gjkTests);
+		fn("gjkHits", s.gjkHits);
+		fn("manifolds", s.manifolds);
+		fn("contacts", s.contacts);
+		fn("solverIterations", s.solverIterations);
+		fn("solverColors", s.solverColors);
+		fn("awakeBodies", s.awakeBodies);
+		fn("sleepingBodies", s.sleepingBodies);
+	}
 
-		int foundIndex = -1;
-		//std::cout << "rbodies size: " << rBodies.size() << "\n";
-		for (int i = 0; i < rBodies.size(); i++) {
-			if (rBodies[i].objId == objId) {
-				foundIndex = i;
-				rBodies[i].collidable = true;
-				break;
-			}
-		}
-		/*
-		if (foundIndex < 0) {
-			std::cout << "object ID: " << objId << " needs a rigidbody to add a collider.\n";
-			return;
-		}*/
-		bCollider.bodyIndex = static_cast<uint32_t>(foundIndex);
-		boxColliders.push_back(bCollider);
+	void PhysicsStats::writeCsvHeader(std::ostream& out) {
+		const char* separator = "";
+		statsColumns(PhysicsStats{}, [&](const char* name, auto) {
+			out << separator << name;
+			separator = ",";
+		});
+		out << "\n";
+	}
+
+	void PhysicsStats::writeCsv(std::ostream& out) const {
+		const char* separator = "";
+		statsColumns(*this, [&](const char*, auto value) {
+			out << separator << value;
+			separator = ",";
+		});
+		out << "\n";
 	}
 
-	void PhysicsClass::setSpeed(int objId, const glm::vec3& speed) {
+	void PhysicsStats::writeJson(std::ostream& out) const {
+		const char* separator = "{ ";
+		statsColumns(*this, [&](const char* name, auto value) {
+			out << separator << "\"" << name << "\": " << value;
+			separator = ", ";
+		});
+		out << " }\n";
+	}
 
-		//if rBodies is a vector:
-		for (auto& body : rBodies) { //worst case: O(n), best case: O(1)
-			if(body.objId == objId) {
-				body.velocity = speed;
-				return;
-			}
+	//fixed timestep with render interpolation: https://gafferongames.com/post/fix_your_timestep/
+	uint32_t PhysicsClass::update(float frameTime) {
+		const float dt = settings.fixedTimeStep;
+		accumulator += frameTime;
+
+		uint32_t steps = 0;
+		while (accumulator >= dt && steps < settings.maxSubSteps) {
+			savePreviousState();
+			step(dt);
+			accumulator -= dt;
+			steps++;
 		}
 
-		//if rBodies is a map:
-		//rBodies[objId].velocity = speed;
+		//out of substeps, the simulation can't keep up. drop the backlog so the next frame doesn't need even more steps (spiral of death)
+		if (accumulator >= dt) accumulator = std::fmod(accumulator, dt);
+
+		interpolationAlpha = accumulator / dt;
+		return steps;
 	}
 
-	void PhysicsClass::applyForce(int objId, const glm::vec3& force) {
-		for (auto& body : rBodies) { //worst case: O(n), best case: O(1)
-			if (body.objId == objId) {
-				body.force = force;
-				return;
-			}
+	void PhysicsClass::savePreviousState() {
+		//sleeping and static bodies don't move, only new bodies and the awake range need saving
+		uint32_t saved = static_cast<uint32_t>(previousPose.size());
+		previousPose.resize(bodies.size());
+		for (uint32_t i = saved; i < bodies.size(); i++) {
+			previousPose[i] = { bodies.position(i), bodies.rotation(i) };
+		}
+		for (uint32_t i = 0; i < bodies.awakeCount; i++) {
+			previousPose[i] = { bodies.position(i), bodies.rotation(i) };
 		}
-		//std::cout << "apply force on Object ID: " << objId << " failed. Object not found in physics system.\n";
 	}
 
-	void PhysicsClass::addRigidBody(MveGameObject& obj, float mass) {
-		RigidBody body;
-		body.objId = obj.getId();
-		body.position = obj.transform.translation;
-		body.mass = mass;
-		rBodies.push_back(body);
+	//bump when the snapshot layout or anything written into it changes
+	static constexpr uint32_t snapshotMagic = 0x5350564Du; //"MVPS"
+	static constexpr uint32_t snapshotFormat = 7; //2: collision filters in Collider, 3: triggers and touching pairs, 4: convex colliders, 5: mesh colliders, 6: heightfields, 7: reorder scheduling
+
+	template<typename Self, typename Fn>
+	void PhysicsClass::snapshotFields(Self& self, Fn&& fn) {
+		auto& b = self.bodies;
+		fn(self.structureVersion);
+		fn(self.accumulator);
+		fn(self.interpolationAlpha);
+		fn(self.nextIslandId);
+		//when the next morton sort runs, it renames colliders and with that changes the solver order
+		fn(self.stepsSinceReorderCheck);
+		fn(self.scatterAfterReorder);
+		fn(b.dynamicCount);
+		fn(b.awakeCount);
+
+		//one stream after the other, the sleeping and static ends of each stay put from frame to frame which keeps deltas small
+		fn(b.posX); fn(b.posY); fn(b.posZ);
+		fn(b.velX); fn(b.velY); fn(b.velZ);
+		fn(b.forceX); fn(b.forceY); fn(b.forceZ);
+		fn(b.invMass);
+		fn(b.mass);
+		fn(b.angVelX); fn(b.angVelY); fn(b.angVelZ);
+		fn(b.torqueX); fn(b.torqueY); fn(b.torqueZ);
+		fn(b.rotW); fn(b.rotX); fn(b.rotY); fn(b.rotZ);
+		fn(b.invInertiaX); fn(b.invInertiaY); fn(b.invInertiaZ);
+		fn(b.objId);
+		fn(b.sleepTimer);
+		fn(b.sleep);
+		fn(b.island);
+		fn(b.collidable);
+		fn(b.continuous);
+		fn(b.queryLayers);
+		fn(b.slot);
+		fn(b.boxCollider);
+		fn(b.sphereCollider);
+		fn(b.convexCollider);
+		fn(b.meshCollider);
+		fn(b.heightFieldCollider);
+
+		fn(self.slotIndex);
+		fn(self.slotGeneration);
+		fn(self.freeSlots);
+		fn(self.colliders);
+		fn(self.manifolds);
+		fn(self.convexCache);
+		fn(self.previousPose);
+		fn(self.touching);
 	}
 
-	Cell PhysicsClass::getCell(const glm::vec3& pos, float cellSize) {
-		return Cell{
-			static_cast<int>(std::floor(pos.x / cellSize)),
-			static_cast<int>(std::floor(pos.y / cellSize)),
-			static_cast<int>(std::floor(pos.z / cellSize))
-		};
+	void PhysicsClass::saveSnapshot(PhysicsSnapshot& out) const {
+		out.clear();
+		out.write(snapshotMagic);
+		out.write(snapshotFormat);
+		//hulls, meshes and heightfields are never removed, the snapshot only needs the ones its colliders can point at to exist
+		out.write(static_cast<uint32_t>(convexHulls.size()));
+		out.write(static_cast<uint32_t>(triangleMeshes.size()));
+		out.write(static_cast<uint32_t>(heightFields.size()));
+		snapshotFields(*this, [&](const auto& field) { out.write(field); });
 	}
 
-	void PhysicsClass::buildGrid(float cellSize){
-		grid.clear();
-		
-		for (uint32_t i = 0; i < sphereColliders.size(); i++) {
-			Cell c = getCell(rBodies[sphereColliders[i].bodyIndex].position, cellSize);
-			uint64_t key = hashCell(c); //simple hash function for Cell
-			grid[key].push_back(i);
-			//uint64_t key = mortonEncode(c);
-			//grid[key].push_back(i);
+	bool PhysicsClass::restoreSnapshot(const PhysicsSnapshot& snapshot) {
+		const uint64_t currentVersion = structureVersion;
+		uint32_t magic = 0, format = 0, hullCount = 0, meshCount = 0, heightFieldCount = 0;
+
+		//walk it once without writing so a damaged snapshot leaves the world as it was
+		PhysicsSnapshot::Reader check{ snapshot, true };
+		PhysicsSnapshot::Reader header{ snapshot };
+		header.read(magic);
+		header.read(format);
+		header.read(hullCount);
+		header.read(meshCount);
+		header.read(heightFieldCount);
+		check.read(magic);
+		check.read(format);
+		check.read(hullCount);
+		check.read(meshCount);
+		check.read(heightFieldCount);
+		snapshotFields(*this, [&](auto& field) { check.read(field); });
+		if (magic != snapshotMagic || format != snapshotFormat || !check.ok()) return false;
+		//saved after hulls, meshes or heightfields were made that this PhysicsClass doesn't have
+		if (hullCount > convexHulls.size() || meshCount > triangleMeshes.size() || heightFieldCount > heightFields.size()) return false;
+
+		PhysicsSnapshot::Reader in{ snapshot };
+		in.read(magic);
+		in.read(format);
+		in.read(hullCount);
+		in.read(meshCount);
+		in.read(heightFieldCount);
+		snapshotFields(*this, [&](auto& field) { in.read(field); });
+
+		if (structureVersion != currentVersion) {
+			//other bodies or colliders than now: the handle map and the tree leaves are rebuilt from scratch
+			objIdHandles.clear();
+			for (uint32_t i = 0; i < bodies.size(); i++) objIdHandles[bodies.objId[i]] = { bodies.slot[i], slotGeneration[bodies.slot[i]] };
+			staticTree = AABBTree{ settings.treeMargin };
+			dynamicTree = AABBTree{ settings.treeMargin };
+			colliderProxies.clear();
+			colliderInStaticTree.clear();
+		}
+		else {
+			//same leaves, but sleeping bodies are never refit on their own and may sit somewhere else now
+			treeRefitAll = true;
 		}
+		treeDirty = true; //a body may be static in one and dynamic in the other
+		restingDirty = true; //axes, awake and resting lists and the resting grid
+		queryIndexStale = true;
+		queryMarginDirty = true;
+		//the events belong to the step before the restore, the touching pairs came with the snapshot
+		contactEvents.clear();
+		removedBodies.clear();
+		//sleeping and static bodies may be somewhere else in the snapshot, they aren't written again otherwise
+		for (uint32_t i = bodies.awakeCount; i < bodies.size(); i++) markSettled(i);
+		return true;
 	}
 
-	bool PhysicsClass::sphereSphere(const RigidBody& a, const RigidBody& b, float rA, float rB, Contact& out){
-		glm::vec3 d = b.position - a.position;
-		float distSq = glm::dot(d, d); //ax * bx + ay * by + az * bz
-		float radiusSum = rA + rB;
-		if (distSq <= radiusSum * radiusSum) {
-			float dist = std::sqrt(distSq);
-			out.penetration = radiusSum - dist;
-			out.normal = (dist > 0) ? d / dist : glm::vec3(1, 0, 0); //if dist > 0, then d / dist, else set normal to arbitrary axis
-			//out.point = a.position + out.normal * rA;
-			return true;
+	void PhysicsClass::syncTransforms(MveGameObject::Map& objects) {
+		//sleeping and static bodies never move so only the awake range needs writing, plus the final pose of the ones that just stopped
+		for (uint32_t slot : settledSlots) {
+			slotSettled[slot] = 0;
+			if (slot >= slotIndex.size()) continue; //a restored snapshot with fewer slots
+			const uint32_t i = slotIndex[slot];
+			//removed since, or awake again and written below
+			if (i >= bodies.size() || bodies.slot[i] != slot || i < bodies.awakeCount) continue;
+			auto it = objects.find(bodies.objId[i]);
+			if (it == objects.end()) continue;
+			BodyPose current{ bodies.position(i), bodies.rotation(i) };
+			blendPose(current, current, 1.f, it->second.transform);
 		}
-	}
+		settledSlots.clear();
 
-	void PhysicsClass::broadPhase(){
-		grid.clear();
-		//debugPoints->clear();
-		//building broadphase uniform grid
-		for (uint32_t i = 0; i < boxColliders.size(); i++) {
-			const RigidBody& body = rBodies[boxColliders[i].bodyIndex];
-			AABB aabb = computeAABB(body, boxColliders[i]);
+		for (uint32_t i = 0; i < bodies.awakeCount; i++) {
+			auto it = objects.find(bodies.objId[i]);
+			if (it == objects.end()) continue;
 
-			insertCollider(i, aabb, 1.0f); //cell size of 1.0f
+			BodyPose current{ bodies.position(i), bodies.rotation(i) };
+			//bodies added since the last step have no previous pose yet
+			const BodyPose& previous = i < previousPose.size() ? previousPose[i] : current;
+			blendPose(previous, current, interpolationAlpha, it->second.transform);
 		}
+	}
 
-		//generate pairs
-		aabbPairs.clear();
-		//Potential object collision pair generation using uniform grid: broadphase
-		//worst case: O(grid size * cell.size^2)
-		//Broadphase pair generation using uniform grid
-		for (auto& [_, cell] : grid) { //cell is the vector in grid that contains collider indices
-			for (size_t i = 0; i < cell.size(); i++) { 
-				for(size_t j = i + 1; j < cell.size(); j++){
-					// avoid duplicate pairs by ensuring j > i
-					// emplace back constructs the pair into the vector directly
-					aabbPairs.emplace_back( cell[i], cell[j] ); //cell[i] and cell[j] are collider indices
-				}
-			}
-		}
-		//std::cout << "in broadPhase, aabbPairs: " << aabbPairs.size() << " contacts: " << contacts.size() << "\n";
+	void PhysicsClass::markSettled(uint32_t body) {
+		const uint32_t slot = bodies.slot[body];
+		if (slotSettled.size() <= slot) slotSettled.resize(slotIndex.size(), 0);
+		if (slotSettled[slot]) return;
+		slotSettled[slot] = 1;
+		settledSlots.push_back(slot);
 	}
 
-	AABB PhysicsClass::computeAABB(const RigidBody& body, const BoxCollider& box) {
-		return {
-			body.position - box.halfSize,
-			body.position + box.halfSize
-		};
+	void PhysicsClass::writeTransforms(std::vector<BodyTransform>& out) const {
+		//sleeping bodies are included, whoever reads this may have missed the step they fell asleep on
+		out.resize(bodies.dynamicCount);
+		for (uint32_t i = 0; i < bodies.dynamicCount; i++) {
+			BodyPose current{ bodies.position(i), bodies.rotation(i) };
+			out[i] = { bodies.objId[i], i < bodies.awakeCount && i < previousPose.size() ? previousPose[i] : current, current };
+		}
 	}
 
-	//
-	void PhysicsClass::insertCollider(uint32_t colliderIndex, const AABB& aabb, float cellSize) {
-		Cell min = getCell(aabb.min, cellSize);
-		Cell max = getCell(aabb.max, cellSize);
-		//std::cout << "max.x: " << max.x << " max.y: " << max.y << " max.z: " << max.z << "\n"; 
-		for (int x = min.x; x <= max.x; x++)
-			for (int y = min.y; y <= max.y; y++)
-				for (int z = min.z; z <= max.z; z++)
-				{
-					grid[hashCell({ x, y, z })].push_back(colliderIndex);
-					/*
-					MveGameObject point = MveGameObject::makePointLight(0.1f);
-					point.transform.translation = glm::vec3(
-						(x + 0.5f) * cellSize,
-						(y + 0.5f) * cellSize,
-						(z + 0.5f) * cellSize
-					);
-					debugPoints->push_back(point);*/
-				}
+	void PhysicsClass::blendPose(const BodyPose& previous, const BodyPose& current, float alpha, TransformComponent& transform) {
+		transform.translation = glm::mix(previous.position, current.position, alpha);
+
+		//TransformComponent builds its matrix as Ry * Rx * Rz, glm extracts the angles in the same order
+		glm::mat4 rotation = glm::mat4_cast(glm::slerp(previous.rotation, current.rotation, alpha));
+		glm::extractEulerAngleYXZ(rotation, transform.rotation.y, transform.rotation.x, transform.rotation.z);
 	}
 
-	bool PhysicsClass::aabbIntersect(const AABB& a, const AABB& b) {
-		return 
-			(a.min.x <= b.max.x && a.max.x >= b.min.x) &&
-			(a.min.y <= b.max.y && a.max.y >= b.min.y) &&
-			(a.min.z <= b.max.z && a.max.z >= b.min.z);
+	void PhysicsClass::addSphereCollider(BodyHandle handle, float radius){
+		Collider sCollider;
+		sCollider.shape = ColliderShape::Sphere;
+		sCollider.radius = std::abs(radius);
+		addCollider(handle, sCollider);
 	}
 
-	//AABBAABB checks for collision between two AABBs and outputs contact info
-	bool PhysicsClass::AABBAABB(const AABB& a, const AABB& b, Contact& out) {
-		if (!aabbIntersect(a, b))return false;
+	void PhysicsClass::addBoxCollider(BodyHandle handle, const glm::vec3& halfSize) {
+		Collider bCollider;
+		bCollider.shape = ColliderShape::Box;
+		bCollider.halfSize = glm::abs(halfSize); //a negative half extent would flip the AABB inside out
+		addCollider(handle, bCollider);
+	}
 
-		glm::vec3 overlap = {
-			std::min(a.max.x, b.max.x) - std::max(a.min.x, b.min.x),
-			std::min(a.max.y, b.max.y) - std::max(a.min.y, b.min.y),
-			std::min(a.max.z, b.max.z) - std::max(a.min.z, b.min.z)
-		};
+	uint32_t PhysicsClass::createConvexHull(const std::vector<glm::vec3>& points, uint32_t maxVertices) {
+		ConvexHull hull;
+		if (!ConvexHull::build(points, maxVertices, hull)) return invalidHull;
+		convexHulls.push_back(std::move(hull));
+		return static_cast<uint32_t>(convexHulls.size()) - 1;
+	}
 
-		//find smallest penetration axis
-		if (overlap.x < overlap.y && overlap.x < overlap.z) {
+	uint32_t PhysicsClass::createConvexHull(const MveModel::Builder& model, const glm::vec3& scale, uint32_t maxVertices) {
+		std::vector<glm::vec3> points;
+		points.reserve(model.vertices.size());
+		for (const MveModel::Vertex& v : model.vertices) points.push_back(v.position * scale);
+		return createConvexHull(points, maxVertices);
+	}
 
-			out.normal = { (a.min.x < b.min.x) ? -1.f : 1.f, 0, 0 };
-			out.penetration = overlap.x;
-		}
-		else if (overlap.y < overlap.x && overlap.y < overlap.z) {
-			out.normal = { 0, (a.min.y < b.min.y) ? -1.f : 1.f, 0 };
-			out.penetration = overlap.y;
-		}
-		else {
-			out.normal = { 0, 0, (a.min.z < b.min.z) ? -1.f : 1.f };
-			out.penetration = overlap.z;
-		}
-		return true;
+	void PhysicsClass::addConvexCollider(BodyHandle handle, uint32_t hull) {
+		if (hull >= convexHulls.size()) return;
+		Collider cCollider;
+		cCollider.shape = ColliderShape::Convex;
+		cCollider.hull = hull;
+		addCollider(handle, cCollider);
 	}
 
+	uint32_t PhysicsClass::createTriangleMesh(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices) {
+		TriangleMesh mesh;
+		if (!mesh.build(vertices, indices)) return invalidMesh;
+		return addTriangleMesh(std::move(mesh));
+	}
 
-	OBB PhysicsClass::buildOBB(uint32_t colliderIndex){
-		const BoxCollider& box = boxColliders[colliderIndex];
-		const RigidBody& body = rBodies[box.bodyIndex];
+	uint32_t PhysicsClass::createTriangleMesh(const MveModel::Builder& model, const glm::vec3& scale) {
+		std::vector<glm::vec3> vertices;
+		vertices.reserve(model.vertices.size());
+		for (const MveModel::Vertex& v : model.vertices) vertices.push_back(v.position * scale);
+		return createTriangleMesh(vertices, model.indices);
+	}
 
-		OBB obb;
-		obb.center = body.position;
-		obb.halfSize = box.halfSize;
-		
-		//mat3_cast converts quaternion to rotation matrix
-		glm::mat3 rot = glm::mat3_cast(body.rotation);
-		obb.axis[0] = rot[0]; //local x axis
-		obb.axis[1] = rot[1]; //local y axis
-		obb.axis[2] = rot[2]; //local z axis
+	uint32_t PhysicsClass::addTriangleMesh(TriangleMesh&& mesh) {
+		if (mesh.empty()) return invalidMesh;
+		triangleMeshes.push_back(std::move(mesh));
+		return static_cast<uint32_t>(triangleMeshes.size()) - 1;
+	}
 
-		return obb;
+	void PhysicsClass::addMeshCollider(BodyHandle handle, uint32_t mesh) {
+		if (mesh >= triangleMeshes.size()) return;
+		Collider mCollider;
+		mCollider.shape = ColliderShape::Mesh;
+		mCollider.mesh = mesh;
+		addCollider(handle, mCollider);
 	}
 
-	SATResult PhysicsClass::testOBBvsOBB(const OBB& a, const OBB& b){
-		float minOverlap = FLT_MAX;
-		glm::vec3 bestAxis;
+	uint32_t PhysicsClass::createHeightField(const std::vector<float>& heights, uint32_t columns, uint32_t rows, float cellSize) {
+		HeightField heightField;
+		if (!heightField.build(heights, columns, rows, cellSize)) return invalidHeightField;
+		heightFields.push_back(std::move(heightField));
+		return static_cast<uint32_t>(heightFields.size()) - 1;
+	}
 
-		//use 15 because there are 15 potential separating axes between two OBBs
-		glm::vec3 axes[15]; 
-		int axisCount = 0;
+	void PhysicsClass::addHeightFieldCollider(BodyHandle handle, uint32_t heightField) {
+		if (heightField >= heightFields.size()) return;
+		Collider hCollider;
+		hCollider.shape = ColliderShape::HeightField;
+		hCollider.heightField = heightField;
+		addCollider(handle, hCollider);
+	}
 
-		//face normals
-		for (int i = 0; i < 3; i++) axes[axisCount++] = a.axis[i]; 
-		for (int i = 0; i < 3; i++) axes[axisCount++] = b.axis[i];
+	void PhysicsClass::addCollider(BodyHandle handle, const Collider& collider) {
+		int index = resolve(handle);
+		if (index < 0) {
+			//std::cout << "object ID: " << objId << " needs a rigidbody to add a collider.\n";
+			return;
+		}
+		uint32_t body = static_cast<uint32_t>(index);
+		bodies.collidable[body] = true;
+
+		uint32_t& slot = bodies.collider(body, collider.shape);
+		if (slot != BodyStore::noCollider) {
+			//the tree leaf still has the old size, it gets refit on the next step once the body is awake
+			body = wakeBody(body);
+			Collider& replaced = colliders[bodies.collider(body, collider.shape)];
+			CollisionFilter filter = replaced.filter;
+			replaced = collider;
+			replaced.bodyIndex = body;
+			replaced.filter = filter;
+			updateInertia(body);
+			restingDirty = true;
+			queryIndexStale = true;
+			return;
+		}
+		slot = static_cast<uint32_t>(colliders.size());
+		colliders.push_back(collider);
+		colliders.back().bodyIndex = body;
+		updateInertia(body);
+		restingDirty = true;
+		queryIndexStale = true;
+		structureChanged();
+	}
 
-		//edge cross products
-		//cross product finds a vector perpendicular to both input vectors
-		for(int i = 0; i < 3; i++){
-			for(int j = 0; j < 3; j++){
-				glm::vec3 axis = glm::cross(a.axis[i], b.axis[j]);
-				if(glm::length(axis * axis) > 1e-6f) {
-					axes[axisCount++] = glm::normalize(axis);
-				}
-			}
+	void PhysicsClass::updateInertia(uint32_t body) {
+		//solid box: I = m / 3 * (b^2 + c^2) with half extents, solid sphere: I = 2 / 5 * m * r^2
+		const float mass = bodies.mass[body];
+		glm::vec3 inertia{ 0.f };
+		if (bodies.boxCollider[body] != BodyStore::noCollider) {
+			glm::vec3 h2 = colliders[bodies.boxCollider[body]].halfSize * colliders[bodies.boxCollider[body]].halfSize;
+			inertia = mass / 3.f * glm::vec3{ h2.y + h2.z, h2.x + h2.z, h2.x + h2.y };
+		}
+		if (bodies.sphereCollider[body] != BodyStore::noCollider) {
+			float r = colliders[bodies.sphereCollider[body]].radius;
+			inertia = glm::max(inertia, glm::vec3{ 0.4f * mass * r * r });
+		}
+		if (bodies.convexCollider[body] != BodyStore::noCollider) {
+			//the hull's bounding box, moved to the body's origin with the parallel axis term
+			const ConvexHull& hull = convexHulls[colliders[bodies.convexCollider[body]].hull];
+			glm::vec3 h2 = hull.halfSize * hull.halfSize;
+			glm::vec3 c2 = hull.center * hull.center;
+			glm::vec3 box = mass / 3.f * glm::vec3{ h2.y + h2.z, h2.x + h2.z, h2.x + h2.y };
+			inertia = glm::max(inertia, box + mass * glm::vec3{ c2.y + c2.z, c2.x + c2.z, c2.x + c2.y });
 		}
 
-		glm::vec3 d = b.center - a.center;
-		
-		for (int i = 0; i < axisCount; i++) {
-			glm::vec3 L = axes[i]; //L is the current axis being tested
+		glm::vec3 invInertia{ 0.f };
+		for (int k = 0; k < 3; k++) {
+			if (inertia[k] > 0.f) invInertia[k] = 1.f / inertia[k];
+		}
+		bodies.setInvInertia(body, invInertia);
+	}
 
-			//projection radius of OBB A and B onto L
+	void PhysicsClass::setSpeed(BodyHandle handle, const glm::vec3& speed) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t i = wakeBody(static_cast<uint32_t>(index));
+		bodies.setVelocity(i, speed);
+	}
 
-			float rA = 
-				a.halfSize.x * std::abs(glm::dot(a.axis[0], L)) +
-				a.halfSize.y * std::abs(glm::dot(a.axis[1], L)) +
-				a.halfSize.z * std::abs(glm::dot(a.axis[2], L));
+	void PhysicsClass::applyForce(BodyHandle handle, const glm::vec3& force) {
+		int index = resolve(handle);
+		if (index < 0) {
+			//std::cout << "apply force on Object ID: " << objId << " failed. Object not found in physics system.\n";
+			return;
+		}
+		uint32_t i = wakeBody(static_cast<uint32_t>(index));
+		bodies.setForce(i, force);
+	}
 
-			float rB =
-				b.halfSize.x * std::abs(glm::dot(b.axis[0], L)) +
-				b.halfSize.y * std::abs(glm::dot(b.axis[1], L)) +
-				b.halfSize.z * std::abs(glm::dot(b.axis[2], L));
+	void PhysicsClass::setAngularVelocity(BodyHandle handle, const glm::vec3& angularVelocity) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t i = wakeBody(static_cast<uint32_t>(index));
+		if (bodies.isStatic(i)) return;
+		bodies.setAngularVelocity(i, angularVelocity);
+	}
 
-			float dist = std::abs(glm::dot(d, L));
-			float overlap = (rA + rB) - dist;
+	void PhysicsClass::applyTorque(BodyHandle handle, const glm::vec3& torque) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t i = wakeBody(static_cast<uint32_t>(index));
+		bodies.setTorque(i, bodies.torque(i) + torque);
+	}
 
-			if(overlap < 0){
-				return { false }; //no collision
-			}
-			if(overlap < minOverlap){
-				minOverlap = overlap;
-				bestAxis = L;
-			}
-		}
+	void PhysicsClass::applyForceAtPoint(BodyHandle handle, const glm::vec3& force, const glm::vec3& point) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t i = wakeBody(static_cast<uint32_t>(index));
+		bodies.setForce(i, bodies.force(i) + force);
+		bodies.setTorque(i, bodies.torque(i) + glm::cross(point - bodies.position(i), force));
+	}
 
-		//ensure the normal points from A to B
-		if (glm::dot(bestAxis, d) < 0){
-			bestAxis = -bestAxis;
-		}
-		return { true, minOverlap, bestAxis };
-			
+	void PhysicsClass::setContinuous(BodyHandle handle, bool continuous) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		bodies.continuous[index] = continuous;
 	}
 
-	void PhysicsClass::detectCollisions() {
+	void PhysicsClass::setQueryLayers(BodyHandle handle, uint32_t layers) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		bodies.queryLayers[index] = layers;
+	}
 
-		contacts.clear();
-		/*
-		//spphere collider. worst case: O(sphereColliders.size()^2)
-		for (size_t i = 0; i < sphereColliders.size(); i++) {
-			for (size_t j =  i + 1; j < sphereColliders.size(); j++) {
-				Contact C;
-				if(sphereSphere(
-					rBodies[sphereColliders[i].bodyIndex], rBodies[sphereColliders[j].bodyIndex],
-					sphereColliders[i].radius, sphereColliders[j].radius, C))
-				{
-					C.a = sphereColliders[i].bodyIndex;
-					C.b = sphereColliders[j].bodyIndex;
-					contacts.push_back(C);
-				}
+	void PhysicsClass::setCollisionFilter(BodyHandle handle, const CollisionFilter& filter) {
+		setCollisionFilter(handle, ColliderShape::Box, filter);
+		setCollisionFilter(handle, ColliderShape::Sphere, filter);
+		setCollisionFilter(handle, ColliderShape::Convex, filter);
+		setCollisionFilter(handle, ColliderShape::Mesh, filter);
+		setCollisionFilter(handle, ColliderShape::HeightField, filter);
+	}
 
-			}
-		}*/
+	void PhysicsClass::setCollisionFilter(BodyHandle handle, ColliderShape shape, const CollisionFilter& filter) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t body = static_cast<uint32_t>(index);
+		if (bodies.collider(body, shape) == BodyStore::noCollider) return;
+		//resting pairs aren't generated again, wake the island so pairs the new filter allows show up and ones it forbids get dropped
+		body = wakeBody(body);
+		colliders[bodies.collider(body, shape)].filter = filter;
+	}
 
-		for (auto& [iA, iB] : aabbPairs) { //if iA is aabPairs[n].first, iB is aabbPairs[n].second
-			OBB A = buildOBB(iA);
-			OBB B = buildOBB(iB);
+	void PhysicsClass::setTrigger(BodyHandle handle, bool trigger) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		//a resting pair isn't tested again until its island wakes
+		uint32_t body = wakeBody(static_cast<uint32_t>(index));
+		if (bodies.boxCollider[body] != BodyStore::noCollider) colliders[bodies.boxCollider[body]].trigger = trigger;
+		if (bodies.sphereCollider[body] != BodyStore::noCollider) colliders[bodies.sphereCollider[body]].trigger = trigger;
+		if (bodies.convexCollider[body] != BodyStore::noCollider) colliders[bodies.convexCollider[body]].trigger = trigger;
+		if (bodies.meshCollider[body] != BodyStore::noCollider) colliders[bodies.meshCollider[body]].trigger = trigger;
+		if (bodies.heightFieldCollider[body] != BodyStore::noCollider) colliders[bodies.heightFieldCollider[body]].trigger = trigger;
+	}
 
-			SATResult result = testOBBvsOBB(A, B);
-			if (!result.hit)
-				continue;
-			else {
-				//std::cout << "Collision detected between body " << boxColliders[iA].bodyIndex << " and body " << boxColliders[iB].bodyIndex << "\n";
-			}
+	BodyHandle PhysicsClass::addRigidBody(MveGameObject& obj, float mass) {
+		BodyHandle handle = addRigidBody(static_cast<int>(obj.getId()), obj.transform.translation, mass);
+		const glm::vec3& euler = obj.transform.rotation;
+		glm::quat rotation = glm::angleAxis(euler.y, glm::vec3{ 0.f, 1.f, 0.f }) * glm::angleAxis(euler.x, glm::vec3{ 1.f, 0.f, 0.f }) * glm::angleAxis(euler.z, glm::vec3{ 0.f, 0.f, 1.f });
+		bodies.setRotation(static_cast<uint32_t>(resolve(handle)), rotation);
+		return handle;
+	}
 
-			Contact c;
-			c.a = boxColliders[iA].bodyIndex;
-			c.b = boxColliders[iB].bodyIndex;
-			c.normal = result.normal;
-			c.penetration = result.penetration;
+	BodyHandle PhysicsClass::addRigidBody(int objId, const glm::vec3& position, float mass) {
+		BodyHandle handle;
+		if (!freeSlots.empty()) {
+			handle.slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			handle.slot = static_cast<uint32_t>(slotIndex.size());
+			slotIndex.push_back(0);
+			slotGeneration.push_back(0);
+		}
+		handle.generation = slotGeneration[handle.slot];
+		slotIndex[handle.slot] = bodies.size();
+		objIdHandles[objId] = handle;
 
-			contacts.push_back(c);
+		RigidBody body;
+		body.objId = objId;
+		body.position = position;
+		body.mass = mass;
+		bodies.push(body, handle.slot);
+		structureChanged();
+
+		//keep dynamic bodies in front of the static partition, new bodies start awake
+		if (mass != 0.f) {
+			swapBodies(bodies.size() - 1, bodies.dynamicCount);
+			swapBodies(bodies.dynamicCount, bodies.awakeCount);
+			bodies.dynamicCount++;
+			bodies.awakeCount++;
 		}
-		//std::cout << "In detectCollision, aabbPairs: " << aabbPairs.size() << " contacts: " << contacts.size() << "\n";
+		restingDirty = true;
+		return handle;
+	}
 
+	void PhysicsClass::removeBody(int objId) {
+		removeBody(getHandle(objId));
 	}
 
+	void PhysicsClass::removeBody(BodyHandle handle) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t i = wakeBody(static_cast<uint32_t>(index)); //anything sleeping on it has to fall
+		if (!touching.empty()) removedBodies.push_back({ handle.slot, handle, bodies.objId[i] });
+
+		if (bodies.boxCollider[i] != BodyStore::noCollider) removeCollider(bodies.boxCollider[i]);
+		if (bodies.sphereCollider[i] != BodyStore::noCollider) removeCollider(bodies.sphereCollider[i]);
+		if (bodies.convexCollider[i] != BodyStore::noCollider) removeCollider(bodies.convexCollider[i]);
+		if (bodies.meshCollider[i] != BodyStore::noCollider) removeCollider(bodies.meshCollider[i]);
+		if (bodies.heightFieldCollider[i] != BodyStore::noCollider) removeCollider(bodies.heightFieldCollider[i]);
+
+		//walk the body to the end across the partition boundaries, then pop it
+		if (!bodies.isStatic(i)) {
+			swapBodies(i, bodies.awakeCount - 1);
+			swapBodies(bodies.awakeCount - 1, bodies.dynamicCount - 1);
+			i = bodies.dynamicCount - 1;
+			bodies.awakeCount--;
+			bodies.dynamicCount--;
+		}
+		swapBodies(i, bodies.size() - 1);
+
+		auto it = objIdHandles.find(bodies.objId.back());
+		if (it != objIdHandles.end() && it->second == handle) objIdHandles.erase(it);
+		bodies.pop();
+		if (previousPose.size() > bodies.size()) previousPose.pop_back();
+
+		slotGeneration[handle.slot]++;
+		slotIndex[handle.slot] = 0;
+		freeSlots.push_back(handle.slot);
+		restingDirty = true;
+		structureChanged();
+	}
 
-	void PhysicsClass::resolveCollisions() {
-		const float restitution = 0.5f; //coefficient of restitution (bounciness)
-		for (Contact& c : contacts) {
-			RigidBody& A = rBodies[c.a];
-			RigidBody& B = rBodies[c.b];
+	void PhysicsClass::removeCollider(uint32_t collider) {
+		const uint32_t last = static_cast<uint32_t>(colliders.size()) - 1;
 
-			glm::vec3 relativeVelocity = B.velocity - A.velocity;
-			float velAlongNormal = glm::dot(relativeVelocity, c.normal);
+		if (collider < colliderProxies.size() && colliderProxies[collider] != AABBTree::nullNode) {
+			if (colliderInStaticTree[collider]) staticTree.destroyProxy(colliderProxies[collider]);
+			else dynamicTree.destroyProxy(colliderProxies[collider]);
+			colliderProxies[collider] = AABBTree::nullNode;
+		}
 
-			if (velAlongNormal > 0) continue; //objects are separating
-			/*
-			float massSum = A.mass + B.mass;
-			if (massSum == 0.f) continue; //both objects are static*/
+		//the last collider moves into the hole, its tree leaf hands back the new index
+		bodies.collider(colliders[collider].bodyIndex, colliders[collider].shape) = BodyStore::noCollider;
+		if (collider != last) {
+			colliders[collider] = colliders[last];
+			bodies.collider(colliders[collider].bodyIndex, colliders[collider].shape) = collider;
+			if (last < colliderProxies.size()) {
+				colliderProxies[collider] = colliderProxies[last];
+				colliderInStaticTree[collider] = colliderInStaticTree[last];
+				if (colliderProxies[collider] != AABBTree::nullNode) {
+					(colliderInStaticTree[collider] ? staticTree : dynamicTree).setUserData(colliderProxies[collider], collider);
+				}
+			}
+			else if (collider < colliderProxies.size()) {
+				treeDirty = true; //a collider added since the last step moved below the synced range
+			}
+			if (last < colliderAABBs.size()) colliderAABBs[collider] = colliderAABBs[last];
+		}
+		colliders.pop_back();
+		if (colliderProxies.size() > last) colliderProxies.resize(last);
+		if (colliderInStaticTree.size() > last) colliderInStaticTree.resize(last);
+		if (colliderAABBs.size() > last) colliderAABBs.resize(last);
+
+		//the manifold cache is keyed by collider pair. pairs with the removed collider go, pairs with the moved one are renamed.
+		//a renamed pair that would change order is dropped too, its normal and impulses are the other way around
+		auto renamed = [&](uint32_t c) { return c == last ? collider : c; };
+		size_t kept = 0;
+		for (size_t k = 0; k < manifolds.size(); k++) {
+			ContactManifold& m = manifolds[k];
+			uint32_t a = static_cast<uint32_t>(m.key >> 32);
+			uint32_t b = static_cast<uint32_t>(m.key);
+			if (a == collider || b == collider) continue;
+			a = renamed(a);
+			b = renamed(b);
+			if (a > b) continue;
+			m.key = (static_cast<uint64_t>(a) << 32) | b;
+			manifolds[kept++] = m;
+		}
+		manifolds.resize(kept);
+		std::sort(manifolds.begin(), manifolds.end(), ContactManifold::before);
+		kept = 0;
+		for (const ConvexCacheEntry& entry : convexCache) {
+			uint32_t a = static_cast<uint32_t>(entry.key >> 32);
+			uint32_t b = static_cast<uint32_t>(entry.key);
+			if (a == collider || b == collider) continue;
+			a = renamed(a);
+			b = renamed(b);
+			if (a < b) convexCache[kept++] = { (static_cast<uint64_t>(a) << 32) | b, entry.cache };
+		}
+		convexCache.resize(kept);
+		std::sort(convexCache.begin(), convexCache.end(), [](const ConvexCacheEntry& x, const ConvexCacheEntry& y) { return x.key < y.key; });
+		restingDirty = true;
+		queryIndexStale = true;
+		structureChanged();
+	}
 
-			float invMassA = (A.mass == 0.f) ? 0.f : 1.f / A.mass;
-			float invMassB = (B.mass == 0.f) ? 0.f : 1.f / B.mass;
-			float invMassSum = invMassA + invMassB;
-			if (invMassSum == 0.f) continue; //both objects are static
+	BodyHandle PhysicsClass::getHandle(int objId) const {
+		auto it = objIdHandles.find(objId);
+		return it == objIdHandles.end() ? BodyHandle{} : it->second;
+	}
 
-			//IMPULSE application
-			//Impulse is the change in momentum, and momentum is mass times velocity (p = m * v)
-			float j = -(1 + restitution) * velAlongNormal;
-			j /= invMassSum;
-			glm::vec3 impulse = j * c.normal;
-			A.velocity -= impulse * invMassA;
-			B.velocity += impulse * invMassB;
+	int PhysicsClass::resolve(BodyHandle handle) const {
+		if (handle.slot >= slotGeneration.size() || slotGeneration[handle.slot] != handle.generation) return -1;
+		return static_cast<int>(slotIndex[handle.slot]);
+	}
 
-			// positional correction (use invMass-based distribution)
-			positionalCorrection(A, B, c);
+	void PhysicsClass::setMass(BodyHandle handle, float mass) {
+		int index = resolve(handle);
+		if (index < 0) return;
+		uint32_t i = wakeBody(static_cast<uint32_t>(index)); //its island may have been resting on it
+
+		bodies.mass[i] = mass;
+		bodies.invMass[i] = (mass == 0.f) ? 0.f : 1.f / mass;
+		updateInertia(i);
+
+		if (mass == 0.f && !bodies.isStatic(i)) {
+			//becoming static: move to the end of the awake range, then across the sleeping range, and shrink both
+			markSettled(i);
+			bodies.setVelocity(i, glm::vec3{ 0.f });
+			bodies.setForce(i, glm::vec3{ 0.f });
+			bodies.setAngularVelocity(i, glm::vec3{ 0.f });
+			bodies.setTorque(i, glm::vec3{ 0.f });
+			swapBodies(i, bodies.awakeCount - 1);
+			swapBodies(bodies.awakeCount - 1, bodies.dynamicCount - 1);
+			bodies.awakeCount--;
+			bodies.dynamicCount--;
+		}
+		else if (mass != 0.f && bodies.isStatic(i)) {
+			//becoming dynamic: swap with the first static body, then with the first sleeping body, and grow both
+			swapBodies(i, bodies.dynamicCount);
+			swapBodies(bodies.dynamicCount, bodies.awakeCount);
+			bodies.dynamicCount++;
+			bodies.awakeCount++;
+		}
+		treeDirty = true; //the body's colliders may need to change tree
+		restingDirty = true;
+	}
 
-			//this is FRICTION calculation
-			glm::vec3 tangent = relativeVelocity - glm::dot(relativeVelocity, c.normal) * c.normal;
-			//glm::length2 doesn't seem to be available in glm so do this instead for magnitude squared
-			if (glm::dot(tangent, tangent) > 1e-8f) {
-				tangent = glm::normalize(tangent);
-				float jt = -glm::dot(relativeVelocity, tangent);
-				jt /= invMassSum;
-
-				float mu = 0.5f; //coefficient of friction
-				//Coulomb's law of friction : frictional force between two surfaces is directly proportional to the normal force pressing them together Ff = mu * Fn
-				//Ff: frictional force, mu: coefficient of friction, Fn: normal force
-				jt = glm::clamp(jt, -j * mu, j * mu);
-				glm::vec3 frictionImpulse = jt * tangent;
-				A.velocity -= frictionImpulse * invMassA;
-				B.velocity += frictionImpulse * invMassB;
-			}
-			
+	void PhysicsClass::swapBodies(uint32_t a, uint32_t b) {
+		if (a == b) return;
+		bodies.swap(a, b);
+		//a body swapped in from past the end of previousPose has no previous pose, it falls back to its current one
+		uint32_t saved = static_cast<uint32_t>(previousPose.size());
+		if (a < saved && b < saved) std::swap(previousPose[a], previousPose[b]);
+		else if (a < saved) previousPose[a] = { bodies.position(a), bodies.rotation(a) };
+		else if (b < saved) previousPose[b] = { bodies.position(b), bodies.rotation(b) };
+		//the store swapped the collider and slot streams too, they only need to point back at the new indices
+		for (uint32_t i : { a, b }) {
+			slotIndex[bodies.slot[i]] = i;
+			if (bodies.boxCollider[i] != BodyStore::noCollider) colliders[bodies.boxCollider[i]].bodyIndex = i;
+			if (bodies.sphereCollider[i] != BodyStore::noCollider) colliders[bodies.sphereCollider[i]].bodyIndex = i;
+			if (bodies.convexCollider[i] != BodyStore::noCollider) colliders[bodies.convexCollider[i]].bodyIndex = i;
+			if (bodies.meshCollider[i] != BodyStore::noCollider) colliders[bodies.meshCollider[i]].bodyIndex = i;
+			if (bodies.heightFieldCollider[i] != BodyStore::noCollider) colliders[bodies.heightFieldCollider[i]].bodyIndex = i;
 		}
 	}
 
-	void PhysicsClass::positionalCorrection(RigidBody& A, RigidBody& B, const Contact& c) {
-		const float percent = 0.8f; //usually 20% to 80%
-		const float slop = 0.01f; //usually 0.01 to 0.1
+	static uint32_t findRoot(std::vector<uint32_t>& parent, uint32_t i) {
+		//path halving, every visited node skips to its grandparent
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	void PhysicsClass::updateIslands() {
+		const uint32_t count = bodies.awakeCount;
+		islandParent.resize(count);
+		for (uint32_t i = 0; i < count; i++) islandParent[i] = i;
+
+		//static bodies don't join islands, otherwise everything on the ground would be one island
+		for (const ContactManifold& m : manifolds) {
+			if (m.A >= count || m.B >= count) continue;
+			uint32_t rootA = findRoot(islandParent, m.A);
+			uint32_t rootB = findRoot(islandParent, m.B);
+			//lower index becomes the root so the result doesn't depend on contact order
+			if (rootA < rootB) islandParent[rootB] = rootA;
+			else if (rootB < rootA) islandParent[rootA] = rootB;
+		}
 
-		float invMassA = (A.mass == 0.f) ? 0.f : 1.f / A.mass;
-		float invMassB = (B.mass == 0.f) ? 0.f : 1.f / B.mass;
-		float invMassSum = invMassA + invMassB;
+		//an island can only sleep once its most recently moving body has rested long enough
+		islandTimer.assign(count, FLT_MAX);
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t root = findRoot(islandParent, i);
+			islandTimer[root] = std::min(islandTimer[root], bodies.sleepTimer[i]);
+		}
 
-		if (invMassSum == 0.f) return; //both objects are static
+		islandSleepId.resize(count);
+		bool anyAsleep = false;
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t root = findRoot(islandParent, i);
+			if (islandTimer[root] <= settings.sleepTime) continue;
+			if (root == i) islandSleepId[root] = nextIslandId++; //roots come first since they have the lowest index
+			bodies.sleep[i] = 1;
+			bodies.island[i] = islandSleepId[root];
+			bodies.setVelocity(i, glm::vec3{ 0.f });
+			bodies.setAngularVelocity(i, glm::vec3{ 0.f });
+			anyAsleep = true;
+		}
+		if (anyAsleep) partitionSleeping();
+	}
 
-		float correctionMagnitude = percent * std::max(c.penetration - slop, 0.0f);
-		glm::vec3 correction = (correctionMagnitude / invMassSum) * c.normal;
+	void PhysicsClass::wakeIslands() {
+		if (pendingWake.empty()) return;
+		std::sort(pendingWake.begin(), pendingWake.end());
+		pendingWake.erase(std::unique(pendingWake.begin(), pendingWake.end()), pendingWake.end());
+
+		for (uint32_t i = bodies.awakeCount; i < bodies.dynamicCount; i++) {
+			if (!std::binary_search(pendingWake.begin(), pendingWake.end(), bodies.island[i])) continue;
+			bodies.sleep[i] = 0;
+			bodies.sleepTimer[i] = 0.f;
+			//it hasn't moved while asleep, don't interpolate from a position saved before it fell asleep
+			if (i < previousPose.size()) previousPose[i] = { bodies.position(i), bodies.rotation(i) };
+		}
+		pendingWake.clear();
+		partitionSleeping();
+	}
 
-		A.position -= correction * invMassA;
-		B.position += correction * invMassB;
+	void PhysicsClass::wakeTouchedIslands() {
+		for (const ContactManifold& m : manifolds) {
+			if (bodies.isSleeping(m.A)) pendingWake.push_back(bodies.island[m.A]);
+			if (bodies.isSleeping(m.B)) pendingWake.push_back(bodies.island[m.B]);
+		}
+		if (pendingWake.empty()) return;
+
+		wakeIslands();
+		for (ContactManifold& m : manifolds) {
+			m.A = bodyRemap[m.A];
+			m.B = bodyRemap[m.B];
+			for (uint32_t p = 0; p < m.pointCount; p++) {
+				m.points[p].a = m.A;
+				m.points[p].b = m.B;
+			}
+		}
 	}
 
-	uint64_t PhysicsClass::hashCell(const Cell& c) {
-		//return c.x * 100 + c.y * 1000 + c.z * 10000;
-		//using large prime numbers for hashing because they help distribute the hash values more uniformly
-		return (uint64_t)(c.x * 73856093) ^ (uint64_t)(c.y * 19349663) ^ (uint64_t)(c.z * 83492791);
+	uint32_t PhysicsClass::wakeBody(uint32_t i) {
+		if (!bodies.isSleeping(i)) return i;
+		pendingWake.push_back(bodies.island[i]);
+		wakeIslands();
+		return bodyRemap[i];
 	}
 
-	//Integration (semi-implicit Euler): https://math.libretexts.org/Bookshelves/Differential_Equations/Numerically_Solving_Ordinary_Differential_Equations_(Brorson)/01%3A_Chapters/1.07%3A_Symplectic_integrators
-	void PhysicsClass::integrateForces(float dt) {
-		for (RigidBody& b : rBodies) {
-			if (b.mass == 0.0f) continue;
-			glm::vec3 acceleration = b.force;
-			b.velocity += acceleration * dt;
-			b.force = {};
+	void PhysicsClass::partitionSleeping() {
+		const uint32_t count = bodies.dynamicCount;
+		for (uint32_t i = 0; i < bodies.awakeCount; i++) if (bodies.sleep[i]) markSettled(i);
+		bodyOrder.clear();
+		for (uint32_t i = 0; i < count; i++) if (!bodies.sleep[i]) bodyOrder.push_back(i);
+		const uint32_t awake = static_cast<uint32_t>(bodyOrder.size());
+		for (uint32_t i = 0; i < count; i++) if (bodies.sleep[i]) bodyOrder.push_back(i);
+
+		//static bodies keep their index
+		bodyRemap.resize(bodies.size());
+		for (uint32_t i = count; i < bodies.size(); i++) bodyRemap[i] = i;
+		for (uint32_t k = 0; k < count; k++) bodyRemap[bodyOrder[k]] = k;
+
+		bodies.permute(bodyOrder, permuteVisited);
+		bodies.awakeCount = awake;
+		for (Collider& collider : colliders) collider.bodyIndex = bodyRemap[collider.bodyIndex];
+		for (uint32_t k = 0; k < count; k++) slotIndex[bodies.slot[k]] = k;
+
+		//bodies added since the last savePreviousState have no previous pose yet, they start from the current one
+		for (uint32_t i = static_cast<uint32_t>(previousPose.size()); i < count; i++) {
+			previousPose.push_back({ bodies.position(bodyRemap[i]), bodies.rotation(bodyRemap[i]) });
+		}
+		previousScratch.assign(previousPose.begin(), previousPose.begin() + count);
+		for (uint32_t k = 0; k < count; k++) previousPose[k] = previousScratch[bodyOrder[k]];
+		//islands woken during the step move mid step, the solver reads their cached inertia at the new index
+		if (bodyAxes.size() >= count) {
+			permuteStream(bodyAxes, bodyOrder, permuteVisited);
+			permuteStream(invInertiaWorld, bodyOrder, permuteVisited);
 		}
+		restingDirty = true;
 	}
 
-	void PhysicsClass::integrateVelocity(float dt) {
-		const float sleepThreshold = 0.05f;
-		const float sleepTime = 0.5f;
+	float PhysicsClass::contactScatter() const {
+		//the cached manifolds' body indices can be stale after the islands were partitioned, the colliders are always current
+		uint32_t counted = 0, far = 0;
+		for (const ContactManifold& m : manifolds) {
+			uint32_t a = colliders[static_cast<uint32_t>(m.key >> 32)].bodyIndex;
+			uint32_t b = colliders[static_cast<uint32_t>(m.key)].bodyIndex;
+			if (bodies.isStatic(a) || bodies.isStatic(b)) continue; //static bodies sit at the end, always far away
+			counted++;
+			if ((a > b ? a - b : b - a) > reorderGap) far++;
+		}
+		return counted > 0 ? static_cast<float>(far) / counted : 0.f;
+	}
 
-		for (RigidBody& b : rBodies) {
-			if (b.mass == 0.0f) continue;
-			b.position += b.velocity * dt;
+	void PhysicsClass::reorderBodies() {
+		const uint32_t count = bodies.size();
+		//morton order of the cells bodies are in, partitions sorted on their own so awake, sleeping and static stay split
+		const float cellSize = chooseCellSize();
+		mortonKeys.resize(count);
+		for (uint32_t i = 0; i < count; i++) mortonKeys[i] = { cellKey(getCell(bodies.position(i), cellSize)), i };
+		std::sort(mortonKeys.begin(), mortonKeys.begin() + bodies.awakeCount);
+		std::sort(mortonKeys.begin() + bodies.awakeCount, mortonKeys.begin() + bodies.dynamicCount);
+		std::sort(mortonKeys.begin() + bodies.dynamicCount, mortonKeys.end());
+
+		bodyOrder.resize(count);
+		bodyRemap.resize(count);
+		for (uint32_t k = 0; k < count; k++) {
+			bodyOrder[k] = mortonKeys[k].second;
+			bodyRemap[bodyOrder[k]] = k;
+		}
+		//bodies added since the last savePreviousState have no previous pose yet, they start from the current one
+		for (uint32_t i = static_cast<uint32_t>(previousPose.size()); i < count; i++) {
+			previousPose.push_back({ bodies.position(i), bodies.rotation(i) });
+		}
+		bodies.permute(bodyOrder, permuteVisited);
+		permuteStream(previousPose, bodyOrder, permuteVisited);
+		for (uint32_t k = 0; k < count; k++) slotIndex[bodies.slot[k]] = k;
+		for (Collider& collider : colliders) collider.bodyIndex = bodyRemap[collider.bodyIndex];
+
+		//colliders follow their bodies in shape order
+		const uint32_t colliderCount = static_cast<uint32_t>(colliders.size());
+		colliderOrder.resize(colliderCount);
+		for (uint32_t i = 0; i < colliderCount; i++) colliderOrder[i] = i;
+		std::sort(colliderOrder.begin(), colliderOrder.end(), [&](uint32_t x, uint32_t y) {
+			const Collider& a = colliders[x];
+			const Collider& b = colliders[y];
+			return a.bodyIndex != b.bodyIndex ? a.bodyIndex < b.bodyIndex : a.shape < b.shape;
+		});
+		colliderRemap.resize(colliderCount);
+		for (uint32_t k = 0; k < colliderCount; k++) colliderRemap[colliderOrder[k]] = k;
+		permuteStream(colliders, colliderOrder, permuteVisited);
+		for (uint32_t i = 0; i < count; i++) {
+			if (bodies.boxCollider[i] != BodyStore::noCollider) bodies.boxCollider[i] = colliderRemap[bodies.boxCollider[i]];
+			if (bodies.sphereCollider[i] != BodyStore::noCollider) bodies.sphereCollider[i] = colliderRemap[bodies.sphereCollider[i]];
+			if (bodies.convexCollider[i] != BodyStore::noCollider) bodies.convexCollider[i] = colliderRemap[bodies.convexCollider[i]];
+			if (bodies.meshCollider[i] != BodyStore::noCollider) bodies.meshCollider[i] = colliderRemap[bodies.meshCollider[i]];
+			if (bodies.heightFieldCollider[i] != BodyStore::noCollider) bodies.heightFieldCollider[i] = colliderRemap[bodies.heightFieldCollider[i]];
+		}
 
-			//sleep logic, I decided to implement it here for efficiency
-			if (glm::length(b.velocity) < sleepThreshold) {
-				b.sleepTimer += dt;
-				if (b.sleepTimer > sleepTime)
-					b.sleep = true;
+		if (!colliderProxies.empty()) {
+			//colliders added since the last step have no leaf yet and may land anywhere, syncTreeProxies looks at all of them
+			if (colliderProxies.size() < colliderCount) treeDirty = true;
+			colliderProxies.resize(colliderCount, AABBTree::nullNode);
+			colliderInStaticTree.resize(colliderCount, 0);
+			permuteStream(colliderProxies, colliderOrder, permuteVisited);
+			permuteStream(colliderInStaticTree, colliderOrder, permuteVisited);
+			for (uint32_t k = 0; k < colliderCount; k++) {
+				if (colliderProxies[k] != AABBTree::nullNode) (colliderInStaticTree[k] ? staticTree : dynamicTree).setUserData(colliderProxies[k], k);
 			}
-			else {
-				b.sleepTimer = 0;
-				b.sleep = false;
+		}
+		//static colliders' AABBs are only computed once by the tree broadphase
+		colliderAABBs.resize(colliderCount);
+		permuteStream(colliderAABBs, colliderOrder, permuteVisited);
+
+		//the contact cache is keyed by collider pair, same as in removeCollider a pair that changes order is dropped
+		size_t kept = 0;
+		for (size_t k = 0; k < manifolds.size(); k++) {
+			ContactManifold& m = manifolds[k];
+			uint32_t a = colliderRemap[static_cast<uint32_t>(m.key >> 32)];
+			uint32_t b = colliderRemap[static_cast<uint32_t>(m.key)];
+			if (a > b) continue;
+			m.key = (static_cast<uint64_t>(a) << 32) | b;
+			m.A = bodyRemap[m.A];
+			m.B = bodyRemap[m.B];
+			manifolds[kept++] = m;
+		}
+		manifolds.resize(kept);
+		std::sort(manifolds.begin(), manifolds.end(), ContactManifold::before);
+		kept = 0;
+		for (const ConvexCacheEntry& entry : convexCache) {
+			uint32_t a = colliderRemap[static_cast<uint32_t>(entry.key >> 32)];
+			uint32_t b = colliderRemap[static_cast<uint32_t>(entry.key)];
+			if (a < b) convexCache[kept++] = { (static_cast<uint64_t>(a) << 32) | b, entry.cache };
+		}
+		convexCache.resize(kept);
+		std::sort(convexCache.begin(), convexCache.end(), [](const ConvexCacheEntry& x, const ConvexCacheEntry& y) { return x.key < y.key; });
+
+		restingDirty = true; //axes, collider lists and the resting grid
+		queryIndexStale = true;
+		structureChanged();
+		scatterAfterReorder = -1.f;
+	}
+
+	void PhysicsClass::updateRestingColliders() {
+		awakeColliders.clear();
+		restingColliders.clear();
+		for (uint32_t i = 0; i < colliders.size(); i++) {
+			if (colliders[i].bodyIndex < bodies.awakeCount) awakeColliders.push_back(i);
+			else restingColliders.push_back(i);
+		}
+	}
+
+	Cell PhysicsClass::getCell(const glm::vec3& pos, float cellSize) {
+		return Cell{
+			static_cast<int>(std::floor(pos.x / cellSize)),
+			static_cast<int>(std::floor(pos.y / cellSize)),
+			static_cast<int>(std::floor(pos.z / cellSize))
+		};
+	}
+
+	bool PhysicsClass::sphereSphere(const glm::vec3& centerA, float rA, const glm::vec3& centerB, float rB, Contact& out, float margin){
+		glm::vec3 d = centerB - centerA;
+		float distSq = glm::dot(d, d); //ax * bx + ay * by + az * bz
+		float radiusSum = rA + rB;
+		float reach = radiusSum + margin;
+		if (distSq > reach * reach) return false;
+
+		float dist = std::sqrt(distSq);
+		out.penetration = radiusSum - dist;
+		out.normal = (dist > 0) ? d / dist : glm::vec3(1, 0, 0); //if dist > 0, then d / dist, else set normal to arbitrary axis
+		//halfway between the two surface points
+		out.point = centerA + out.normal * (rA - out.penetration * 0.5f);
+		return true;
+	}
+
+	bool PhysicsClass::sphereOBB(const glm::vec3& center, float radius, const OBB& box, Contact& out, float margin) {
+		//sphere center in the box's local frame, clamped onto the box gives the closest point
+		glm::vec3 d = center - box.center;
+		glm::vec3 local{ glm::dot(d, box.axis[0]), glm::dot(d, box.axis[1]), glm::dot(d, box.axis[2]) };
+		glm::vec3 clamped = glm::clamp(local, -box.halfSize, box.halfSize);
+
+		if (clamped != local) {
+			//center outside the box
+			glm::vec3 closest = box.center + box.axis[0] * clamped.x + box.axis[1] * clamped.y + box.axis[2] * clamped.z;
+			glm::vec3 toCenter = center - closest;
+			float distSq = glm::dot(toCenter, toCenter);
+			float reach = radius + margin;
+			if (distSq > reach * reach) return false;
+
+			float dist = std::sqrt(distSq);
+			//normal from the sphere to the box
+			out.normal = -toCenter / dist;
+			out.penetration = radius - dist;
+			out.point = closest + out.normal * (out.penetration * 0.5f);
+			return true;
+		}
+
+		//center inside the box: leave through the face with the least distance to go
+		int axis = 0;
+		float minDist = FLT_MAX;
+		for (int k = 0; k < 3; k++) {
+			float faceDist = box.halfSize[k] - std::abs(local[k]);
+			if (faceDist < minDist) { minDist = faceDist; axis = k; }
+		}
+		glm::vec3 faceNormal = local[axis] < 0.f ? -box.axis[axis] : box.axis[axis];
+		out.normal = -faceNormal;
+		out.penetration = radius + minDist;
+		out.point = center + faceNormal * (minDist - out.penetration * 0.5f);
+		return true;
+	}
+
+	//LSD radix sort of the cell entries by key, 8 bits per pass. 
+	//passes where every key has the same byte are skipped, which is most of them since the keys only use the low bits of the grid range.
+	//the sort is stable so entries in a cell stay in collider order
+	static void radixSortEntries(std::vector<CellEntry>& entries, std::vector<CellEntry>& scratch) {
+		const size_t n = entries.size();
+		if (n < 2) return;
+		scratch.resize(n);
+
+		uint32_t counts[8][256] = {};
+		for (const CellEntry& e : entries) {
+			for (int pass = 0; pass < 8; pass++) counts[pass][(e.key >> (pass * 8)) & 0xFF]++;
+		}
+
+		CellEntry* src = entries.data();
+		CellEntry* dst = scratch.data();
+		for (int pass = 0; pass < 8; pass++) {
+			uint32_t* count = counts[pass];
+			if (count[(src[0].key >> (pass * 8)) & 0xFF] == n) continue; //every key has the same digit
+
+			uint32_t offset = 0;
+			for (int d = 0; d < 256; d++) {
+				uint32_t c = count[d];
+				count[d] = offset;
+				offset += c;
+			}
+			for (size_t i = 0; i < n; i++) {
+				dst[count[(src[i].key >> (pass * 8)) & 0xFF]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+		if (src != entries.data()) std::copy(src, src + n, entries.data());
+	}
+
+	void PhysicsClass::broadPhase(){
+		filteredPairs = 0;
+		rawPairs = 0;
+		if (settings.broadphase == BroadphaseType::AABBTree) treeBroadPhase();
+		else gridBroadPhase();
+		queryIndexStale = false;
+	}
+
+	void PhysicsClass::gridBroadPhase(){
+		//debugPoints->clear();
+		//resting (sleeping and static) colliders don't move, they are kept in their own sorted grid that is only rebuilt
+		//when something falls asleep, wakes up or gets added. each step only sorts the awake colliders
+		bool rebuildResting = restingDirty;
+		if (restingDirty) {
+			updateRestingColliders();
+			restingDirty = false;
+		}
+
+		colliderAABBs.resize(colliders.size());
+		for (uint32_t i : awakeColliders) {
+			colliderAABBs[i] = computeAABB(colliders[i].bodyIndex, colliders[i]);
+		}
+
+		if (rebuildResting) {
+			for (uint32_t i : restingColliders) {
+				colliderAABBs[i] = computeAABB(colliders[i].bodyIndex, colliders[i]);
+			}
+			//the cell size has to match between both grids, so it is only picked again when the resting grid is rebuilt
+			gridCellSize = chooseCellSize();
+			restingGrid.clear();
+			restingOversized.clear();
+			for (uint32_t i : restingColliders) {
+				insertCollider(i, colliderAABBs[i], gridCellSize, restingGrid, restingOversized);
+			}
+			radixSortEntries(restingGrid, gridScratch);
+			restingGridCells = 0;
+			for (size_t e = 0; e < restingGrid.size(); e++) restingGridCells += e == 0 || restingGrid[e].key != restingGrid[e - 1].key;
+
+			oversizedFlags.assign(colliders.size(), 0);
+			for (uint32_t big : restingOversized) oversizedFlags[big] = 1;
+		}
+
+		//building broadphase uniform grid
+		grid.clear();
+		oversizedColliders.clear();
+		for (uint32_t i : awakeColliders) {
+			insertCollider(i, colliderAABBs[i], gridCellSize, grid, oversizedColliders);
+		}
+		radixSortEntries(grid, gridScratch);
+
+		//generate pairs
+		aabbPairs.clear();
+		//Potential object collision pair generation using the sorted grid: broadphase
+		//every cell is a run of equal keys. two colliders can share several cells, so a pair is only emitted by the cell 
+		//that holds the min corner of their AABB overlap. that cell is inside both AABBs so exactly one cell emits each pair
+		auto testPair = [&](uint32_t a, uint32_t b, uint64_t key) {
+			if (colliders[a].bodyIndex == colliders[b].bodyIndex) return;
+			rawPairs++;
+			const AABB& A = colliderAABBs[a];
+			const AABB& B = colliderAABBs[b];
+			if (!aabbIntersect(A, B)) return;
+			if (cellKey(getCell(glm::max(A.min, B.min), gridCellSize)) != key) return;
+			if (!colliders[a].filter.accepts(colliders[b].filter)) {
+				filteredPairs++;
+				return;
+			}
+			// emplace back constructs the pair into the vector directly
+			aabbPairs.emplace_back(std::min(a, b), std::max(a, b));
+		};
+
+		//awake runs are matched against the resting run with the same key by walking both sorted grids together.
+		//resting vs resting is never tested, those pairs can't have changed since they fell asleep
+		size_t rest = 0;
+		gridCells = 0;
+		for (size_t begin = 0; begin < grid.size();) {
+			const uint64_t key = grid[begin].key;
+			size_t end = begin + 1;
+			while (end < grid.size() && grid[end].key == key) end++;
+			gridCells++;
+
+			for (size_t i = begin; i < end; i++) {
+				for (size_t j = i + 1; j < end; j++) {
+					testPair(grid[i].collider, grid[j].collider, key);
+				}
+			}
+
+			while (rest < restingGrid.size() && restingGrid[rest].key < key) rest++;
+			for (size_t r = rest; r < restingGrid.size() && restingGrid[r].key == key; r++) {
+				for (size_t i = begin; i < end; i++) {
+					testPair(grid[i].collider, restingGrid[r].collider, key);
+				}
+			}
+			begin = end;
+		}
+		oversizedPairs();
+	}
+
+	float PhysicsClass::chooseCellSize() {
+		if (colliderAABBs.empty()) return gridCellSize;
+
+		//median is used instead of mean so one huge collider (ground) doesn't blow the cell size up for everything else
+		extentScratch.resize(colliderAABBs.size());
+		for (size_t i = 0; i < colliderAABBs.size(); i++) {
+			glm::vec3 size = colliderAABBs[i].max - colliderAABBs[i].min;
+			extentScratch[i] = std::max(size.x, std::max(size.y, size.z));
+		}
+		auto mid = extentScratch.begin() + extentScratch.size() / 2;
+		std::nth_element(extentScratch.begin(), mid, extentScratch.end());
+
+		//a cell twice the typical object size means most colliders touch at most 2 cells per axis
+		return std::max(*mid * 2.f, 0.01f);
+	}
+
+	void PhysicsClass::syncTreeProxies() {
+		size_t first = treeDirty ? 0 : colliderProxies.size(); //only new colliders unless a body changed mass
+		colliderProxies.resize(colliders.size(), AABBTree::nullNode);
+		colliderInStaticTree.resize(colliders.size(), 0);
+		colliderAABBs.resize(colliders.size());
+
+		for (size_t i = first; i < colliders.size(); i++) {
+			uint32_t collider = static_cast<uint32_t>(i);
+			uint32_t body = colliders[i].bodyIndex;
+			bool isStatic = bodies.isStatic(body);
+			int32_t& proxy = colliderProxies[i];
+			if (proxy != AABBTree::nullNode && colliderInStaticTree[i] == isStatic) continue;
+
+			if (proxy != AABBTree::nullNode) {
+				if (colliderInStaticTree[i]) {
+					staticTree.destroyProxy(proxy);
+				}
+				else {
+					dynamicTree.destroyProxy(proxy);
+				}
+			}
+
+			colliderAABBs[i] = computeAABB(body, colliders[i]);
+			if (isStatic) {
+				proxy = staticTree.createProxy(colliderAABBs[i], collider);
+			}
+			else {
+				proxy = dynamicTree.createProxy(colliderAABBs[i], collider);
+			}
+			colliderInStaticTree[i] = isStatic;
+		}
+		treeDirty = false;
+	}
+
+	void PhysicsClass::treeBroadPhase() {
+		syncTreeProxies();
+		if (restingDirty) {
+			updateRestingColliders();
+			restingDirty = false;
+		}
+		if (treeRefitAll) {
+			for (uint32_t i = 0; i < colliders.size(); i++) {
+				if (colliderInStaticTree[i]) continue;
+				colliderAABBs[i] = computeAABB(colliders[i].bodyIndex, colliders[i]);
+				dynamicTree.moveProxy(colliderProxies[i], colliderAABBs[i]);
+			}
+			treeRefitAll = false;
+		}
+
+		//refit: only awake colliders are recomputed, and they only touch the tree when they leave their fat AABB.
+		//sleeping colliders stay in the dynamic tree untouched
+		for (uint32_t i : awakeColliders) {
+			colliderAABBs[i] = computeAABB(colliders[i].bodyIndex, colliders[i]);
+			dynamicTree.moveProxy(colliderProxies[i], colliderAABBs[i]);
+		}
+
+		//pairs are only generated for awake colliders. static vs static and sleeping vs sleeping/static never show up.
+		//two awake colliders find each other twice so only the lower index reports it
+		aabbPairs.clear();
+		auto addPair = [&](uint32_t a, uint32_t b) {
+			if (!aabbIntersect(colliderAABBs[a], colliderAABBs[b])) return;
+			if (!colliders[a].filter.accepts(colliders[b].filter)) {
+				filteredPairs++;
+				return;
+			}
+			aabbPairs.emplace_back(std::min(a, b), std::max(a, b));
+		};
+		for (uint32_t i : awakeColliders) {
+			uint32_t body = colliders[i].bodyIndex;
+			const AABB& aabb = colliderAABBs[i];
+
+			dynamicTree.query(aabb, [&](uint32_t other) {
+				uint32_t otherBody = colliders[other].bodyIndex;
+				if (otherBody == body) return true;
+				rawPairs++;
+				if (otherBody < bodies.awakeCount && other < i) return true;
+				addPair(i, other);
+				return true;
+			});
+			staticTree.query(aabb, [&](uint32_t other) {
+				rawPairs++;
+				addPair(i, other);
+				return true;
+			});
+		}
+	}
+
+	void PhysicsClass::colliderBounds(const Collider& collider, const glm::mat3& rot, glm::vec3& center, glm::vec3& extent) const {
+		center = bodies.position(collider.bodyIndex);
+		switch (collider.shape) {
+		case ColliderShape::Box:
+			//extent of a rotated box along each world axis is the half sizes projected through |R|
+			extent =
+				glm::abs(rot[0]) * collider.halfSize.x +
+				glm::abs(rot[1]) * collider.halfSize.y +
+				glm::abs(rot[2]) * collider.halfSize.z;
+			break;
+		case ColliderShape::Convex: {
+			//the hull's own box turned with the body, it doesn't have to be centered on the body's origin
+			const ConvexHull& hull = convexHulls[collider.hull];
+			center += rot * hull.center;
+			extent =
+				glm::abs(rot[0]) * hull.halfSize.x +
+				glm::abs(rot[1]) * hull.halfSize.y +
+				glm::abs(rot[2]) * hull.halfSize.z;
+			break;
+		}
+		case ColliderShape::Mesh:
+		case ColliderShape::HeightField: {
+			const AABB& bounds = collider.shape == ColliderShape::Mesh ? triangleMeshes[collider.mesh].bounds() : heightFields[collider.heightField].bounds();
+			const glm::vec3 halfSize = (bounds.max - bounds.min) * 0.5f;
+			center += rot * ((bounds.min + bounds.max) * 0.5f);
+			extent =
+				glm::abs(rot[0]) * halfSize.x +
+				glm::abs(rot[1]) * halfSize.y +
+				glm::abs(rot[2]) * halfSize.z;
+			break;
+		}
+		default:
+			extent = glm::vec3{ collider.radius };
+			break;
+		}
+	}
+
+	AABB PhysicsClass::computeAABB(uint32_t bodyIndex, const Collider& collider) {
+		glm::vec3 center, extent;
+		colliderBounds(collider, bodyAxes[bodyIndex], center, extent);
+		AABB aabb{ center - extent, center + extent };
+		if (!bodies.continuous[bodyIndex]) return aabb;
+
+		//swept from here to where the velocity takes it this step, grown by what the spin can add at the far end of the shape.
+		//integrateForces already ran, so this is the velocity the step integrates with
+		glm::vec3 motion = bodies.velocity(bodyIndex) * stepDt;
+		glm::vec3 reach = glm::abs(center - bodies.position(bodyIndex)) + extent;
+		float spin = glm::length(bodies.angularVelocity(bodyIndex)) * stepDt * glm::length(reach);
+		aabb.min += glm::min(motion, glm::vec3{ 0.f }) - spin;
+		aabb.max += glm::max(motion, glm::vec3{ 0.f }) + spin;
+		return aabb;
+	}
+
+	float PhysicsClass::speculativeMargin(const Collider& a, const Collider& b) const {
+		const uint32_t bodyA = a.bodyIndex, bodyB = b.bodyIndex;
+		if (!bodies.continuous[bodyA] && !bodies.continuous[bodyB]) return 0.f;
+
+		//closing speed bound: relative velocity of the centers plus the spin of each body at the furthest point of its shape
+		auto reach = [&](const Collider& c) {
+			switch (c.shape) {
+			case ColliderShape::Sphere: return c.radius;
+			case ColliderShape::Convex: return glm::length(glm::abs(convexHulls[c.hull].center) + convexHulls[c.hull].halfSize);
+			case ColliderShape::Mesh: return glm::length(glm::max(glm::abs(triangleMeshes[c.mesh].bounds().min), glm::abs(triangleMeshes[c.mesh].bounds().max)));
+			case ColliderShape::HeightField: return glm::length(glm::max(glm::abs(heightFields[c.heightField].bounds().min), glm::abs(heightFields[c.heightField].bounds().max)));
+			default: return glm::length(c.halfSize);
+			}
+		};
+		float speed = glm::length(bodies.velocity(bodyB) - bodies.velocity(bodyA)) +
+			glm::length(bodies.angularVelocity(bodyA)) * reach(a) +
+			glm::length(bodies.angularVelocity(bodyB)) * reach(b);
+		return speed * stepDt;
+	}
+
+	//
+	void PhysicsClass::insertCollider(uint32_t colliderIndex, const AABB& aabb, float cellSize, std::vector<CellEntry>& cells, std::vector<uint32_t>& oversized) {
+		const int maxCellsPerAxis = 4; //anything spanning more cells than this is tested separately
+		Cell min = getCell(aabb.min, cellSize);
+		Cell max = getCell(aabb.max, cellSize);
+		//std::cout << "max.x: " << max.x << " max.y: " << max.y << " max.z: " << max.z << "\n"; 
+		if (max.x - min.x >= maxCellsPerAxis || max.y - min.y >= maxCellsPerAxis || max.z - min.z >= maxCellsPerAxis) {
+			oversized.push_back(colliderIndex);
+			return;
+		}
+		for (int x = min.x; x <= max.x; x++)
+			for (int y = min.y; y <= max.y; y++)
+				for (int z = min.z; z <= max.z; z++)
+				{
+					cells.push_back({ cellKey({ x, y, z }), colliderIndex });
+					/*
+					MveGameObject point = MveGameObject::makePointLight(0.1f);
+					point.transform.translation = glm::vec3(
+						(x + 0.5f) * cellSize,
+						(y + 0.5f) * cellSize,
+						(z + 0.5f) * cellSize
+					);
+					debugPoints->push_back(point);*/
+				}
+	}
+
+	void PhysicsClass::oversizedPairs() {
+		if (oversizedColliders.empty() && restingOversized.empty()) return;
+		for (uint32_t big : oversizedColliders) oversizedFlags[big] = 1;
+
+		auto testPair = [&](uint32_t a, uint32_t b) {
+			if (colliders[a].bodyIndex == colliders[b].bodyIndex) return;
+			rawPairs++;
+			if (!aabbIntersect(colliderAABBs[a], colliderAABBs[b])) return;
+			if (!colliders[a].filter.accepts(colliders[b].filter)) {
+				filteredPairs++;
+				return;
+			}
+			aabbPairs.emplace_back(std::min(a, b), std::max(a, b));
+		};
+
+		//oversized colliders are usually a handful of level pieces, so O(oversized * colliders) stays linear in the collider count.
+		//an awake one is tested against everything
+		for (size_t k = 0; k < oversizedColliders.size(); k++) {
+			uint32_t big = oversizedColliders[k];
+			for (uint32_t other = 0; other < colliderAABBs.size(); other++) {
+				if (oversizedFlags[other]) continue; //oversized vs oversized is done below
+				testPair(big, other);
+			}
+			for (size_t l = k + 1; l < oversizedColliders.size(); l++) testPair(big, oversizedColliders[l]);
+			for (uint32_t other : restingOversized) testPair(big, other);
+		}
+		//a resting one, like the ground, only against awake colliders
+		for (uint32_t big : restingOversized) {
+			for (uint32_t other : awakeColliders) {
+				if (oversizedFlags[other]) continue;
+				testPair(big, other);
+			}
+		}
+
+		for (uint32_t big : oversizedColliders) oversizedFlags[big] = 0;
+	}
+
+	bool PhysicsClass::aabbIntersect(const AABB& a, const AABB& b) {
+		return 
+			(a.min.x <= b.max.x && a.max.x >= b.min.x) &&
+			(a.min.y <= b.max.y && a.max.y >= b.min.y) &&
+			(a.min.z <= b.max.z && a.max.z >= b.min.z);
+	}
+
+	//AABBAABB checks for collision between two AABBs and outputs contact info
+	bool PhysicsClass::AABBAABB(const AABB& a, const AABB& b, Contact& out) {
+		if (!aabbIntersect(a, b))return false;
+
+		glm::vec3 overlap = {
+			std::min(a.max.x, b.max.x) - std::max(a.min.x, b.min.x),
+			std::min(a.max.y, b.max.y) - std::max(a.min.y, b.min.y),
+			std::min(a.max.z, b.max.z) - std::max(a.min.z, b.min.z)
+		};
+
+		//find smallest penetration axis
+		if (overlap.x < overlap.y && overlap.x < overlap.z) {
+
+			out.normal = { (a.min.x < b.min.x) ? -1.f : 1.f, 0, 0 };
+			out.penetration = overlap.x;
+		}
+		else if (overlap.y < overlap.x && overlap.y < overlap.z) {
+			out.normal = { 0, (a.min.y < b.min.y) ? -1.f : 1.f, 0 };
+			out.penetration = overlap.y;
+		}
+		else {
+			out.normal = { 0, 0, (a.min.z < b.min.z) ? -1.f : 1.f };
+			out.penetration = overlap.z;
+		}
+		return true;
+	}
+
+
+	void PhysicsClass::updateBodyAxes() {
+		//sleeping and static bodies don't rotate, their axes are only redone after bodies moved around in the store
+		uint32_t count = restingDirty ? bodies.size() : bodies.awakeCount;
+		bodyAxes.resize(bodies.size());
+		invInertiaWorld.resize(bodies.size());
+		for (uint32_t i = 0; i < count; i++) {
+			//mat3_cast converts quaternion to rotation matrix
+			const glm::mat3& rot = bodyAxes[i] = glm::mat3_cast(bodies.rotation(i));
+			//R * diag(I^-1) * R^T, scaling the columns of R first
+			glm::mat3 scaled{ rot[0] * bodies.invInertiaX[i], rot[1] * bodies.invInertiaY[i], rot[2] * bodies.invInertiaZ[i] };
+			invInertiaWorld[i] = scaled * glm::transpose(rot);
+		}
+	}
+
+	OBB PhysicsClass::buildOBB(uint32_t colliderIndex) const {
+		const Collider& box = colliders[colliderIndex];
+		const glm::mat3& rot = bodyAxes[box.bodyIndex];
+
+		OBB obb;
+		obb.center = bodies.position(box.bodyIndex);
+		obb.halfSize = box.halfSize;
+		obb.axis[0] = rot[0]; //local x axis
+		obb.axis[1] = rot[1]; //local y axis
+		obb.axis[2] = rot[2]; //local z axis
+
+		return obb;
+	}
+
+	//a face of B only beats the best face of A, and an edge axis only beats the best face, when it is clearly shallower.
+	//two nearly aligned boxes have overlaps that differ by rounding only: letting rounding pick flips the reference face
+	//from step to step (new point ids, the warm start is lost) or picks an edge axis with a tilted normal and a single point
+	static constexpr float faceAxisBias = 0.98f;
+	static constexpr float edgeAxisBias = 0.95f;
+	static constexpr float axisBiasSlop = 0.005f; //absolute part of both, half the positional correction slop
+
+	//overlap below bias * best, written with |best| so it holds for the negative overlaps (gaps) of speculative contacts too
+	static bool clearlyShallower(float overlap, float best, float bias) {
+		return overlap < best - (1.f - bias) * std::abs(best) - axisBiasSlop;
+	}
+
+	//index into the three candidates: best face of A, best face of B, best edge
+	static int pickAxis(const float* overlap) {
+		int best = clearlyShallower(overlap[1], overlap[0], faceAxisBias) ? 1 : 0;
+		return clearlyShallower(overlap[2], overlap[best], edgeAxisBias) ? 2 : best;
+	}
+
+	SATResult PhysicsClass::testOBBvsOBB(const OBB& a, const OBB& b, float margin) {
+		//best overlap, axis and id of each candidate group: faces of A, faces of B, edges
+		float minOverlap[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		glm::vec3 bestAxis[3];
+		int bestId[3] = { -1, -1, -1 };
+
+		//use 15 because there are 15 potential separating axes between two OBBs
+		glm::vec3 axes[15]; 
+		int axisIds[15]; //see SATResult::axis
+		int axisCount = 0;
+
+		//face normals
+		for (int i = 0; i < 3; i++) { axisIds[axisCount] = i; axes[axisCount++] = a.axis[i]; }
+		for (int i = 0; i < 3; i++) { axisIds[axisCount] = 3 + i; axes[axisCount++] = b.axis[i]; }
+
+		//edge cross products
+		//cross product finds a vector perpendicular to both input vectors
+		for(int i = 0; i < 3; i++){
+			for(int j = 0; j < 3; j++){
+				glm::vec3 axis = glm::cross(a.axis[i], b.axis[j]);
+				if(glm::dot(axis, axis) > 1e-6f) { //parallel edges give a zero axis
+					axisIds[axisCount] = 6 + i * 3 + j;
+					axes[axisCount++] = glm::normalize(axis);
+				}
+			}
+		}
+
+		glm::vec3 d = b.center - a.center;
+		
+		for (int i = 0; i < axisCount; i++) {
+			glm::vec3 L = axes[i]; //L is the current axis being tested
+
+			//projection radius of OBB A and B onto L
+
+			float rA = 
+				a.halfSize.x * std::abs(glm::dot(a.axis[0], L)) +
+				a.halfSize.y * std::abs(glm::dot(a.axis[1], L)) +
+				a.halfSize.z * std::abs(glm::dot(a.axis[2], L));
+
+			float rB =
+				b.halfSize.x * std::abs(glm::dot(b.axis[0], L)) +
+				b.halfSize.y * std::abs(glm::dot(b.axis[1], L)) +
+				b.halfSize.z * std::abs(glm::dot(b.axis[2], L));
+
+			float dist = std::abs(glm::dot(d, L));
+			float overlap = (rA + rB) - dist;
+
+			if(overlap < -margin){
+				return { false }; //no collision
+			}
+			int group = std::min(axisIds[i] / 3, 2);
+			if(overlap < minOverlap[group]){
+				minOverlap[group] = overlap;
+				bestAxis[group] = L;
+				bestId[group] = axisIds[i];
+			}
+		}
+		int best = pickAxis(minOverlap);
+		glm::vec3 normal = bestAxis[best];
+
+		//ensure the normal points from A to B
+		if (glm::dot(normal, d) < 0){
+			normal = -normal;
+		}
+		return { true, minOverlap[best], normal, bestId[best] };
+			
+	}
+
+	SATResult PhysicsClass::testTriangleVsOBB(const glm::vec3* triangle, const OBB& box, float margin) {
+		const glm::vec3 edges[3] = { triangle[1] - triangle[0], triangle[2] - triangle[1], triangle[0] - triangle[2] };
+		const glm::vec3 faceNormal = glm::normalize(glm::cross(edges[0], triangle[2] - triangle[0]));
+		const glm::vec3 toBox = box.center - (triangle[0] + triangle[1] + triangle[2]) / 3.f;
+
+		//triangle normal, box faces, edge crosses. the axis ids follow SATResult with the triangle as A and its normal as face 0
+		glm::vec3 axes[13];
+		int axisIds[13];
+		int axisCount = 0;
+		axisIds[axisCount] = 0; axes[axisCount++] = faceNormal;
+		for (int i = 0; i < 3; i++) { axisIds[axisCount] = 3 + i; axes[axisCount++] = box.axis[i]; }
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				glm::vec3 axis = glm::cross(edges[i], box.axis[j]);
+				float length2 = glm::dot(axis, axis);
+				if (length2 > 1e-6f * glm::dot(edges[i], edges[i])) {
+					axisIds[axisCount] = 6 + i * 3 + j;
+					axes[axisCount++] = axis / std::sqrt(length2);
+				}
+			}
+		}
+
+		SATResult result{ false, FLT_MAX, faceNormal, -1 };
+		float facePenetration = FLT_MAX;
+		for (int i = 0; i < axisCount; i++) {
+			glm::vec3 L = axes[i];
+			//the triangle normal always pushes the box out the front, the other axes push towards the box's side
+			if (i > 0 && glm::dot(L, toBox) < 0.f) L = -L;
+			float triMax = std::max(glm::dot(triangle[0], L), std::max(glm::dot(triangle[1], L), glm::dot(triangle[2], L)));
+			float triMin = std::min(glm::dot(triangle[0], L), std::min(glm::dot(triangle[1], L), glm::dot(triangle[2], L)));
+			float r =
+				box.halfSize.x * std::abs(glm::dot(box.axis[0], L)) +
+				box.halfSize.y * std::abs(glm::dot(box.axis[1], L)) +
+				box.halfSize.z * std::abs(glm::dot(box.axis[2], L));
+			float center = glm::dot(box.center, L);
+			if (center - r > triMax + margin || center + r < triMin - margin) return { false };
+			float penetration = triMax - (center - r);
+			if (i == 0) facePenetration = penetration;
+			if (penetration < result.penetration) result = { true, penetration, L, axisIds[i] };
+		}
+		//the face keeps boxes sliding over a flat mesh from catching on the edges between its triangles
+		if (facePenetration <= result.penetration + 1e-3f) result = { true, facePenetration, faceNormal, 0 };
+		return result;
+	}
+
+	//SAT kernel over V::width pairs at once, one pair per lane.
+	//with R[i][j] = dot(A.axis[i], B.axis[j]) and t = d in A's frame every projection is a few multiply adds:
+	//for the edge axis L = A[i] x B[j], A[k] . L = +-R[m][j] where m is the third index, so nothing needs normalizing 
+	//until the overlap is divided by |L| = sqrt(1 - R[i][j]^2). Real-Time Collision Detection (Ericson) 4.4.1
+	template<typename V>
+	static void satKernel(const OBB* a, const OBB* b, SATResult* out) {
+		constexpr int W = V::width;
+
+		//transpose the pairs so each value sits in its own register with one lane per pair
+		float aAxis[3][3][W], bAxis[3][3][W], aHalf[3][W], bHalf[3][W], d[3][W];
+		for (int l = 0; l < W; l++) {
+			glm::vec3 delta = b[l].center - a[l].center;
+			for (int i = 0; i < 3; i++) {
+				for (int c = 0; c < 3; c++) {
+					aAxis[i][c][l] = a[l].axis[i][c];
+					bAxis[i][c][l] = b[l].axis[i][c];
+				}
+				aHalf[i][l] = a[l].halfSize[i];
+				bHalf[i][l] = b[l].halfSize[i];
+				d[i][l] = delta[i];
+			}
+		}
+
+		V A[3][3], B[3][3], ha[3], hb[3], D[3];
+		for (int i = 0; i < 3; i++) {
+			for (int c = 0; c < 3; c++) {
+				A[i][c] = V::load(aAxis[i][c]);
+				B[i][c] = V::load(bAxis[i][c]);
+			}
+			ha[i] = V::load(aHalf[i]);
+			hb[i] = V::load(bHalf[i]);
+			D[i] = V::load(d[i]);
+		}
+
+		V R[3][3], AbsR[3][3], t[3];
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				R[i][j] = A[i][0] * B[j][0] + A[i][1] * B[j][1] + A[i][2] * B[j][2];
+				AbsR[i][j] = abs(R[i][j]);
+			}
+			t[i] = D[0] * A[i][0] + D[1] * A[i][1] + D[2] * A[i][2];
+		}
+
+		const V zero = V::set1(0.f);
+		const V one = V::set1(1.f);
+		const int allLanes = (1 << W) - 1;
+		//best overlap and axis id of each candidate group: faces of A, faces of B, edges. see pickAxis
+		V minOverlap[3] = { V::set1(FLT_MAX), V::set1(FLT_MAX), V::set1(FLT_MAX) };
+		V bestAxis[3] = { V::set1(-1.f), V::set1(-1.f), V::set1(-1.f) };
+		V separated = zero; //mask of lanes that found a separating axis
+
+		//valid masks out degenerate edge axes, invLength turns the overlap into a distance along the unit axis
+		auto testAxis = [&](V ra, V rb, V dist, V invLength, V valid, int axisId) {
+			V overlap = (ra + rb) - dist;
+			separated = separated | (cmplt(overlap, zero) & valid);
+			overlap = overlap * invLength;
+			const int group = std::min(axisId / 3, 2);
+			V better = cmplt(overlap, minOverlap[group]) & valid;
+			minOverlap[group] = select(better, overlap, minOverlap[group]);
+			bestAxis[group] = select(better, V::set1(static_cast<float>(axisId)), bestAxis[group]);
+			return movemask(separated) == allLanes;
+		};
+		const V allValid = cmple(zero, one);
+
+		bool done = false;
+		//face axes of A
+		for (int i = 0; i < 3 && !done; i++) {
+			V rb = hb[0] * AbsR[i][0] + hb[1] * AbsR[i][1] + hb[2] * AbsR[i][2];
+			done = testAxis(ha[i], rb, abs(t[i]), one, allValid, i);
+		}
+		//face axes of B
+		for (int j = 0; j < 3 && !done; j++) {
+			V ra = ha[0] * AbsR[0][j] + ha[1] * AbsR[1][j] + ha[2] * AbsR[2][j];
+			V dist = abs(t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j]);
+			done = testAxis(ra, hb[j], dist, one, allValid, 3 + j);
+		}
+		//edge axes A[i] x B[j]
+		const V epsilon = V::set1(1e-6f);
+		for (int i = 0; i < 3 && !done; i++) {
+			int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+			for (int j = 0; j < 3 && !done; j++) {
+				int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+				V lengthSq = one - R[i][j] * R[i][j];
+				V valid = cmpgt(lengthSq, epsilon);
+				V invLength = one / sqrt(max(lengthSq, epsilon));
+
+				V ra = ha[i1] * AbsR[i2][j] + ha[i2] * AbsR[i1][j];
+				V rb = hb[j1] * AbsR[i][j2] + hb[j2] * AbsR[i][j1];
+				V dist = abs(t[i2] * R[i1][j] - t[i1] * R[i2][j]);
+				done = testAxis(ra, rb, dist, invLength, valid, 6 + i * 3 + j);
+			}
+		}
+
+		float overlap[3][W], axis[3][W];
+		for (int g = 0; g < 3; g++) {
+			minOverlap[g].store(overlap[g]);
+			bestAxis[g].store(axis[g]);
+		}
+		int separatedLanes = movemask(separated);
+
+		//the winning axis is rebuilt in world space only for lanes that hit
+		for (int l = 0; l < W; l++) {
+			if ((separatedLanes >> l) & 1) {
+				out[l] = { false };
+				continue;
+			}
+			float laneOverlap[3] = { overlap[0][l], overlap[1][l], overlap[2][l] };
+			int best = pickAxis(laneOverlap);
+			int id = static_cast<int>(axis[best][l]);
+			glm::vec3 normal;
+			if (id < 3) normal = a[l].axis[id];
+			else if (id < 6) normal = b[l].axis[id - 3];
+			else normal = glm::normalize(glm::cross(a[l].axis[(id - 6) / 3], b[l].axis[(id - 6) % 3]));
+
+			//ensure the normal points from A to B
+			if (glm::dot(normal, b[l].center - a[l].center) < 0) normal = -normal;
+			out[l] = { true, laneOverlap[best], normal, id };
+		}
+	}
+
+	void PhysicsClass::testOBBvsOBBBatch(const OBB* a, const OBB* b, uint32_t count, SATResult* out) {
+		uint32_t i = 0;
+		constexpr uint32_t W = simd::FloatN::width;
+		for (; i + W <= count; i += W) satKernel<simd::FloatN>(a + i, b + i, out + i);
+		for (; i < count; i++) satKernel<simd::Float1>(a + i, b + i, out + i);
+	}
+
+	//a vertex of the clipped polygon plus the line its outgoing edge lies on: 0-3 an incident face edge, 4-7 a reference side plane
+	struct ClipVertex {
+		glm::vec3 position;
+		uint32_t feature; //0-3 incident corner, 4-19 incident edge x side plane, 20-35 side plane x side plane
+		uint32_t edge;
+	};
+
+	//Sutherland-Hodgman against one plane, keeps dot(p, normal) <= offset. a convex polygon gains at most one vertex per plane
+	static uint32_t clipPolygon(const ClipVertex* in, uint32_t count, ClipVertex* out, const glm::vec3& normal, float offset, uint32_t plane) {
+		uint32_t outCount = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			const ClipVertex& p = in[i];
+			const ClipVertex& q = in[(i + 1) % count];
+			float dp = glm::dot(p.position, normal) - offset;
+			float dq = glm::dot(q.position, normal) - offset;
+
+			if (dp <= 0.f) out[outCount++] = p;
+			if ((dp <= 0.f) != (dq <= 0.f)) {
+				ClipVertex v;
+				v.position = p.position + (q.position - p.position) * (dp / (dp - dq));
+				v.feature = (p.edge < 4 ? 4 + p.edge * 4 : 20 + (p.edge - 4) * 4) + plane;
+				//leaving the plane the new edge runs along it, entering it continues on p's line
+				v.edge = dp <= 0.f ? 4 + plane : p.edge;
+				out[outCount++] = v;
+			}
+		}
+		return outCount;
+	}
+
+	//copies found into the manifold, cut down to maxPoints when there are more
+	static void reduceContacts(const Contact* found, uint32_t foundCount, const glm::vec3& faceNormal, ContactManifold& m) {
+		if (foundCount <= ContactManifold::maxPoints) {
+			std::copy(found, found + foundCount, m.points);
+			m.pointCount = foundCount;
+			return;
+		}
+
+		//too many points: the deepest, the one furthest from it, then the ones making the biggest triangle on each side of that line
+		uint32_t pick[4] = { 0, 0, 0, 0 };
+		for (uint32_t k = 1; k < foundCount; k++) {
+			if (found[k].penetration > found[pick[0]].penetration) pick[0] = k;
+		}
+		float bestDist = -1.f;
+		for (uint32_t k = 0; k < foundCount; k++) {
+			glm::vec3 d = found[k].point - found[pick[0]].point;
+			float dist = glm::dot(d, d);
+			if (dist > bestDist) { bestDist = dist; pick[1] = k; }
+		}
+		float maxArea = -FLT_MAX, minArea = FLT_MAX;
+		glm::vec3 line = found[pick[1]].point - found[pick[0]].point;
+		for (uint32_t k = 0; k < foundCount; k++) {
+			float area = glm::dot(glm::cross(line, found[k].point - found[pick[0]].point), faceNormal);
+			if (area > maxArea) { maxArea = area; pick[2] = k; }
+			if (area < minArea) { minArea = area; pick[3] = k; }
+		}
+		m.pointCount = 0;
+		for (int k = 0; k < 4; k++) {
+			//a polygon lying on one side of the line picks a point twice
+			if (std::find(pick, pick + k, pick[k]) != pick + k) continue;
+			m.points[m.pointCount++] = found[pick[k]];
+		}
+	}
+
+	void PhysicsClass::boxContactPoints(const OBB& a, const OBB& b, const SATResult& sat, ContactManifold& m, float margin) {
+		const glm::vec3 n = sat.normal;
+		const uint32_t axisId = static_cast<uint32_t>(sat.axis);
+
+		if (sat.axis >= 6) {
+			//edge-edge: the touching edges are the ones furthest along n on A and against n on B
+			int i = (sat.axis - 6) / 3, j = (sat.axis - 6) % 3;
+			glm::vec3 pA = a.center, pB = b.center;
+			for (int k = 0; k < 3; k++) {
+				if (k != i) pA += a.axis[k] * (glm::dot(a.axis[k], n) > 0.f ? a.halfSize[k] : -a.halfSize[k]);
+				if (k != j) pB += b.axis[k] * (glm::dot(b.axis[k], n) > 0.f ? -b.halfSize[k] : b.halfSize[k]);
+			}
+			//closest points between the two edge lines, clamped to the edges
+			const glm::vec3& dA = a.axis[i];
+			const glm::vec3& dB = b.axis[j];
+			glm::vec3 r = pA - pB;
+			float dAB = glm::dot(dA, dB);
+			float denom = 1.f - dAB * dAB; //axes are unit length, SAT skipped parallel edges
+			float s = denom > 1e-6f ? (dAB * glm::dot(dB, r) - glm::dot(dA, r)) / denom : 0.f;
+			s = glm::clamp(s, -a.halfSize[i], a.halfSize[i]);
+			float t = glm::clamp(glm::dot(dB, pA + dA * s - pB), -b.halfSize[j], b.halfSize[j]);
+
+			Contact& c = m.points[0];
+			c.point = (pA + dA * s + pB + dB * t) * 0.5f;
+			c.penetration = sat.penetration;
+			c.id = axisId;
+			m.pointCount = 1;
+			return;
+		}
+
+		//reference face: the SAT face, on A for axes 0-2 and on B for 3-5. its outward normal faces the other box
+		const bool referenceIsA = sat.axis < 3;
+		const OBB& ref = referenceIsA ? a : b;
+		const OBB& inc = referenceIsA ? b : a;
+		const int refAxis = sat.axis % 3;
+		const glm::vec3 toIncident = referenceIsA ? n : -n;
+		const glm::vec3 faceNormal = glm::dot(ref.axis[refAxis], toIncident) > 0.f ? ref.axis[refAxis] : -ref.axis[refAxis];
+		const float faceOffset = glm::dot(ref.center, faceNormal) + ref.halfSize[refAxis];
+
+		//incident face: the face of the other box most opposed to the reference normal
+		int incAxis = 0;
+		float bestDot = -1.f;
+		for (int k = 0; k < 3; k++) {
+			float d = std::abs(glm::dot(inc.axis[k], faceNormal));
+			if (d > bestDot) { bestDot = d; incAxis = k; }
+		}
+		glm::vec3 incCenter = inc.center + inc.axis[incAxis] * (glm::dot(inc.axis[incAxis], faceNormal) > 0.f ? -inc.halfSize[incAxis] : inc.halfSize[incAxis]);
+		glm::vec3 eu = inc.axis[(incAxis + 1) % 3] * inc.halfSize[(incAxis + 1) % 3];
+		glm::vec3 ev = inc.axis[(incAxis + 2) % 3] * inc.halfSize[(incAxis + 2) % 3];
+
+		//4 corners, every side plane can add one vertex
+		ClipVertex polygon[8], clipped[8];
+		polygon[0] = { incCenter + eu + ev, 0, 0 };
+		polygon[1] = { incCenter - eu + ev, 1, 1 };
+		polygon[2] = { incCenter - eu - ev, 2, 2 };
+		polygon[3] = { incCenter + eu - ev, 3, 3 };
+		uint32_t count = 4;
+
+		//side planes of the reference face
+		for (int side = 0; side < 4 && count > 0; side++) {
+			int k = (refAxis + 1 + side / 2) % 3;
+			glm::vec3 planeNormal = (side & 1) ? -ref.axis[k] : ref.axis[k];
+			float offset = glm::dot(ref.center, planeNormal) + ref.halfSize[k];
+			count = clipPolygon(polygon, count, clipped, planeNormal, offset, side);
+			std::copy(clipped, clipped + count, polygon);
+		}
+
+		//keep what is below the reference face (or within the speculative margin above it), the contact sits halfway between the face and the incident point
+		Contact found[8];
+		uint32_t foundCount = 0;
+		for (uint32_t k = 0; k < count; k++) {
+			float separation = glm::dot(polygon[k].position, faceNormal) - faceOffset;
+			if (separation > margin) continue;
+			Contact& c = found[foundCount++];
+			c.point = polygon[k].position - faceNormal * (separation * 0.5f);
+			c.penetration = -separation;
+			c.id = axisId | (polygon[k].feature << 8);
+		}
+
+		if (foundCount == 0) {
+			//touching within rounding, one point between the centers keeps the pair alive
+			Contact& c = m.points[0];
+			c.point = (a.center + b.center) * 0.5f;
+			c.penetration = sat.penetration;
+			c.id = axisId;
+			m.pointCount = 1;
+			return;
+		}
+
+		reduceContacts(found, foundCount, faceNormal, m);
+	}
+
+	void PhysicsClass::detectCollisions() {
+
+		std::swap(manifolds, previousManifolds);
+		manifolds.clear();
+		std::swap(convexCache, previousConvexCache);
+		convexCache.clear();
+		auto byKey = [](const ConvexCacheEntry& x, const ConvexCacheEntry& y) { return x.key < y.key; };
+		const size_t pairCount = aabbPairs.size();
+		const size_t chunkSize = std::max<size_t>(settings.narrowPhaseChunkSize, 1);
+		NarrowPhaseCounts counts;
+		auto countStats = [&]() {
+			stats.satTests = counts.satTests;
+			stats.satHits = counts.satHits;
+			stats.gjkTests = counts.gjkTests;
+			stats.gjkHits = counts.gjkHits;
+		};
+		if (!jobPool || pairCount <= chunkSize) {
+			detectCollisionsRange(0, pairCount, manifolds, convexCache, counts);
+			std::sort(convexCache.begin(), convexCache.end(), byKey);
+			countStats();
+			matchManifolds();
+			splitTriggers();
+			return;
+		}
+
+		//every chunk writes its own buffer, then the buffers are appended in chunk order.
+		//that is the same order the serial loop produces, so the result is identical no matter how many threads ran
+		const uint32_t chunkCount = static_cast<uint32_t>((pairCount + chunkSize - 1) / chunkSize);
+		if (chunkManifolds.size() < chunkCount) chunkManifolds.resize(chunkCount);
+		if (chunkConvexCache.size() < chunkCount) chunkConvexCache.resize(chunkCount);
+		if (chunkCounts.size() < chunkCount) chunkCounts.resize(chunkCount);
+
+		jobPool->run(chunkCount, [&](uint32_t chunk) {
+			std::vector<ContactManifold>& out = chunkManifolds[chunk];
+			out.clear();
+			chunkConvexCache[chunk].clear();
+			chunkCounts[chunk] = {};
+			size_t begin = chunk * chunkSize;
+			detectCollisionsRange(begin, std::min(begin + chunkSize, pairCount), out, chunkConvexCache[chunk], chunkCounts[chunk]);
+		});
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+			manifolds.insert(manifolds.end(), chunkManifolds[chunk].begin(), chunkManifolds[chunk].end());
+			convexCache.insert(convexCache.end(), chunkConvexCache[chunk].begin(), chunkConvexCache[chunk].end());
+			counts.satTests += chunkCounts[chunk].satTests;
+			counts.satHits += chunkCounts[chunk].satHits;
+			counts.gjkTests += chunkCounts[chunk].gjkTests;
+			counts.gjkHits += chunkCounts[chunk].gjkHits;
+		}
+		std::sort(convexCache.begin(), convexCache.end(), byKey);
+		countStats();
+		matchManifolds();
+		splitTriggers();
+	}
+
+	void PhysicsClass::matchManifolds() {
+		//sorted by collider pair the solver order doesn't depend on which broadphase found the pair,
+		//and both lists can be matched in one walk
+		std::sort(manifolds.begin(), manifolds.end(), ContactManifold::before);
+
+		size_t old = 0;
+		for (ContactManifold& m : manifolds) {
+			while (old < previousManifolds.size() && ContactManifold::before(previousManifolds[old], m)) old++;
+			if (old == previousManifolds.size()) break;
+			const ContactManifold& last = previousManifolds[old];
+			if (last.key != m.key || last.subKey != m.subKey) continue;
+
+			for (uint32_t p = 0; p < m.pointCount; p++) {
+				for (uint32_t q = 0; q < last.pointCount; q++) {
+					if (last.points[q].id != m.points[p].id) continue;
+					m.points[p].normalImpulse = last.points[q].normalImpulse;
+					m.points[p].tangentImpulse[0] = last.points[q].tangentImpulse[0];
+					m.points[p].tangentImpulse[1] = last.points[q].tangentImpulse[1];
+					break;
+				}
+			}
+			//the friction basis is kept while the normal barely moves, otherwise the tangent impulses point the wrong way.
+			//it is projected back onto the new contact plane so friction never pushes along the normal
+			if (glm::dot(last.normal, m.normal) > 0.99f) {
+				m.tangent[0] = glm::normalize(last.tangent[0] - m.normal * glm::dot(last.tangent[0], m.normal));
+				m.tangent[1] = glm::cross(m.normal, m.tangent[0]);
+			}
+		}
+	}
+
+	void PhysicsClass::splitTriggers() {
+		//both lists stay sorted by key
+		triggerManifolds.clear();
+		size_t kept = 0;
+		for (size_t k = 0; k < manifolds.size(); k++) {
+			const ContactManifold& m = manifolds[k];
+			if (colliders[static_cast<uint32_t>(m.key >> 32)].trigger || colliders[static_cast<uint32_t>(m.key)].trigger) {
+				triggerManifolds.push_back(m);
+			}
+			else {
+				if (kept != k) manifolds[kept] = m;
+				kept++;
+			}
+		}
+		manifolds.resize(kept);
+	}
+
+	void PhysicsClass::updateContactEvents() {
+		contactEvents.clear();
+		if (!settings.contactEvents) {
+			touching.clear();
+			removedBodies.clear();
+			return;
+		}
+
+		auto slotA = [](const TouchingPair& pair) { return static_cast<uint32_t>(pair.key >> 35); };
+		auto slotB = [](const TouchingPair& pair) { return static_cast<uint32_t>(pair.key) >> 3; };
+		auto setBody = [&](uint32_t slot, const RemovedBody* removed, BodyHandle& handle, int& objId) {
+			handle = removed ? removed->handle : BodyHandle{ slot, slotGeneration[slot] };
+			objId = removed ? removed->objId : bodies.objId[slotIndex[slot]];
+		};
+		auto makeEvent = [&](ContactEventType type, const TouchingPair& pair, const RemovedBody* removedA = nullptr, const RemovedBody* removedB = nullptr) {
+			ContactEvent event{};
+			event.type = type;
+			event.trigger = pair.trigger != 0;
+			setBody(slotA(pair), removedA, event.bodyA, event.objIdA);
+			setBody(slotB(pair), removedB, event.bodyB, event.objIdB);
+			if (type != ContactEventType::End && !pair.trigger) {
+				const ContactManifold& m = manifolds[pair.manifold];
+				event.normal = pair.flipped ? -m.normal : m.normal;
+				//a mesh pair can have a manifold per face direction, they follow each other in the list
+				for (size_t k = pair.manifold; k < manifolds.size() && manifolds[k].key == m.key; k++) {
+					for (uint32_t p = 0; p < manifolds[k].pointCount; p++) event.impulse += manifolds[k].points[p].normalImpulse;
+				}
+			}
+			return event;
+		};
+
+		//pairs of bodies removed since the last step end first, before the diff could mistake a body that reused the slot for them.
+		//a slot freed and reused twice keeps the first record, that is the body the pair was made with
+		if (!removedBodies.empty()) {
+			std::stable_sort(removedBodies.begin(), removedBodies.end(), [](const RemovedBody& x, const RemovedBody& y) { return x.slot < y.slot; });
+			auto removed = [&](uint32_t slot) -> const RemovedBody* {
+				auto it = std::lower_bound(removedBodies.begin(), removedBodies.end(), slot, [](const RemovedBody& x, uint32_t s) { return x.slot < s; });
+				return it != removedBodies.end() && it->slot == slot ? &*it : nullptr;
+			};
+			size_t kept = 0;
+			for (const TouchingPair& pair : touching) {
+				const RemovedBody* a = removed(slotA(pair));
+				const RemovedBody* b = removed(slotB(pair));
+				if (a || b) contactEvents.push_back(makeEvent(ContactEventType::End, pair, a, b));
+				else touching[kept++] = pair;
+			}
+			touching.resize(kept);
+			removedBodies.clear();
+		}
+
+		//this step's pairs in key order
+		touchingScratch.clear();
+		auto collect = [&](const std::vector<ContactManifold>& list, uint16_t trigger) {
+			for (uint32_t k = 0; k < list.size(); k++) {
+				if (k > 0 && list[k - 1].key == list[k].key) continue; //the same pair again, a mesh with another face direction
+				uint32_t a = colliderName(static_cast<uint32_t>(list[k].key >> 32));
+				uint32_t b = colliderName(static_cast<uint32_t>(list[k].key));
+				const uint16_t flipped = a > b;
+				if (flipped) std::swap(a, b);
+				touchingScratch.push_back({ (static_cast<uint64_t>(a) << 32) | b, k, trigger, flipped });
+			}
+		};
+		collect(manifolds, 0);
+		collect(triggerManifolds, 1);
+		auto byKey = [](const TouchingPair& x, const TouchingPair& y) { return x.key < y.key; };
+		std::sort(touchingScratch.begin(), touchingScratch.end(), byKey);
+
+		//a pair missing this step ended, unless both bodies were resting during the broadphase. resting pairs aren't tested,
+		//they still touch and are carried over without events until one of the islands wakes up
+		carriedPairs.clear();
+		auto missing = [&](const TouchingPair& pair) {
+			if (slotIndex[slotA(pair)] >= awakeAtBroadphase && slotIndex[slotB(pair)] >= awakeAtBroadphase) {
+				carriedPairs.push_back({ pair.key, noManifold, pair.trigger, 0 });
+				return;
+			}
+			contactEvents.push_back(makeEvent(ContactEventType::End, pair));
+		};
+		size_t old = 0;
+		for (const TouchingPair& pair : touchingScratch) {
+			while (old < touching.size() && touching[old].key < pair.key) missing(touching[old++]);
+			const bool stayed = old < touching.size() && touching[old].key == pair.key;
+			if (stayed) old++;
+			contactEvents.push_back(makeEvent(stayed ? ContactEventType::Stay : ContactEventType::Begin, pair));
+		}
+		while (old < touching.size()) missing(touching[old++]);
+
+		if (!carriedPairs.empty()) {
+			const size_t found = touchingScratch.size();
+			touchingScratch.insert(touchingScratch.end(), carriedPairs.begin(), carriedPairs.end());
+			std::inplace_merge(touchingScratch.begin(), touchingScratch.begin() + found, touchingScratch.end(), byKey);
+		}
+		std::swap(touching, touchingScratch);
+	}
+
+	//copies a, b and the normal into every point and picks the friction directions
+	static void finishManifold(ContactManifold& m) {
+		for (uint32_t p = 0; p < m.pointCount; p++) {
+			m.points[p].a = m.A;
+			m.points[p].b = m.B;
+			m.points[p].normal = m.normal;
+		}
+		//reducing may have left points behind the count, they would otherwise end up in snapshots
+		std::memset(m.points + m.pointCount, 0, (ContactManifold::maxPoints - m.pointCount) * sizeof(Contact));
+
+		//any vector perpendicular to the normal works as the first friction direction
+		glm::vec3 helper = std::abs(m.normal.x) < 0.57f ? glm::vec3{ 1.f, 0.f, 0.f } : glm::vec3{ 0.f, 1.f, 0.f };
+		m.tangent[0] = glm::normalize(glm::cross(m.normal, helper));
+		m.tangent[1] = glm::cross(m.normal, m.tangent[0]);
+	}
+
+	void PhysicsClass::detectCollisionsRange(size_t begin, size_t end, std::vector<ContactManifold>& out, std::vector<ConvexCacheEntry>& convexOut, NarrowPhaseCounts& counts) {
+		//box pairs are collected and go through the SAT kernel a register's worth at a time, pairs with a sphere are tested right away.
+		//the order manifolds come out in doesn't matter, matchManifolds sorts them by key
+		constexpr uint32_t batchSize = simd::FloatN::width;
+		OBB A[batchSize], B[batchSize];
+		SATResult results[batchSize];
+		size_t batchPairs[batchSize];
+		float batchMargins[batchSize];
+		uint32_t count = 0;
+
+		auto startManifold = [&](size_t pair) {
+			auto [iA, iB] = aabbPairs[pair];
+			ContactManifold m;
+			m.key = (static_cast<uint64_t>(iA) << 32) | iB;
+			m.A = colliders[iA].bodyIndex;
+			m.B = colliders[iB].bodyIndex;
+			return m;
+		};
+
+		auto flush = [&]() {
+			testOBBvsOBBBatch(A, B, count, results);
+			counts.satTests += count;
+			for (uint32_t k = 0; k < count; k++) {
+				//the kernel only knows overlapping or not, a continuous pair that is apart gets a second look with its margin
+				if (!results[k].hit && batchMargins[k] > 0.f) results[k] = testOBBvsOBB(A[k], B[k], batchMargins[k]);
+				if (!results[k].hit) continue;
+				counts.satHits++;
+				ContactManifold m = startManifold(batchPairs[k]);
+				m.normal = results[k].normal;
+				boxContactPoints(A[k], B[k], results[k], m, batchMargins[k]);
+				finishManifold(m);
+				out.push_back(m);
+			}
+			count = 0;
+		};
+
+		for (size_t n = begin; n < end; n++) {
+			auto [iA, iB] = aabbPairs[n];
+			const Collider& colliderA = colliders[iA];
+			const Collider& colliderB = colliders[iB];
+			//a trigger only reports real overlaps
+			const float margin = colliderA.trigger || colliderB.trigger ? 0.f : speculativeMargin(colliderA, colliderB);
+
+			if (colliderA.shape == ColliderShape::Box && colliderB.shape == ColliderShape::Box) {
+				A[count] = buildOBB(iA);
+				B[count] = buildOBB(iB);
+				batchMargins[count] = margin;
+				batchPairs[count++] = n;
+				if (count == batchSize) flush();
+				continue;
+			}
+
+			const bool levelA = colliderA.shape == ColliderShape::Mesh || colliderA.shape == ColliderShape::HeightField;
+			const bool levelB = colliderB.shape == ColliderShape::Mesh || colliderB.shape == ColliderShape::HeightField;
+			if (levelA || levelB) {
+				if (levelA && levelB) continue; //level geometry against level geometry
+				if (levelA) meshManifolds(iA, iB, margin, out, counts);
+				else meshManifolds(iB, iA, margin, out, counts);
+				continue;
+			}
+
+			if (colliderA.shape == ColliderShape::Convex || colliderB.shape == ColliderShape::Convex) {
+				ContactManifold m = startManifold(n);
+				counts.gjkTests++;
+				if (!convexManifold(iA, iB, margin, m, convexOut)) continue;
+				counts.gjkHits++;
+				finishManifold(m);
+				out.push_back(m);
+				continue;
+			}
+
+			Contact c;
+			bool hit;
+			if (colliderA.shape == ColliderShape::Sphere && colliderB.shape == ColliderShape::Sphere) {
+				hit = sphereSphere(bodies.position(colliderA.bodyIndex), colliderA.radius, bodies.position(colliderB.bodyIndex), colliderB.radius, c, margin);
+			}
+			else if (colliderA.shape == ColliderShape::Sphere) {
+				hit = sphereOBB(bodies.position(colliderA.bodyIndex), colliderA.radius, buildOBB(iB), c, margin);
+			}
+			else {
+				//the test puts the sphere first, flip so the normal still goes from A to B
+				hit = sphereOBB(bodies.position(colliderB.bodyIndex), colliderB.radius, buildOBB(iA), c, margin);
+				c.normal = -c.normal;
+			}
+			if (!hit) continue;
+
+			ContactManifold m = startManifold(n);
+			m.normal = c.normal;
+			c.id = 0; //a sphere only ever has the one point
+			m.points[0] = c;
+			m.pointCount = 1;
+			finishManifold(m);
+			out.push_back(m);
+		}
+		if (count > 0) flush();
+	}
+
+
+	ConvexShape PhysicsClass::convexShape(uint32_t collider, const glm::mat3& rotation, const BoxPolytope& box) const {
+		const Collider& c = colliders[collider];
+		const glm::vec3 position = bodies.position(c.bodyIndex);
+		switch (c.shape) {
+		case ColliderShape::Sphere: return ConvexShape::sphere(position, c.radius);
+		case ColliderShape::Convex: return ConvexShape::hull(convexHulls[c.hull], rotation, position);
+		default: return ConvexShape::box(box, rotation, position);
+		}
+	}
+
+	bool PhysicsClass::convexManifold(uint32_t colliderA, uint32_t colliderB, float margin, ContactManifold& m, std::vector<ConvexCacheEntry>& cacheOut) const {
+		const BoxPolytope boxA{ colliders[colliderA].halfSize }, boxB{ colliders[colliderB].halfSize };
+		const ConvexShape a = convexShape(colliderA, bodyAxes[m.A], boxA);
+		const ConvexShape b = convexShape(colliderB, bodyAxes[m.B], boxB);
+
+		//last step's simplex for the pair, if it was tested
+		GjkCache cache;
+		auto cached = std::lower_bound(previousConvexCache.begin(), previousConvexCache.end(), m.key,
+			[](const ConvexCacheEntry& entry, uint64_t key) { return entry.key < key; });
+		if (cached != previousConvexCache.end() && cached->key == m.key) cache = cached->cache;
+		const GjkResult result = gjk(a, b, cache);
+		cacheOut.push_back({ m.key, cache });
+
+		//GJK and EPA work on the cores, the radius of a sphere goes on top
+		const float radius = a.radius + b.radius;
+		float penetration;
+		glm::vec3 pointA, pointB;
+		if (!result.overlap) {
+			if (result.distance - radius > margin) return false;
+			m.normal = (result.pointB - result.pointA) / result.distance;
+			penetration = radius - result.distance;
+			pointA = result.pointA;
+			pointB = result.pointB;
+		}
+		else if (epa(a, b, result.simplex, m.normal, penetration, pointA, pointB)) {
+			penetration += radius;
+		}
+		else {
+			//the cores only touch, too thin for EPA to find a direction. push along the line between the centers
+			glm::vec3 d = b.position - a.position;
+			m.normal = glm::dot(d, d) > 1e-12f ? glm::normalize(d) : glm::vec3{ 0.f, -1.f, 0.f };
+			penetration = radius;
+			pointA = pointB = (a.position + b.position) * 0.5f;
+		}
+
+		Contact& single = m.points[0];
+		single.point = (pointA + m.normal * a.radius + pointB - m.normal * b.radius) * 0.5f;
+		single.penetration = penetration;
+		single.id = 0;
+		m.pointCount = 1;
+		if (radius > 0.f) return true; //a sphere only ever has the one point
+
+		//polytopes: the faces around the normal clipped against each other give the rest of the manifold
+		ConvexContact clipped[ConvexHull::maxFaceVertices * 2];
+		const uint32_t clippedCount = clipContacts(a, b, m.normal, margin, clipped);
+		if (clippedCount == 0) return true; //touching within rounding, the one point keeps the pair alive
+		Contact found[ConvexHull::maxFaceVertices * 2];
+		for (uint32_t k = 0; k < clippedCount; k++) {
+			found[k].point = clipped[k].point;
+			found[k].penetration = clipped[k].penetration;
+			found[k].id = clipped[k].id;
+		}
+		reduceContacts(found, clippedCount, m.normal, m);
+		return true;
+	}
+
+	template<typename Fn>
+	void PhysicsClass::meshTriangles(uint32_t collider, const glm::mat3& rotation, const AABB& region, Fn&& fn) const {
+		//region into body space as the box around it
+		const Collider& c = colliders[collider];
+		const glm::mat3 toBody = glm::transpose(rotation);
+		const glm::vec3 position = bodies.position(c.bodyIndex);
+		const glm::vec3 center = toBody * ((region.min + region.max) * 0.5f - position);
+		const glm::vec3 half = (region.max - region.min) * 0.5f;
+		const glm::vec3 extent = glm::abs(toBody[0]) * half.x + glm::abs(toBody[1]) * half.y + glm::abs(toBody[2]) * half.z;
+		const AABB local{ center - extent, center + extent };
+		auto emit = [&](uint32_t tri, glm::vec3* v) {
+			for (int k = 0; k < 3; k++) v[k] = rotation * v[k] + position;
+			fn(tri, static_cast<const glm::vec3*>(v));
+		};
+		if (c.shape == ColliderShape::HeightField) {
+			const HeightField& heightField = heightFields[c.heightField];
+			heightField.query(local, [&](uint32_t tri) {
+				glm::vec3 v[3];
+				heightField.triangle(tri, v[0], v[1], v[2]);
+				emit(tri, v);
+			});
+			return;
+		}
+		const TriangleMesh& mesh = triangleMeshes[c.mesh];
+		mesh.query(local, [&](uint32_t tri) {
+			glm::vec3 v[3];
+			mesh.triangle(tri, v[0], v[1], v[2]);
+			emit(tri, v);
+		});
+	}
+
+	void PhysicsClass::meshManifolds(uint32_t meshCollider, uint32_t otherCollider, float margin, std::vector<ContactManifold>& out, NarrowPhaseCounts& counts) const {
+		const Collider& other = colliders[otherCollider];
+		const uint32_t meshBody = colliders[meshCollider].bodyIndex, otherBody = other.bodyIndex;
+
+		//the other collider's box picks the triangles
+		glm::vec3 center, extent;
+		colliderBounds(other, bodyAxes[otherBody], center, extent);
+		extent += margin;
+
+		//contacts of triangles facing about the same way share a manifold. more than maxPoints per group are cut down as they come
+		//in, the points are in mesh-to-other orientation until the end. a contact never joins a group facing another way, once
+		//all groups are taken it replaces the shallowest one if it is deeper. with a speculative margin a sphere or hull picks up
+		//points on far triangles too, and those must not bend the normal of the one it is about to land on
+		struct Group {
+			glm::vec3 normal;
+			uint32_t firstTriangle;
+			uint32_t count;
+			float deepest; //largest penetration of the points
+			Contact points[16];
+		};
+		Group groups[maxMeshManifolds];
+		uint32_t groupCount = 0;
+		auto add = [&](uint32_t tri, const glm::vec3& normal, const Contact* found, uint32_t count) {
+			ContactManifold incoming;
+			if (count > ContactManifold::maxPoints) {
+				reduceContacts(found, count, normal, incoming);
+				found = incoming.points;
+				count = incoming.pointCount;
+			}
+			float deepest = -FLT_MAX;
+			for (uint32_t k = 0; k < count; k++) deepest = std::max(deepest, found[k].penetration);
+			uint32_t g = 0;
+			float best = -FLT_MAX;
+			for (uint32_t k = 0; k < groupCount; k++) {
+				float alignment = glm::dot(groups[k].normal, normal);
+				if (alignment > best) { best = alignment; g = k; }
+			}
+			if (best <= 0.999f) {
+				if (groupCount < maxMeshManifolds) {
+					g = groupCount++;
+				}
+				else {
+					g = 0;
+					for (uint32_t k = 1; k < groupCount; k++) if (groups[k].deepest < groups[g].deepest) g = k;
+					if (groups[g].deepest >= deepest) return;
+				}
+				groups[g].normal = normal;
+				groups[g].firstTriangle = tri;
+				groups[g].count = 0;
+				groups[g].deepest = -FLT_MAX;
+			}
+			Group& group = groups[g];
+			group.firstTriangle = std::min(group.firstTriangle, tri);
+			group.deepest = std::max(group.deepest, deepest);
+			if (group.count + count > 16) {
+				ContactManifold reduced;
+				reduceContacts(group.points, group.count, group.normal, reduced);
+				std::copy(reduced.points, reduced.points + reduced.pointCount, group.points);
+				group.count = reduced.pointCount;
+			}
+			for (uint32_t k = 0; k < count; k++) {
+				group.points[group.count] = found[k];
+				group.points[group.count++].id ^= tri * 0x9E3779B1u; //the same feature on another triangle is another point
+			}
+		};
+
+		OBB box{};
+		const BoxPolytope boxPolytope{ other.halfSize };
+		ConvexShape shape;
+		if (other.shape == ColliderShape::Box) box = buildOBB(otherCollider);
+		if (other.shape != ColliderShape::Sphere) shape = convexShape(otherCollider, bodyAxes[otherBody], boxPolytope);
+		const glm::vec3 otherPos = bodies.position(otherBody);
+
+		meshTriangles(meshCollider, bodyAxes[meshBody], { center - extent, center + extent }, [&](uint32_t tri, const glm::vec3* v) {
+			const glm::vec3 faceNormal = glm::normalize(glm::cross(v[1] - v[0], v[2] - v[0]));
+			//one sided: a shape whose center went behind a triangle is left to the triangles it is in front of
+			if (glm::dot(center - v[0], faceNormal) < 0.f) return;
+
+			//a closest point inside the triangle rather than on an edge or corner means the face itself is what is closest
+			auto onFace = [&](const glm::vec3& p) {
+				for (int k = 0; k < 3; k++) {
+					const glm::vec3 edge = v[(k + 1) % 3] - v[k];
+					if (glm::dot(glm::cross(edge, p - v[k]), faceNormal) <= 1e-4f * glm::dot(edge, edge)) return false;
+				}
+				return true;
+			};
+
+			Contact found[ConvexHull::maxFaceVertices * 2];
+			glm::vec3 normal;
+			if (other.shape == ColliderShape::Sphere) {
+				const glm::vec3 closest = closestPointOnTriangle(otherPos, v[0], v[1], v[2]);
+				const glm::vec3 d = otherPos - closest;
+				const float dist2 = glm::dot(d, d);
+				const float reach = other.radius + margin;
+				if (dist2 > reach * reach) return;
+				const float dist = std::sqrt(dist2);
+				normal = dist > 1e-6f && !onFace(closest) ? d / dist : faceNormal;
+				found[0].penetration = other.radius - dist;
+				found[0].point = closest - normal * (found[0].penetration * 0.5f);
+				found[0].id = 0;
+				add(tri, normal, found, 1);
+				return;
+			}
+
+			const TrianglePolytope polytope{ v[0], v[1], v[2] };
+			const ConvexShape triangle = ConvexShape::triangle(polytope);
+			float penetration;
+			if (other.shape == ColliderShape::Box) {
+				counts.satTests++;
+				const SATResult sat = testTriangleVsOBB(v, box, margin);
+				if (!sat.hit) return;
+				counts.satHits++;
+				normal = sat.normal;
+				penetration = sat.penetration;
+			}
+			else {
+				GjkCache cache;
+				counts.gjkTests++;
+				const GjkResult result = gjk(triangle, shape, cache);
+				glm::vec3 pointA, pointB;
+				if (!result.overlap) {
+					if (result.distance > margin) return;
+					normal = onFace(result.pointA) ? faceNormal : (result.pointB - result.pointA) / result.distance;
+					penetration = -result.distance;
+				}
+				else if (!epa(triangle, shape, result.simplex, normal, penetration, pointA, pointB)) {
+					normal = faceNormal;
+					penetration = 0.f;
+				}
+				if (glm::dot(normal, faceNormal) < 0.f) {
+					//pushed out the back of a one sided triangle, out the front by how far the hull reaches behind the plane instead
+					normal = faceNormal;
+					penetration = glm::dot(faceNormal, v[0] - shape.vertex(shape.support(-faceNormal)));
+				}
+				counts.gjkHits++;
+			}
+
+			ConvexContact clipped[ConvexHull::maxFaceVertices * 2];
+			const uint32_t clippedCount = clipContacts(triangle, shape, normal, margin, clipped);
+			if (clippedCount == 0) {
+				//touching within rounding, the deepest point of the shape keeps the pair alive
+				found[0].point = shape.vertex(shape.support(-normal));
+				found[0].penetration = penetration;
+				found[0].id = 0;
+				add(tri, normal, found, 1);
+				return;
+			}
+			for (uint32_t k = 0; k < clippedCount; k++) {
+				found[k].point = clipped[k].point;
+				found[k].penetration = clipped[k].penetration;
+				found[k].id = clipped[k].id;
+			}
+			add(tri, normal, found, clippedCount);
+		});
+
+		//the key puts the lower collider first, the normal goes from A to B
+		const bool meshIsA = meshCollider < otherCollider;
+		for (uint32_t g = 0; g < groupCount; g++) {
+			ContactManifold m;
+			m.key = meshIsA ? (static_cast<uint64_t>(meshCollider) << 32) | otherCollider : (static_cast<uint64_t>(otherCollider) << 32) | meshCollider;
+			m.subKey = groups[g].firstTriangle;
+			m.A = meshIsA ? meshBody : otherBody;
+			m.B = meshIsA ? otherBody : meshBody;
+			m.normal = meshIsA ? groups[g].normal : -groups[g].normal;
+			reduceContacts(groups[g].points, groups[g].count, groups[g].normal, m);
+			finishManifold(m);
+			out.push_back(m);
+		}
+	}
+
+	void PhysicsClass::resolveCollisions() {
+		prepareContacts();
+		if (settings.solver == SolverType::GraphColored) colorContacts();
+
+		solverPass([this](uint32_t i) { warmStart(i); });
+		for (uint32_t iteration = 0; iteration < settings.solverIterations; iteration++) {
+			solverPass([this](uint32_t i) { solveManifold(i); });
+		}
+
+		// positional correction (use invMass-based distribution) once the velocities are solved
+		correctionLinear.assign(bodies.awakeCount, glm::vec3{ 0.f });
+		correctionAngular.assign(bodies.awakeCount, glm::vec3{ 0.f });
+		solverPass([this](uint32_t i) { positionalCorrection(i); });
+		applyCorrections();
+	}
+
+	template<typename Fn>
+	void PhysicsClass::solverPass(Fn&& fn) {
+		const uint32_t count = static_cast<uint32_t>(manifolds.size());
+		if (settings.solver != SolverType::GraphColored) {
+			for (uint32_t i = 0; i < count; i++) fn(i);
+			return;
+		}
+
+		//colors run one after another, the manifolds of one color touch different dynamic bodies so any thread can take any of them
+		const uint32_t chunkSize = std::max<uint32_t>(settings.solverChunkSize, 1);
+		for (uint32_t color = 0; color + 1 < colorOffsets.size(); color++) {
+			const uint32_t begin = colorOffsets[color];
+			const uint32_t end = colorOffsets[color + 1];
+			//the overflow color is last and may share bodies inside itself
+			if (!jobPool || end - begin <= chunkSize || color == maxSolverColors) {
+				for (uint32_t i = begin; i < end; i++) fn(colorOrder[i]);
+				continue;
+			}
+			jobPool->run((end - begin + chunkSize - 1) / chunkSize, [&](uint32_t chunk) {
+				const uint32_t chunkBegin = begin + chunk * chunkSize;
+				const uint32_t chunkEnd = std::min(chunkBegin + chunkSize, end);
+				for (uint32_t i = chunkBegin; i < chunkEnd; i++) fn(colorOrder[i]);
+			});
+		}
+	}
+
+	void PhysicsClass::colorContacts() {
+		//greedy coloring in key order: every manifold takes the lowest color neither of its dynamic bodies has yet.
+		//static bodies never move so any number of manifolds in a color may share one
+		const uint32_t count = static_cast<uint32_t>(manifolds.size());
+		bodyColors.assign(bodies.size(), 0);
+		manifoldColors.resize(count);
+		uint32_t colorCounts[maxSolverColors + 1] = {};
+
+		for (uint32_t i = 0; i < count; i++) {
+			const ContactManifold& m = manifolds[i];
+			const bool dynamicA = bodies.invMass[m.A] > 0.f;
+			const bool dynamicB = bodies.invMass[m.B] > 0.f;
+			uint64_t used = (dynamicA ? bodyColors[m.A] : 0) | (dynamicB ? bodyColors[m.B] : 0);
+			//a body touching more than maxSolverColors others spills into the overflow color, which runs serially
+			uint32_t color = used == ~0ull ? maxSolverColors : static_cast<uint32_t>(std::countr_zero(~used));
+			if (color < maxSolverColors) {
+				if (dynamicA) bodyColors[m.A] |= 1ull << color;
+				if (dynamicB) bodyColors[m.B] |= 1ull << color;
+			}
+			manifoldColors[i] = static_cast<uint8_t>(color);
+			colorCounts[color]++;
+		}
+
+		//counting sort by color, key order is kept inside a color so results don't depend on the thread count
+		uint32_t colorCount = 0;
+		for (uint32_t c = 0; c <= maxSolverColors; c++) {
+			if (colorCounts[c] > 0) colorCount = c + 1;
+		}
+		colorOffsets.assign(colorCount + 1, 0);
+		for (uint32_t c = 0; c < colorCount; c++) colorOffsets[c + 1] = colorOffsets[c] + colorCounts[c];
+		colorOrder.resize(count);
+		uint32_t cursor[maxSolverColors + 1];
+		std::copy(colorOffsets.begin(), colorOffsets.end() - 1, cursor);
+		for (uint32_t i = 0; i < count; i++) colorOrder[cursor[manifoldColors[i]]++] = i;
+	}
+
+	//impulse per unit of relative velocity along dir at the contact: 1 / (1/mA + 1/mB + (I_A^-1 (rA x dir) x rA + I_B^-1 (rB x dir) x rB) . dir)
+	static float effectiveMass(float invMassA, float invMassB, const glm::mat3& invInertiaA, const glm::mat3& invInertiaB,
+		const glm::vec3& rA, const glm::vec3& rB, const glm::vec3& dir) {
+		glm::vec3 angularA = glm::cross(invInertiaA * glm::cross(rA, dir), rA);
+		glm::vec3 angularB = glm::cross(invInertiaB * glm::cross(rB, dir), rB);
+		float k = invMassA + invMassB + glm::dot(angularA + angularB, dir);
+		return k > 0.f ? 1.f / k : 0.f;
+	}
+
+	void PhysicsClass::prepareContacts() {
+		const float restitution = 0.5f; //coefficient of restitution (bounciness)
+		//slower impacts don't bounce. without this a body resting under gravity bounces a little every step and never falls asleep
+		const float restitutionThreshold = 1.f;
+		//gaps smaller than this count as touching, so every corner of a face landing flat bounces instead of only the ones that got there first
+		const float speculativeSlop = 0.005f;
+
+		//bounce is decided from the approach speed before any impulse this step, so every bias is computed before the warm start changes velocities
+		solverPoints.resize(manifolds.size() * ContactManifold::maxPoints);
+		for (size_t i = 0; i < manifolds.size(); i++) {
+			const ContactManifold& m = manifolds[i];
+			const float invMassA = bodies.invMass[m.A];
+			const float invMassB = bodies.invMass[m.B];
+			const glm::mat3& invInertiaA = invInertiaWorld[m.A];
+			const glm::mat3& invInertiaB = invInertiaWorld[m.B];
+			const glm::vec3 centerA = bodies.position(m.A);
+			const glm::vec3 centerB = bodies.position(m.B);
+			const glm::vec3 velocityA = bodies.velocity(m.A);
+			const glm::vec3 velocityB = bodies.velocity(m.B);
+			const glm::vec3 angularA = bodies.angularVelocity(m.A);
+			const glm::vec3 angularB = bodies.angularVelocity(m.B);
+
+			for (uint32_t p = 0; p < m.pointCount; p++) {
+				SolverPoint& sp = solverPoints[i * ContactManifold::maxPoints + p];
+				sp.rA = m.points[p].point - centerA;
+				sp.rB = m.points[p].point - centerB;
+				sp.normalMass = effectiveMass(invMassA, invMassB, invInertiaA, invInertiaB, sp.rA, sp.rB, m.normal);
+				sp.tangentMass[0] = effectiveMass(invMassA, invMassB, invInertiaA, invInertiaB, sp.rA, sp.rB, m.tangent[0]);
+				sp.tangentMass[1] = effectiveMass(invMassA, invMassB, invInertiaA, invInertiaB, sp.rA, sp.rB, m.tangent[1]);
+
+				glm::vec3 relative = (velocityB + glm::cross(angularB, sp.rB)) - (velocityA + glm::cross(angularA, sp.rA));
+				float velAlongNormal = glm::dot(relative, m.normal);
+				if (m.points[p].penetration < -speculativeSlop) {
+					//speculative point: the bodies may still close the gap this step but not more, so the impulse only kicks in when they
+					//would end up overlapping. any bounce happens on the next step once they touch
+					sp.bias = m.points[p].penetration / stepDt;
+				}
+				else {
+					sp.bias = (-velAlongNormal > restitutionThreshold) ? -restitution * velAlongNormal : 0.f;
+				}
+			}
+		}
+	}
+
+	void PhysicsClass::warmStart(uint32_t manifold) {
+		//last step's impulses are a good guess for this step's, apply them before iterating
+		const ContactManifold& m = manifolds[manifold];
+		float invMassA = bodies.invMass[m.A];
+		float invMassB = bodies.invMass[m.B];
+		const glm::mat3& invInertiaA = invInertiaWorld[m.A];
+		const glm::mat3& invInertiaB = invInertiaWorld[m.B];
+		glm::vec3 velocityA = bodies.velocity(m.A);
+		glm::vec3 velocityB = bodies.velocity(m.B);
+		glm::vec3 angularA = bodies.angularVelocity(m.A);
+		glm::vec3 angularB = bodies.angularVelocity(m.B);
+
+		for (uint32_t p = 0; p < m.pointCount; p++) {
+			const Contact& c = m.points[p];
+			const SolverPoint& sp = solverPoints[manifold * ContactManifold::maxPoints + p];
+			glm::vec3 impulse = c.normalImpulse * m.normal + c.tangentImpulse[0] * m.tangent[0] + c.tangentImpulse[1] * m.tangent[1];
+			velocityA -= impulse * invMassA;
+			velocityB += impulse * invMassB;
+			angularA -= invInertiaA * glm::cross(sp.rA, impulse);
+			angularB += invInertiaB * glm::cross(sp.rB, impulse);
+		}
+		//static bodies are never written, the colored solver lets several threads share one
+		if (invMassA > 0.f) {
+			bodies.setVelocity(m.A, velocityA);
+			bodies.setAngularVelocity(m.A, angularA);
+		}
+		if (invMassB > 0.f) {
+			bodies.setVelocity(m.B, velocityB);
+			bodies.setAngularVelocity(m.B, angularB);
+		}
+	}
+
+	void PhysicsClass::solveManifold(uint32_t manifold) {
+		const float mu = 0.5f; //coefficient of friction
+
+		ContactManifold& m = manifolds[manifold];
+		float invMassA = bodies.invMass[m.A];
+		float invMassB = bodies.invMass[m.B];
+		if (invMassA + invMassB == 0.f) return; //both objects are static
+		const glm::mat3& invInertiaA = invInertiaWorld[m.A];
+		const glm::mat3& invInertiaB = invInertiaWorld[m.B];
+
+		glm::vec3 velocityA = bodies.velocity(m.A);
+		glm::vec3 velocityB = bodies.velocity(m.B);
+		glm::vec3 angularA = bodies.angularVelocity(m.A);
+		glm::vec3 angularB = bodies.angularVelocity(m.B);
+
+		//the impulse acts at the contact point, so it changes the spin of both bodies as well as their velocity
+		auto applyImpulse = [&](const SolverPoint& sp, const glm::vec3& impulse) {
+			velocityA -= impulse * invMassA;
+			velocityB += impulse * invMassB;
+			angularA -= invInertiaA * glm::cross(sp.rA, impulse);
+			angularB += invInertiaB * glm::cross(sp.rB, impulse);
+		};
+
+		for (uint32_t p = 0; p < m.pointCount; p++) {
+			Contact& c = m.points[p];
+			const SolverPoint& sp = solverPoints[manifold * ContactManifold::maxPoints + p];
+
+			//this is FRICTION calculation
+			//Coulomb's law of friction : frictional force between two surfaces is directly proportional to the normal force pressing them together Ff = mu * Fn
+			//the accumulated friction impulse is clamped to the accumulated normal impulse of the point
+			float maxFriction = mu * c.normalImpulse;
+			for (int t = 0; t < 2; t++) {
+				//velocity of the contact point on each body, not just of its center
+				glm::vec3 relative = (velocityB + glm::cross(angularB, sp.rB)) - (velocityA + glm::cross(angularA, sp.rA));
+				float velAlongTangent = glm::dot(relative, m.tangent[t]);
+				float lambda = -velAlongTangent * sp.tangentMass[t];
+				float newImpulse = glm::clamp(c.tangentImpulse[t] + lambda, -maxFriction, maxFriction);
+				lambda = newImpulse - c.tangentImpulse[t];
+				c.tangentImpulse[t] = newImpulse;
+
+				applyImpulse(sp, lambda * m.tangent[t]);
+			}
+		}
+
+		//normals go after all of the friction so non penetration, the constraint that matters most, gets the last word
+		for (uint32_t p = 0; p < m.pointCount; p++) {
+			Contact& c = m.points[p];
+			const SolverPoint& sp = solverPoints[manifold * ContactManifold::maxPoints + p];
+
+			//IMPULSE application
+			//Impulse is the change in momentum, and momentum is mass times velocity (p = m * v)
+			//the accumulated normal impulse can only push, so a single iteration may pull back what earlier ones overshot
+			glm::vec3 relative = (velocityB + glm::cross(angularB, sp.rB)) - (velocityA + glm::cross(angularA, sp.rA));
+			float velAlongNormal = glm::dot(relative, m.normal);
+			float lambda = (sp.bias - velAlongNormal) * sp.normalMass;
+			float newImpulse = std::max(c.normalImpulse + lambda, 0.f);
+			lambda = newImpulse - c.normalImpulse;
+			c.normalImpulse = newImpulse;
+
+			applyImpulse(sp, lambda * m.normal);
+		}
+
+		if (invMassA > 0.f) {
+			bodies.setVelocity(m.A, velocityA);
+			bodies.setAngularVelocity(m.A, angularA);
+		}
+		if (invMassB > 0.f) {
+			bodies.setVelocity(m.B, velocityB);
+			bodies.setAngularVelocity(m.B, angularB);
+		}
+	}
+
+	void PhysicsClass::positionalCorrection(uint32_t manifold) {
+		const float percent = 0.8f; //usually 20% to 80%
+		const float slop = 0.01f; //usually 0.01 to 0.1
+
+		const ContactManifold& m = manifolds[manifold];
+		float invMassA = bodies.invMass[m.A];
+		float invMassB = bodies.invMass[m.B];
+		if (invMassA + invMassB == 0.f) return; //both objects are static
+		const glm::mat3& invInertiaA = invInertiaWorld[m.A];
+		const glm::mat3& invInertiaB = invInertiaWorld[m.B];
+
+		//static bodies have no correction slot and never move
+		const glm::vec3 zero{ 0.f };
+		glm::vec3 linearA = invMassA > 0.f ? correctionLinear[m.A] : zero;
+		glm::vec3 angularA = invMassA > 0.f ? correctionAngular[m.A] : zero;
+		glm::vec3 linearB = invMassB > 0.f ? correctionLinear[m.B] : zero;
+		glm::vec3 angularB = invMassB > 0.f ? correctionAngular[m.B] : zero;
+
+		//every point is measured against the same starting state and the pushes are averaged. going point by point lets the
+		//first point turn the body before the others are looked at, which leaves a flat box resting a little tilted
+		glm::vec3 deltaLinearA{ 0.f }, deltaAngularA{ 0.f }, deltaLinearB{ 0.f }, deltaAngularB{ 0.f };
+		for (uint32_t p = 0; p < m.pointCount; p++) {
+			const SolverPoint& sp = solverPoints[manifold * ContactManifold::maxPoints + p];
+			//penetration left after the corrections so far, earlier manifolds may already have pushed this one apart
+			glm::vec3 moved = (linearB + glm::cross(angularB, sp.rB)) - (linearA + glm::cross(angularA, sp.rA));
+			float penetration = m.points[p].penetration - glm::dot(moved, m.normal);
+
+			float correctionMagnitude = percent * std::max(penetration - slop, 0.0f);
+			if (correctionMagnitude == 0.f) continue;
+			glm::vec3 correction = correctionMagnitude * sp.normalMass * m.normal;
+
+			deltaLinearA -= correction * invMassA;
+			deltaAngularA -= invInertiaA * glm::cross(sp.rA, correction);
+			deltaLinearB += correction * invMassB;
+			deltaAngularB += invInertiaB * glm::cross(sp.rB, correction);
+		}
+		const float share = 1.f / static_cast<float>(m.pointCount);
+		linearA += deltaLinearA * share;
+		angularA += deltaAngularA * share;
+		linearB += deltaLinearB * share;
+		angularB += deltaAngularB * share;
+
+		if (invMassA > 0.f) {
+			correctionLinear[m.A] = linearA;
+			correctionAngular[m.A] = angularA;
+		}
+		if (invMassB > 0.f) {
+			correctionLinear[m.B] = linearB;
+			correctionAngular[m.B] = angularB;
+		}
+	}
+
+	void PhysicsClass::applyCorrections() {
+		for (uint32_t i = 0; i < bodies.awakeCount; i++) {
+			bodies.setPosition(i, bodies.position(i) + correctionLinear[i]);
+			const glm::vec3& turn = correctionAngular[i];
+			if (turn == glm::vec3{ 0.f }) continue;
+			//same first order step as integrateRotation with w * dt = turn
+			glm::quat q = bodies.rotation(i);
+			bodies.setRotation(i, glm::normalize(q + glm::quat{ 0.f, turn.x, turn.y, turn.z } * q * 0.5f));
+		}
+	}
+
+	//spreads the low 21 bits of v so there are two zero bits between each one
+	static uint64_t spreadBits21(uint64_t v) {
+		v &= 0x1FFFFF;
+		v = (v | (v << 32)) & 0x1F00000000FFFFull;
+		v = (v | (v << 16)) & 0x1F0000FF0000FFull;
+		v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+		v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+		v = (v | (v << 2)) & 0x1249249249249249ull;
+		return v;
+	}
+
+	uint64_t PhysicsClass::cellKey(const Cell& c) {
+		//cells are biased into [0, 2^21) so negative coordinates work. anything beyond about a million cells from the origin is clamped to the edge cell
+		const int bias = 1 << 20;
+		const int maxCoord = (1 << 21) - 1;
+		uint64_t x = static_cast<uint64_t>(std::clamp(c.x + bias, 0, maxCoord));
+		uint64_t y = static_cast<uint64_t>(std::clamp(c.y + bias, 0, maxCoord));
+		uint64_t z = static_cast<uint64_t>(std::clamp(c.z + bias, 0, maxCoord));
+		return spreadBits21(x) | (spreadBits21(y) << 1) | (spreadBits21(z) << 2);
+	}
+
+	//Integration (semi-implicit Euler): https://math.libretexts.org/Bookshelves/Differential_Equations/Numerically_Solving_Ordinary_Differential_Equations_(Brorson)/01%3A_Chapters/1.07%3A_Symplectic_integrators
+	//both integration passes only walk the awake partition [0, awakeCount) so there is no mass == 0 or sleep branch.
+	//the AVX/SSE loops do 8/4 bodies per iteration and the scalar loop finishes the tail,
+	//every path does the same mul then add so results don't depend on which path ran
+	void PhysicsClass::integrateForces(float dt) {
+		const uint32_t count = bodies.awakeCount;
+		float* vx = bodies.velX.data();
+		float* vy = bodies.velY.data();
+		float* vz = bodies.velZ.data();
+		float* fx = bodies.forceX.data();
+		float* fy = bodies.forceY.data();
+		float* fz = bodies.forceZ.data();
+		const float* invMass = bodies.invMass.data();
+		//gravity is an acceleration so it skips the mass scale. applying it here instead of through applyForce lets bodies sleep
+		const glm::vec3 gravityStep = settings.gravity * dt;
+
+		uint32_t i = 0;
+#if defined(MVE_PHYSICS_AVX)
+		const __m256 dt8 = _mm256_set1_ps(dt);
+		const __m256 zero8 = _mm256_setzero_ps();
+		const __m256 gx8 = _mm256_set1_ps(gravityStep.x);
+		const __m256 gy8 = _mm256_set1_ps(gravityStep.y);
+		const __m256 gz8 = _mm256_set1_ps(gravityStep.z);
+		for (; i + 8 <= count; i += 8) {
+			//acceleration = force / mass, so scale = invMass * dt
+			__m256 scale = _mm256_mul_ps(_mm256_loadu_ps(invMass + i), dt8);
+			_mm256_storeu_ps(vx + i, _mm256_add_ps(_mm256_loadu_ps(vx + i), _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(fx + i), scale), gx8)));
+			_mm256_storeu_ps(vy + i, _mm256_add_ps(_mm256_loadu_ps(vy + i), _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(fy + i), scale), gy8)));
+			_mm256_storeu_ps(vz + i, _mm256_add_ps(_mm256_loadu_ps(vz + i), _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(fz + i), scale), gz8)));
+			_mm256_storeu_ps(fx + i, zero8);
+			_mm256_storeu_ps(fy + i, zero8);
+			_mm256_storeu_ps(fz + i, zero8);
+		}
+#endif
+#if defined(MVE_PHYSICS_SSE)
+		const __m128 dt4 = _mm_set1_ps(dt);
+		const __m128 zero4 = _mm_setzero_ps();
+		const __m128 gx4 = _mm_set1_ps(gravityStep.x);
+		const __m128 gy4 = _mm_set1_ps(gravityStep.y);
+		const __m128 gz4 = _mm_set1_ps(gravityStep.z);
+		for (; i + 4 <= count; i += 4) {
+			__m128 scale = _mm_mul_ps(_mm_loadu_ps(invMass + i), dt4);
+			_mm_storeu_ps(vx + i, _mm_add_ps(_mm_loadu_ps(vx + i), _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(fx + i), scale), gx4)));
+			_mm_storeu_ps(vy + i, _mm_add_ps(_mm_loadu_ps(vy + i), _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(fy + i), scale), gy4)));
+			_mm_storeu_ps(vz + i, _mm_add_ps(_mm_loadu_ps(vz + i), _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(fz + i), scale), gz4)));
+			_mm_storeu_ps(fx + i, zero4);
+			_mm_storeu_ps(fy + i, zero4);
+			_mm_storeu_ps(fz + i, zero4);
+		}
+#endif
+		for (; i < count; i++) {
+			float scale = invMass[i] * dt;
+			vx[i] = vx[i] + (fx[i] * scale + gravityStep.x);
+			vy[i] = vy[i] + (fy[i] * scale + gravityStep.y);
+			vz[i] = vz[i] + (fz[i] * scale + gravityStep.z);
+			fx[i] = 0.f;
+			fy[i] = 0.f;
+			fz[i] = 0.f;
+		}
+
+		//angular acceleration = I^-1 * torque with the world inertia cached by updateBodyAxes.
+		//the gyroscopic term w x (I * w) is left out, integrated explicitly it adds energy to spinning bodies
+		for (i = 0; i < count; i++) {
+			glm::vec3 torque = bodies.torque(i);
+			if (torque == glm::vec3{ 0.f }) continue;
+			bodies.setAngularVelocity(i, bodies.angularVelocity(i) + invInertiaWorld[i] * torque * dt);
+			bodies.setTorque(i, glm::vec3{ 0.f });
+		}
+	}
+
+	void PhysicsClass::integrateVelocity(float dt) {
+		const float sleepThresholdSq = settings.sleepVelocity * settings.sleepVelocity;
+
+		const uint32_t count = bodies.awakeCount;
+		float* px = bodies.posX.data();
+		float* py = bodies.posY.data();
+		float* pz = bodies.posZ.data();
+		const float* vx = bodies.velX.data();
+		const float* vy = bodies.velY.data();
+		const float* vz = bodies.velZ.data();
+		float* timer = bodies.sleepTimer.data();
+
+		//sleep logic, I decided to implement it here for efficiency. 
+		//a body is slow when |v| < sleepVelocity, slow bodies accumulate sleepTimer. updateIslands decides who falls asleep
+		uint32_t i = 0;
+#if defined(MVE_PHYSICS_AVX)
+		const __m256 dt8 = _mm256_set1_ps(dt);
+		const __m256 threshold8 = _mm256_set1_ps(sleepThresholdSq);
+		for (; i + 8 <= count; i += 8) {
+			__m256 x = _mm256_loadu_ps(vx + i);
+			__m256 y = _mm256_loadu_ps(vy + i);
+			__m256 z = _mm256_loadu_ps(vz + i);
+			_mm256_storeu_ps(px + i, _mm256_add_ps(_mm256_loadu_ps(px + i), _mm256_mul_ps(x, dt8)));
+			_mm256_storeu_ps(py + i, _mm256_add_ps(_mm256_loadu_ps(py + i), _mm256_mul_ps(y, dt8)));
+			_mm256_storeu_ps(pz + i, _mm256_add_ps(_mm256_loadu_ps(pz + i), _mm256_mul_ps(z, dt8)));
+
+			__m256 speedSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+			__m256 slow = _mm256_cmp_ps(speedSq, threshold8, _CMP_LT_OQ);
+			//fast bodies reset their timer to 0
+			__m256 t = _mm256_and_ps(_mm256_add_ps(_mm256_loadu_ps(timer + i), dt8), slow);
+			_mm256_storeu_ps(timer + i, t);
+		}
+#endif
+#if defined(MVE_PHYSICS_SSE)
+		const __m128 dt4 = _mm_set1_ps(dt);
+		const __m128 threshold4 = _mm_set1_ps(sleepThresholdSq);
+		for (; i + 4 <= count; i += 4) {
+			__m128 x = _mm_loadu_ps(vx + i);
+			__m128 y = _mm_loadu_ps(vy + i);
+			__m128 z = _mm_loadu_ps(vz + i);
+			_mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(x, dt4)));
+			_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(y, dt4)));
+			_mm_storeu_ps(pz + i, _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(z, dt4)));
+
+			__m128 speedSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+			__m128 slow = _mm_cmplt_ps(speedSq, threshold4);
+			__m128 t = _mm_and_ps(_mm_add_ps(_mm_loadu_ps(timer + i), dt4), slow);
+			_mm_storeu_ps(timer + i, t);
+		}
+#endif
+		for (; i < count; i++) {
+			px[i] = px[i] + vx[i] * dt;
+			py[i] = py[i] + vy[i] * dt;
+			pz[i] = pz[i] + vz[i] * dt;
+
+			float speedSq = (vx[i] * vx[i] + vy[i] * vy[i]) + vz[i] * vz[i];
+			timer[i] = (speedSq < sleepThresholdSq) ? timer[i] + dt : 0.f;
+		}
+	}
+
+	//q += dt / 2 * (0, w) * q then renormalize, V::width bodies at a time. every lane does the same operations
+	//in the same order as the 1 lane tail, so results don't depend on which path a body took
+	template<typename V>
+	static void rotationKernel(uint32_t i, float dt, float sleepThresholdSq, BodyStore& b) {
+		V wx = V::load(b.angVelX.data() + i), wy = V::load(b.angVelY.data() + i), wz = V::load(b.angVelZ.data() + i);
+		V qw = V::load(b.rotW.data() + i), qx = V::load(b.rotX.data() + i), qy = V::load(b.rotY.data() + i), qz = V::load(b.rotZ.data() + i);
+		V h = V::set1(0.5f * dt);
+
+		V dw = V::set1(0.f) - ((wx * qx + wy * qy) + wz * qz);
+		V dx = wx * qw + (wy * qz - wz * qy);
+		V dy = wy * qw + (wz * qx - wx * qz);
+		V dz = wz * qw + (wx * qy - wy * qx);
+		qw = qw + dw * h;
+		qx = qx + dx * h;
+		qy = qy + dy * h;
+		qz = qz + dz * h;
+
+		V invLength = V::set1(1.f) / sqrt((qw * qw + qx * qx) + (qy * qy + qz * qz));
+		(qw * invLength).store(b.rotW.data() + i);
+		(qx * invLength).store(b.rotX.data() + i);
+		(qy * invLength).store(b.rotY.data() + i);
+		(qz * invLength).store(b.rotZ.data() + i);
+
+		//spinning bodies aren't resting even when their center stands still, integrateVelocity already counted the linear speed
+		V spinSq = (wx * wx + wy * wy) + wz * wz;
+		V timer = V::load(b.sleepTimer.data() + i);
+		(timer & cmplt(spinSq, V::set1(sleepThresholdSq))).store(b.sleepTimer.data() + i);
+	}
+
+	void PhysicsClass::integrateRotation(float dt) {
+		const float sleepThresholdSq = settings.sleepAngularVelocity * settings.sleepAngularVelocity;
+		const uint32_t count = bodies.awakeCount;
+		constexpr uint32_t W = simd::FloatN::width;
+
+		uint32_t i = 0;
+		for (; i + W <= count; i += W) rotationKernel<simd::FloatN>(i, dt, sleepThresholdSq, bodies);
+		for (; i < count; i++) rotationKernel<simd::Float1>(i, dt, sleepThresholdSq, bodies);
+	}
+
+
+	//scene queries
+
+	BodyHandle PhysicsClass::handleOf(uint32_t body) const {
+		uint32_t slot = bodies.slot[body];
+		return { slot, slotGeneration[slot] };
+	}
+
+	OBB PhysicsClass::currentOBB(uint32_t collider) const {
+		const Collider& box = colliders[collider];
+		glm::mat3 rot = glm::mat3_cast(bodies.rotation(box.bodyIndex));
+		return { bodies.position(box.bodyIndex), { rot[0], rot[1], rot[2] }, box.halfSize };
+	}
+
+	bool PhysicsClass::queryIndexValid() const {
+		return !queryIndexStale && colliderAABBs.size() == colliders.size();
+	}
+
+	float PhysicsClass::queryMargin() const {
+		if (!queryMarginDirty) return cachedQueryMargin;
+		//every collider, a body made static since the broadphase may still have moved during the step. static ones add nothing
+		float margin = 0.f;
+		for (uint32_t i = 0; i < colliders.size(); i++) {
+			const Collider& c = colliders[i];
+			glm::vec3 center, extent;
+			colliderBounds(c, glm::mat3_cast(bodies.rotation(c.bodyIndex)), center, extent);
+			const AABB& stored = colliderAABBs[i];
+			glm::vec3 out = glm::max(stored.min - (center - extent), (center + extent) - stored.max);
+			margin = std::max(margin, std::max(out.x, std::max(out.y, out.z)));
+		}
+		cachedQueryMargin = margin;
+		queryMarginDirty = false;
+		return margin;
+	}
+
+	//1 / direction with zero components replaced by a tiny value of the same sign, so the slab tests never see 0 * inf
+	static glm::vec3 safeInverse(const glm::vec3& d) {
+		glm::vec3 r;
+		for (int k = 0; k < 3; k++) r[k] = 1.f / (std::abs(d[k]) > 1e-12f ? d[k] : std::copysign(1e-12f, d[k]));
+		return r;
+	}
+
+	static AABB growAABB(const AABB& box, float amount) {
+		return { box.min - amount, box.max + amount };
+	}
+
+	//does the segment [0, maxT] enter box
+	static bool slabTest(const AABB& box, const glm::vec3& origin, const glm::vec3& invDir, float maxT) {
+		glm::vec3 t1 = (box.min - origin) * invDir;
+		glm::vec3 t2 = (box.max - origin) * invDir;
+		glm::vec3 tMin = glm::min(t1, t2), tMax = glm::max(t1, t2);
+		float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+		float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxT));
+		return enter <= exit;
+	}
+
+	//V::width rays in SoA form, one per lane
+	template<typename V>
+	struct RayPacket {
+		V ox, oy, oz;
+		V ix, iy, iz; //safeInverse of the direction
+	};
+
+	//slab test of one box against every ray of the packet, bit l set if ray l enters the box before its maxT
+	template<typename V>
+	static int packetSlab(const RayPacket<V>& r, const AABB& box, V maxT) {
+		V t1 = (V::set1(box.min.x) - r.ox) * r.ix, t2 = (V::set1(box.max.x) - r.ox) * r.ix;
+		V enter = min(t1, t2), exit = max(t1, t2);
+		t1 = (V::set1(box.min.y) - r.oy) * r.iy; t2 = (V::set1(box.max.y) - r.oy) * r.iy;
+		enter = max(enter, min(t1, t2)); exit = min(exit, max(t1, t2));
+		t1 = (V::set1(box.min.z) - r.oz) * r.iz; t2 = (V::set1(box.max.z) - r.oz) * r.iz;
+		enter = max(enter, min(t1, t2)); exit = min(exit, max(t1, t2));
+		enter = max(enter, V::set1(0.f));
+		exit = min(exit, maxT);
+		return movemask(cmple(enter, exit));
+	}
+
+	//slab test in the box's frame. t is the entry distance and normal the entry face, 0 and -direction when the ray starts inside
+	static bool rayOBB(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const OBB& box, float& t, glm::vec3& normal) {
+		glm::vec3 d = origin - box.center;
+		float enter = 0.f, exit = maxDistance;
+		int enterAxis = -1;
+		float enterSign = 0.f;
+		for (int k = 0; k < 3; k++) {
+			float o = glm::dot(d, box.axis[k]);
+			float dir = glm::dot(direction, box.axis[k]);
+			if (std::abs(dir) < 1e-12f) {
+				if (std::abs(o) > box.halfSize[k]) return false; //parallel to this slab and outside it
+				continue;
+			}
+			float t1 = (-box.halfSize[k] - o) / dir;
+			float t2 = (box.halfSize[k] - o) / dir;
+			float sign = -1.f; //enters through the -axis face
+			if (t1 > t2) {
+				std::swap(t1, t2);
+				sign = 1.f;
+			}
+			if (t1 > enter) {
+				enter = t1;
+				enterAxis = k;
+				enterSign = sign;
+			}
+			exit = std::min(exit, t2);
+			if (enter > exit) return false;
+		}
+		t = enter;
+		normal = enterAxis < 0 ? -direction : box.axis[enterAxis] * enterSign;
+		return true;
+	}
+
+	static bool raySphere(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const glm::vec3& center, float radius, float& t, glm::vec3& normal) {
+		glm::vec3 m = origin - center;
+		float b = glm::dot(m, direction);
+		float c = glm::dot(m, m) - radius * radius;
+		if (c <= 0.f) { //starts inside
+			t = 0.f;
+			normal = -direction;
+			return true;
+		}
+		if (b > 0.f) return false; //outside and pointing away
+		float disc = b * b - c;
+		if (disc < 0.f) return false;
+		t = -b - std::sqrt(disc);
+		if (t > maxDistance) return false;
+		normal = (m + direction * t) / radius;
+		return true;
+	}
+
+	bool PhysicsClass::raycastCollider(uint32_t collider, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+		const Collider& c = colliders[collider];
+		float t;
+		glm::vec3 normal;
+		bool found;
+		switch (c.shape) {
+		case ColliderShape::Sphere:
+			found = raySphere(origin, direction, maxDistance, bodies.position(c.bodyIndex), c.radius, t, normal);
+			break;
+		case ColliderShape::Convex:
+			found = rayConvex(ConvexShape::hull(convexHulls[c.hull], glm::mat3_cast(bodies.rotation(c.bodyIndex)), bodies.position(c.bodyIndex)), origin, direction, maxDistance, t, normal);
+			break;
+		case ColliderShape::Mesh:
+		case ColliderShape::HeightField: {
+			//the ray into body space, rotations keep distances so t carries over
+			const glm::mat3 rot = glm::mat3_cast(bodies.rotation(c.bodyIndex));
+			const glm::mat3 toBody = glm::transpose(rot);
+			const glm::vec3 localOrigin = toBody * (origin - bodies.position(c.bodyIndex));
+			found = c.shape == ColliderShape::Mesh ?
+				triangleMeshes[c.mesh].raycast(localOrigin, toBody * direction, maxDistance, t, normal) :
+				heightFields[c.heightField].raycast(localOrigin, toBody * direction, maxDistance, t, normal);
+			normal = rot * normal;
+			if (glm::dot(normal, direction) > 0.f) normal = -normal; //hit from behind
+			break;
+		}
+		default:
+			found = rayOBB(origin, direction, maxDistance, currentOBB(collider), t, normal);
+			break;
+		}
+		if (!found || t > maxDistance) return false;
+		hit = { true, handleOf(c.bodyIndex), bodies.objId[c.bodyIndex], t, origin + direction * t, normal };
+		return true;
+	}
+
+	bool PhysicsClass::sphereCastCollider(uint32_t collider, const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+		const Collider& c = colliders[collider];
+		float t;
+		glm::vec3 normal, point;
+		if (c.shape == ColliderShape::Sphere) {
+			glm::vec3 center = bodies.position(c.bodyIndex);
+			if (!raySphere(origin, direction, maxDistance, center, c.radius + radius, t, normal)) return false;
+			point = center + normal * c.radius;
+		}
+		else if (c.shape == ColliderShape::Mesh || c.shape == ColliderShape::HeightField) {
+			//conservative advancement against each triangle near the sweep, like the hull below with the closest point on the triangle
+			const glm::vec3 end = origin + direction * maxDistance;
+			const AABB sweep{ glm::min(origin, end) - radius, glm::max(origin, end) + radius };
+			t = FLT_MAX;
+			meshTriangles(collider, glm::mat3_cast(bodies.rotation(c.bodyIndex)), sweep, [&](uint32_t, const glm::vec3* v) {
+				float s = 0.f;
+				for (int iteration = 0; iteration <= 64; iteration++) {
+					glm::vec3 p = origin + direction * s;
+					glm::vec3 closest = closestPointOnTriangle(p, v[0], v[1], v[2]);
+					glm::vec3 gap = p - closest;
+					float distance = glm::length(gap);
+					if (distance <= radius + 1e-4f) {
+						if (s < t) {
+							t = s;
+							point = closest;
+							normal = distance > 1e-6f ? gap / distance : -direction;
+						}
+						return;
+					}
+					if (glm::dot(-gap, direction) <= 0.f) return;
+					s += distance - radius;
+					if (s > std::min(t, maxDistance)) return;
+				}
+			});
+			if (t == FLT_MAX) return false;
+		}
+		else if (c.shape == ColliderShape::Convex) {
+			//conservative advancement from the start: the gap GJK finds between the center and the hull can be travelled without touching
+			const ConvexShape hull = ConvexShape::hull(convexHulls[c.hull], glm::mat3_cast(bodies.rotation(c.bodyIndex)), bodies.position(c.bodyIndex));
+			GjkCache cache; //each step starts from the last one's simplex
+			t = 0.f;
+			for (int iteration = 0; ; iteration++) {
+				glm::vec3 p = origin + direction * t;
+				GjkResult gap = gjk(hull, ConvexShape::sphere(p, 0.f), cache);
+				if (gap.overlap) {
+					point = p;
+					normal = -direction;
+					break;
+				}
+				if (gap.distance <= radius + 1e-4f) {
+					point = gap.pointA;
+					normal = (p - gap.pointA) / gap.distance;
+					break;
+				}
+				//the gap only shrinks while the closest point is still ahead
+				if (glm::dot(gap.pointA - p, direction) <= 0.f) return false;
+				t += gap.distance - radius;
+				if (t > maxDistance || iteration == 64) return false;
+			}
+		}
+		else {
+			//the ray against the box grown by radius is where the swept sphere could first touch. near edges and corners the grown box
+			//sticks out past the rounded shape, so from there step forward by the gap to the box until it closes (conservative advancement)
+			OBB box = currentOBB(collider);
+			OBB grown = box;
+			grown.halfSize += radius;
+			if (!rayOBB(origin, direction, maxDistance, grown, t, normal)) return false;
+			for (int iteration = 0; ; iteration++) {
+				glm::vec3 p = origin + direction * t;
+				glm::vec3 d = p - box.center;
+				glm::vec3 local{ glm::dot(d, box.axis[0]), glm::dot(d, box.axis[1]), glm::dot(d, box.axis[2]) };
+				glm::vec3 outside = glm::abs(local) - grown.halfSize;
+				if (std::max(outside.x, std::max(outside.y, outside.z)) > 1e-4f) return false; //went past a corner without touching
+				glm::vec3 clamped = glm::clamp(local, -box.halfSize, box.halfSize);
+				point = box.center + box.axis[0] * clamped.x + box.axis[1] * clamped.y + box.axis[2] * clamped.z;
+				glm::vec3 gap = p - point;
+				float distance = glm::length(gap);
+				if (distance <= radius + 1e-4f) {
+					normal = distance > 1e-6f ? gap / distance : -direction;
+					break;
+				}
+				t += distance - radius;
+				if (t > maxDistance || iteration == 32) return false; //a ray grazing the corner converges slowly, call it a miss
+			}
+		}
+		if (t > maxDistance) return false;
+		hit = { true, handleOf(c.bodyIndex), bodies.objId[c.bodyIndex], t, point, normal };
+		return true;
+	}
+
+	template<typename Fn>
+	void PhysicsClass::queryRegion(const AABB& region, Fn&& fn) const {
+		const AABB grown = growAABB(region, queryMargin());
+		if (settings.broadphase == BroadphaseType::AABBTree) {
+			//leaves are fat AABBs around the stored ones, the static tree never moves
+			staticTree.query(region, [&](uint32_t collider) { fn(collider); return true; });
+			dynamicTree.query(grown, [&](uint32_t collider) { fn(collider); return true; });
+			return;
+		}
+
+		const Cell min = getCell(grown.min, gridCellSize);
+		const Cell max = getCell(grown.max, gridCellSize);
+		const int64_t cellCount = int64_t(max.x - min.x + 1) * (max.y - min.y + 1) * (max.z - min.z + 1);
+		if (cellCount > static_cast<int64_t>(colliders.size())) {
+			//more cells than colliders, cheaper to look at every stored AABB
+			for (uint32_t i = 0; i < colliders.size(); i++) {
+				if (grown.overlaps(colliderAABBs[i])) fn(i);
+			}
+			return;
+		}
+		for (uint32_t big : oversizedColliders) fn(big);
+		for (uint32_t big : restingOversized) fn(big);
+		for (int x = min.x; x <= max.x; x++) {
+			for (int y = min.y; y <= max.y; y++) {
+				for (int z = min.z; z <= max.z; z++) {
+					const uint64_t key = cellKey({ x, y, z });
+					for (const std::vector<CellEntry>* cells : { &grid, &restingGrid }) {
+						auto it = std::lower_bound(cells->begin(), cells->end(), key, [](const CellEntry& e, uint64_t k) { return e.key < k; });
+						for (; it != cells->end() && it->key == key; ++it) fn(it->collider);
+					}
+				}
+			}
+		}
+	}
+
+	template<typename Fn>
+	void PhysicsClass::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float radius, Fn&& fn) const {
+		const float margin = queryMargin() + radius;
+		const glm::vec3 invDir = safeInverse(direction);
+		if (settings.broadphase == BroadphaseType::AABBTree) {
+			staticTree.traverse(
+				[&](const AABB& box) { return slabTest(growAABB(box, radius), origin, invDir, maxDistance); },
+				[&](uint32_t collider, const AABB&) { maxDistance = fn(collider); return true; });
+			dynamicTree.traverse(
+				[&](const AABB& box) { return slabTest(growAABB(box, margin), origin, invDir, maxDistance); },
+				[&](uint32_t collider, const AABB&) { maxDistance = fn(collider); return true; });
+			return;
+		}
+
+		for (uint32_t big : oversizedColliders) maxDistance = fn(big);
+		for (uint32_t big : restingOversized) maxDistance = fn(big);
+
+		//3D DDA through the grid (Amanatides and Woo). the piece of the segment inside each cell, grown by the margin, is looked up
+		//in every cell it touches, so a collider hit inside this cell was seen no matter which cells it was stored in
+		const float cellSize = gridCellSize;
+		const Cell start = getCell(origin, cellSize);
+		int cell[3] = { start.x, start.y, start.z };
+		int step[3];
+		float tNext[3], tDelta[3];
+		for (int k = 0; k < 3; k++) {
+			if (direction[k] > 0.f) {
+				step[k] = 1;
+				tNext[k] = ((cell[k] + 1) * cellSize - origin[k]) / direction[k];
+				tDelta[k] = cellSize / direction[k];
+			}
+			else if (direction[k] < 0.f) {
+				step[k] = -1;
+				tNext[k] = (cell[k] * cellSize - origin[k]) / direction[k];
+				tDelta[k] = -cellSize / direction[k];
+			}
+			else {
+				step[k] = 0;
+				tNext[k] = FLT_MAX;
+				tDelta[k] = FLT_MAX;
+			}
+		}
+
+		float t = 0.f;
+		Cell seenMin{ 1, 1, 1 }, seenMax{ 0, 0, 0 }; //cells of the previous piece, already looked up
+		for (uint32_t visited = 0; t <= maxDistance; visited++) {
+			if (visited == 1u << 16) {
+				//a very long ray through small cells, finish it off with every stored AABB
+				for (uint32_t i = 0; i < colliders.size(); i++) {
+					if (slabTest(growAABB(colliderAABBs[i], margin), origin, invDir, maxDistance)) maxDistance = fn(i);
+				}
+				return;
+			}
+			const int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+			const float tExit = tNext[axis];
+			const glm::vec3 a = origin + direction * t;
+			const glm::vec3 b = origin + direction * std::min(tExit, maxDistance);
+			const Cell min = getCell(glm::min(a, b) - margin, cellSize);
+			const Cell max = getCell(glm::max(a, b) + margin, cellSize);
+			for (int x = min.x; x <= max.x; x++) {
+				for (int y = min.y; y <= max.y; y++) {
+					for (int z = min.z; z <= max.z; z++) {
+						if (x >= seenMin.x && x <= seenMax.x && y >= seenMin.y && y <= seenMax.y && z >= seenMin.z && z <= seenMax.z) continue;
+						const uint64_t key = cellKey({ x, y, z });
+						for (const std::vector<CellEntry>* cells : { &grid, &restingGrid }) {
+							auto it = std::lower_bound(cells->begin(), cells->end(), key, [](const CellEntry& e, uint64_t k) { return e.key < k; });
+							for (; it != cells->end() && it->key == key; ++it) {
+								//a collider in several cells comes up more than once, the cheap test keeps repeats from costing an exact test
+								if (slabTest(growAABB(colliderAABBs[it->collider], margin), origin, invDir, maxDistance)) maxDistance = fn(it->collider);
+							}
+						}
+					}
+				}
+			}
+			if (maxDistance <= tExit) return; //anything in later cells is further away
+			seenMin = min;
+			seenMax = max;
+			t = tExit;
+			cell[axis] += step[axis];
+			tNext[axis] += tDelta[axis];
+		}
+	}
+
+	bool PhysicsClass::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit, uint32_t layerMask) const {
+		hit = RaycastHit{};
+		const float length = glm::length(direction);
+		if (length < 1e-12f || maxDistance < 0.f) return false;
+		const glm::vec3 dir = direction / length;
+
+		auto test = [&](uint32_t collider) {
+			if (bodies.queryLayers[colliders[collider].bodyIndex] & layerMask) {
+				if (raycastCollider(collider, origin, dir, maxDistance, hit)) maxDistance = hit.distance;
+			}
+			return maxDistance;
+		};
+		if (queryIndexValid()) queryRay(origin, dir, maxDistance, 0.f, test);
+		else for (uint32_t i = 0; i < colliders.size(); i++) test(i);
+		return hit.hit;
+	}
+
+	bool PhysicsClass::sphereCast(const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, RaycastHit& hit, uint32_t layerMask) const {
+		hit = RaycastHit{};
+		const float length = glm::length(direction);
+		if (length < 1e-12f || maxDistance < 0.f) return false;
+		const glm::vec3 dir = direction / length;
+
+		auto test = [&](uint32_t collider) {
+			if (bodies.queryLayers[colliders[collider].bodyIndex] & layerMask) {
+				if (sphereCastCollider(collider, origin, radius, dir, maxDistance, hit)) maxDistance = hit.distance;
+			}
+			return maxDistance;
+		};
+		if (queryIndexValid()) queryRay(origin, dir, maxDistance, radius, test);
+		else for (uint32_t i = 0; i < colliders.size(); i++) test(i);
+		return hit.hit;
+	}
+
+	template<typename Test>
+	uint32_t PhysicsClass::overlapQuery(const AABB& bounds, uint32_t layerMask, std::vector<BodyHandle>& out, Test&& test) const {
+		queryCandidates.clear();
+		if (queryIndexValid()) {
+			queryRegion(bounds, [&](uint32_t collider) { queryCandidates.push_back(collider); });
+			std::sort(queryCandidates.begin(), queryCandidates.end());
+			queryCandidates.erase(std::unique(queryCandidates.begin(), queryCandidates.end()), queryCandidates.end());
+		}
+		else {
+			for (uint32_t i = 0; i < colliders.size(); i++) queryCandidates.push_back(i);
+		}
+
+		//a body with several colliders is reported once
+		queryBodies.clear();
+		for (uint32_t collider : queryCandidates) {
+			uint32_t body = colliders[collider].bodyIndex;
+			if ((bodies.queryLayers[body] & layerMask) && test(collider)) queryBodies.push_back(body);
+		}
+		std::sort(queryBodies.begin(), queryBodies.end());
+		queryBodies.erase(std::unique(queryBodies.begin(), queryBodies.end()), queryBodies.end());
+		for (uint32_t body : queryBodies) out.push_back(handleOf(body));
+		return static_cast<uint32_t>(queryBodies.size());
+	}
+
+	uint32_t PhysicsClass::overlapBox(const glm::vec3& center, const glm::vec3& halfSize, const glm::quat& rotation, std::vector<BodyHandle>& out, uint32_t layerMask) const {
+		glm::mat3 rot = glm::mat3_cast(rotation);
+		const OBB query{ center, { rot[0], rot[1], rot[2] }, halfSize };
+		glm::vec3 extent = glm::abs(rot[0]) * halfSize.x + glm::abs(rot[1]) * halfSize.y + glm::abs(rot[2]) * halfSize.z;
+		return overlapQuery({ center - extent, center + extent }, layerMask, out, [&](uint32_t collider) {
+			const Collider& c = colliders[collider];
+			if (c.shape == ColliderShape::Sphere) {
+				Contact contact;
+				return sphereOBB(bodies.position(c.bodyIndex), c.radius, query, contact);
+			}
+			if (c.shape == ColliderShape::Convex) {
+				GjkCache cache;
+				const BoxPolytope box{ halfSize };
+				const ConvexShape hull = ConvexShape::hull(convexHulls[c.hull], glm::mat3_cast(bodies.rotation(c.bodyIndex)), bodies.position(c.bodyIndex));
+				return gjk(ConvexShape::box(box, rot, center), hull, cache).overlap;
+			}
+			if (c.shape == ColliderShape::Mesh || c.shape == ColliderShape::HeightField) {
+				bool hit = false;
+				meshTriangles(collider, glm::mat3_cast(bodies.rotation(c.bodyIndex)), { center - extent, center + extent }, [&](uint32_t, const glm::vec3* v) {
+					hit = hit || testTriangleVsOBB(v, query).hit;
+				});
+				return hit;
+			}
+			return testOBBvsOBB(query, currentOBB(collider)).hit;
+		});
+	}
+
+	uint32_t PhysicsClass::overlapSphere(const glm::vec3& center, float radius, std::vector<BodyHandle>& out, uint32_t layerMask) const {
+		return overlapQuery({ center - radius, center + radius }, layerMask, out, [&](uint32_t collider) {
+			const Collider& c = colliders[collider];
+			Contact contact;
+			if (c.shape == ColliderShape::Sphere) return sphereSphere(center, radius, bodies.position(c.bodyIndex), c.radius, contact);
+			if (c.shape == ColliderShape::Convex) {
+				GjkCache cache;
+				const ConvexShape hull = ConvexShape::hull(convexHulls[c.hull], glm::mat3_cast(bodies.rotation(c.bodyIndex)), bodies.position(c.bodyIndex));
+				GjkResult gap = gjk(hull, ConvexShape::sphere(center, 0.f), cache);
+				return gap.overlap || gap.distance <= radius;
+			}
+			if (c.shape == ColliderShape::Mesh || c.shape == ColliderShape::HeightField) {
+				bool hit = false;
+				meshTriangles(collider, glm::mat3_cast(bodies.rotation(c.bodyIndex)), { center - radius, center + radius }, [&](uint32_t, const glm::vec3* v) {
+					glm::vec3 d = center - closestPointOnTriangle(center, v[0], v[1], v[2]);
+					hit = hit || glm::dot(d, d) <= radius * radius;
+				});
+				return hit;
+			}
+			return sphereOBB(center, radius, currentOBB(collider), contact);
+		});
+	}
+
+	void PhysicsClass::raycastBatch(const Ray* rays, uint32_t count, RaycastHit* hits, uint32_t layerMask) const {
+		if (count == 0) return;
+		//worked out here once, the jobs only read it
+		if (queryIndexValid()) queryMargin();
+
+		constexpr uint32_t raysPerJob = 512;
+		const uint32_t jobCount = (count + raysPerJob - 1) / raysPerJob;
+		if (!jobPool || jobCount == 1) {
+			raycastRange(rays, 0, count, hits, layerMask, queryCandidates);
+			return;
+		}
+		if (queryChunkCandidates.size() < jobCount) queryChunkCandidates.resize(jobCount);
+		jobPool->run(jobCount, [&](uint32_t job) {
+			uint32_t begin = job * raysPerJob;
+			raycastRange(rays, begin, std::min(begin + raysPerJob, count), hits, layerMask, queryChunkCandidates[job]);
+		});
+	}
+
+	void PhysicsClass::raycastRange(const Ray* rays, uint32_t begin, uint32_t end, RaycastHit* hits, uint32_t layerMask, std::vector<uint32_t>& candidates) const {
+		using V = simd::FloatN;
+		constexpr uint32_t W = V::width;
+		if (!queryIndexValid()) {
+			for (uint32_t i = begin; i < end; i++) raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i], layerMask);
+			return;
+		}
+		const float margin = queryMargin();
+		const bool tree = settings.broadphase == BroadphaseType::AABBTree;
+
+		for (uint32_t first = begin; first < end; first += W) {
+			//the last packet is padded with its last ray, the copies are never written back
+			const uint32_t lanes = std::min(W, end - first);
+			glm::vec3 origin[W], dir[W];
+			float ox[W], oy[W], oz[W], ix[W], iy[W], iz[W], best[W];
+			AABB bounds{ glm::vec3{ FLT_MAX }, glm::vec3{ -FLT_MAX } };
+			for (uint32_t l = 0; l < W; l++) {
+				const Ray& ray = rays[first + std::min(l, lanes - 1)];
+				if (l < lanes) hits[first + l] = RaycastHit{};
+				const float length = glm::length(ray.direction);
+				origin[l] = ray.origin;
+				if (length < 1e-12f || ray.maxDistance < 0.f) {
+					//-1 keeps the lane out of every slab test
+					dir[l] = glm::vec3{ 0.f };
+					best[l] = -1.f;
+				}
+				else {
+					dir[l] = ray.direction / length;
+					best[l] = ray.maxDistance;
+					bounds.min = glm::min(bounds.min, glm::min(ray.origin, ray.origin + dir[l] * best[l]));
+					bounds.max = glm::max(bounds.max, glm::max(ray.origin, ray.origin + dir[l] * best[l]));
+				}
+				glm::vec3 inv = safeInverse(dir[l]);
+				ox[l] = origin[l].x; oy[l] = origin[l].y; oz[l] = origin[l].z;
+				ix[l] = inv.x; iy[l] = inv.y; iz[l] = inv.z;
+			}
+			if (bounds.min.x > bounds.max.x) continue; //no usable ray in the packet
+
+			const RayPacket<V> packet{ V::load(ox), V::load(oy), V::load(oz), V::load(ix), V::load(iy), V::load(iz) };
+			//slab test the packet against box, exact tests for the lanes that pass
+			auto testCandidate = [&](uint32_t collider, const AABB& box) {
+				if (!(bodies.queryLayers[colliders[collider].bodyIndex] & layerMask)) return;
+				uint32_t mask = static_cast<uint32_t>(packetSlab(packet, box, V::load(best)));
+				while (mask) {
+					uint32_t l = static_cast<uint32_t>(std::countr_zero(mask));
+					mask &= mask - 1;
+					if (l >= lanes) continue;
+					if (raycastCollider(collider, origin[l], dir[l], best[l], hits[first + l])) best[l] = hits[first + l].distance;
+				}
+			};
+
+			if (tree) {
+				staticTree.traverse(
+					[&](const AABB& box) { return packetSlab(packet, box, V::load(best)) != 0; },
+					[&](uint32_t collider, const AABB&) { testCandidate(collider, colliderAABBs[collider]); return true; });
+				dynamicTree.traverse(
+					[&](const AABB& box) { return packetSlab(packet, growAABB(box, margin), V::load(best)) != 0; },
+					[&](uint32_t collider, const AABB&) { testCandidate(collider, growAABB(colliderAABBs[collider], margin)); return true; });
+				continue;
+			}
+
+			//grid: rays that stay close together share one lookup of the cells around all of them. rays that spread out
+			//would drag in most of the world, they walk the grid one at a time instead
+			const Cell min = getCell(bounds.min - margin, gridCellSize);
+			const Cell max = getCell(bounds.max + margin, gridCellSize);
+			const int64_t cellCount = int64_t(max.x - min.x + 1) * (max.y - min.y + 1) * (max.z - min.z + 1);
+			if (cellCount > 64) {
+				for (uint32_t l = 0; l < lanes; l++) {
+					raycast(rays[first + l].origin, rays[first + l].direction, rays[first + l].maxDistance, hits[first + l], layerMask);
+				}
+				continue;
 			}
+			candidates.clear();
+			queryRegion(bounds, [&](uint32_t collider) { candidates.push_back(collider); });
+			std::sort(candidates.begin(), candidates.end());
+			candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+			for (uint32_t collider : candidates) testCandidate(collider, growAABB(colliderAABBs[collider], margin));
 		}
 	}
 
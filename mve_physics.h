@@ -3,6 +3,12 @@
 #pragma once
 
 #include "mve_game_object.h"
+#include "mve_aabb_tree.h"
+#include "mve_convex.h"
+#include "mve_mesh_collider.h"
+#include "mve_heightfield.h"
+#include "mve_job_pool.h"
+#include "mve_physics_snapshot.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -10,39 +16,188 @@
 #define GLM_ENABLE_EXPERIMENTAL //need for gtx
 #include <glm/gtx/quaternion.hpp>
 
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 namespace mve{
+	//AoS view of a single body. the simulation itself keeps bodies in BodyStore, getBody() gathers one of these for callers
 	struct RigidBody {
 		glm::vec3 position;
 		glm::vec3 velocity{ 0.f }; //
 		glm::vec3 angularVelocity{ 0.f };
-		//quat is quaternion representation for rotation
-		glm::quat rotation;
+		//quat is quaternion representation for rotation. glm leaves quats uninitialized, so start at identity (w, x, y, z)
+		glm::quat rotation{ 1.f, 0.f, 0.f, 0.f };
 		glm::vec3 force{ 0.f };
+		glm::vec3 torque{ 0.f };
 		int objId; //might not needed bc the rigid body is stored in a vector where the index is the objId
 		float mass;
 		float sleepTimer = 0.f;
 		bool sleep{ false };
 		bool collidable = false;
+		bool continuous = false; //see PhysicsClass::setContinuous
+		uint32_t queryLayers = 1; //see PhysicsClass::setQueryLayers
+
+	};
+
+	enum class ColliderShape : uint8_t {
+		Box,
+		Sphere, //cheapest shape, good for debris and projectiles
+		Convex, //hull made by PhysicsClass::createConvexHull, for models a box fits badly. pairs with a hull go through GJK and EPA
+		Mesh, //static level geometry from PhysicsClass::createTriangleMesh, tested triangle by triangle against the other shapes
+		HeightField, //static terrain from PhysicsClass::createHeightField, only the cells under the other shape become triangles
+	};
+
+	//stable reference to a body. bodies move around in the store (sleep partitioning, static partition, removal) so a handle
+	//points at a slot, and the slot table knows the body's current index. removing a body bumps its slot's generation,
+	//so old handles to it stop resolving instead of picking up whichever body reuses the slot
+	struct BodyHandle {
+		static constexpr uint32_t invalidSlot = 0xFFFFFFFFu;
+		uint32_t slot = invalidSlot;
+		uint32_t generation = 0;
 
+		bool operator==(const BodyHandle& other) const { return slot == other.slot && generation == other.generation; }
+		bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+	};
+
+	//Structure of arrays (SoA) body storage. every stream is indexed by the same body index so the integration loops 
+	//only touch the streams they need and can load 4/8 bodies at once with SSE/AVX.
+	//dynamic bodies live in [0, dynamicCount) and static (mass == 0) bodies are partitioned after them, 
+	//so integration walks the dynamic range without branching on mass.
+	//the dynamic range is split again into awake bodies [0, awakeCount) and sleeping bodies [awakeCount, dynamicCount),
+	//every phase of the step only walks the awake range
+	struct BodyStore {
+		std::vector<float> posX, posY, posZ;
+		std::vector<float> velX, velY, velZ;
+		std::vector<float> forceX, forceY, forceZ;
+		std::vector<float> invMass; //0 for static bodies
+		std::vector<float> mass;
+		std::vector<float> angVelX, angVelY, angVelZ;
+		std::vector<float> torqueX, torqueY, torqueZ;
+		std::vector<float> rotW, rotX, rotY, rotZ; //unit quaternion
+		//inverse inertia around the body's own axes. every shape is symmetric about its axes so the tensor is diagonal,
+		//0 for static bodies and bodies without a collider, those never rotate
+		std::vector<float> invInertiaX, invInertiaY, invInertiaZ;
+		std::vector<int> objId;
+		std::vector<float> sleepTimer;
+		std::vector<uint8_t> sleep;
+		std::vector<uint32_t> island; //id of the island a sleeping body fell asleep with, woken together
+		std::vector<uint8_t> collidable;
+		std::vector<uint8_t> continuous; //fast bodies, swept in the broadphase and given speculative contacts
+		std::vector<uint32_t> queryLayers; //bit mask of the query layers the body is on
+		std::vector<uint32_t> slot; //handle slot of each body, so moving a body can update the slot table
+		//the collider of each shape of each body or noCollider, so moving a body only fixes its own colliders
+		std::vector<uint32_t> boxCollider;
+		std::vector<uint32_t> sphereCollider;
+		std::vector<uint32_t> convexCollider;
+		std::vector<uint32_t> meshCollider;
+		std::vector<uint32_t> heightFieldCollider;
+		uint32_t dynamicCount = 0;
+
+		static constexpr uint32_t noCollider = 0xFFFFFFFFu;
+		uint32_t& collider(uint32_t i, ColliderShape shape) {
+			switch (shape) {
+			case ColliderShape::Sphere: return sphereCollider[i];
+			case ColliderShape::Convex: return convexCollider[i];
+			case ColliderShape::Mesh: return meshCollider[i];
+			case ColliderShape::HeightField: return heightFieldCollider[i];
+			default: return boxCollider[i];
+			}
+		}
+		uint32_t awakeCount = 0;
+
+		uint32_t size() const { return static_cast<uint32_t>(objId.size()); }
+		bool isStatic(uint32_t i) const { return i >= dynamicCount; }
+		bool isSleeping(uint32_t i) const { return i >= awakeCount && i < dynamicCount; }
+
+		glm::vec3 position(uint32_t i) const { return { posX[i], posY[i], posZ[i] }; }
+		glm::vec3 velocity(uint32_t i) const { return { velX[i], velY[i], velZ[i] }; }
+		glm::vec3 force(uint32_t i) const { return { forceX[i], forceY[i], forceZ[i] }; }
+		glm::vec3 angularVelocity(uint32_t i) const { return { angVelX[i], angVelY[i], angVelZ[i] }; }
+		glm::vec3 torque(uint32_t i) const { return { torqueX[i], torqueY[i], torqueZ[i] }; }
+		glm::quat rotation(uint32_t i) const { return { rotW[i], rotX[i], rotY[i], rotZ[i] }; }
+		glm::vec3 invInertia(uint32_t i) const { return { invInertiaX[i], invInertiaY[i], invInertiaZ[i] }; }
+		void setPosition(uint32_t i, const glm::vec3& p) { posX[i] = p.x; posY[i] = p.y; posZ[i] = p.z; }
+		void setVelocity(uint32_t i, const glm::vec3& v) { velX[i] = v.x; velY[i] = v.y; velZ[i] = v.z; }
+		void setForce(uint32_t i, const glm::vec3& f) { forceX[i] = f.x; forceY[i] = f.y; forceZ[i] = f.z; }
+		void setAngularVelocity(uint32_t i, const glm::vec3& w) { angVelX[i] = w.x; angVelY[i] = w.y; angVelZ[i] = w.z; }
+		void setTorque(uint32_t i, const glm::vec3& t) { torqueX[i] = t.x; torqueY[i] = t.y; torqueZ[i] = t.z; }
+		void setRotation(uint32_t i, const glm::quat& q) { rotW[i] = q.w; rotX[i] = q.x; rotY[i] = q.y; rotZ[i] = q.z; }
+		void setInvInertia(uint32_t i, const glm::vec3& v) { invInertiaX[i] = v.x; invInertiaY[i] = v.y; invInertiaZ[i] = v.z; }
+
+		void push(const RigidBody& body, uint32_t slot);
+		//drops the last body
+		void pop();
+		void swap(uint32_t a, uint32_t b);
+		//reorders the first order.size() bodies so body order[k] ends up at index k. visited is scratch for the caller to keep
+		void permute(const std::vector<uint32_t>& order, std::vector<uint8_t>& visited);
+		RigidBody get(uint32_t i) const;
 	};
 
 	struct Contact {
 		uint32_t a;
 		uint32_t b;
 		glm::vec3 normal;
-		float penetration; //depth of penetration
+		float penetration; //depth of penetration, negative for a speculative contact (the gap that may close this step)
+		glm::vec3 point{ 0.f }; //world position of the contact
+		uint32_t id = 0; //which feature made the point, used to find the same point again next step
+		//impulses summed over the solver iterations. they are kept for the next step and applied up front (warm starting)
+		float normalImpulse = 0.f;
+		float tangentImpulse[2] = { 0.f, 0.f };
+	};
+
+	//per contact point values the solver needs every iteration, computed once per step before warm starting
+	struct SolverPoint {
+		glm::vec3 rA, rB; //contact point relative to each body's center
+		float normalMass; //impulse for a unit change of the relative velocity along the normal, angular terms included
+		float tangentMass[2];
+		//target separating velocity from bouncing. negative for a speculative point: the fastest approach that still doesn't close the gap
+		float bias;
+	};
+
+	//what syncTransforms blends from
+	struct BodyPose {
+		glm::vec3 position;
+		glm::quat rotation;
+	};
+
+	//one dynamic body's last two poses, what PhysicsThread hands to the render thread
+	struct BodyTransform {
+		int objId;
+		BodyPose previous;
+		BodyPose current;
 	};
 
 
 	//If you only generate one contact point per collision, you might miss important details about how the objects interact, especially in complex collisions.
 	//By having multiple contact points, you can capture a more accurate representation of the collision, leading to better simulation of forces, friction, and overall behavior of the objects involved.
+	//manifolds live from step to step in a cache keyed by the collider pair (which fixes the body pair) so their impulses carry over
 	struct ContactManifold {
-		uint32_t A, B;
-		glm::vec3 normal;
-		std::vector<Contact> points;
+		static constexpr uint32_t maxPoints = 4;
+
+		//every byte is defined, manifolds go into snapshots as they are and snapshots of equal worlds have to be equal bytes
+		uint64_t key = 0; //collider A << 32 | collider B
+		//0 unless one collider is a mesh or heightfield, then the first triangle of the manifold. a mesh touching a body with faces that point
+		//different ways gives one manifold per direction, all under the same key
+		uint32_t subKey = 0;
+		uint32_t A = 0, B = 0; //body indices for this step
+		glm::vec3 normal{ 0.f }; //from A to B
+		glm::vec3 tangent[2]{ glm::vec3{ 0.f }, glm::vec3{ 0.f } }; //friction directions
+		//fixed size so building manifolds every step never allocates. the slots past pointCount are zero
+		Contact points[maxPoints]{};
+		uint32_t pointCount = 0;
+		uint32_t padding = 0; //the tail padding the uint64_t key would leave, spelled out so it is zero too
+
+		static bool before(const ContactManifold& x, const ContactManifold& y) {
+			return x.key < y.key || (x.key == y.key && x.subKey < y.subKey);
+		}
 	};
+	static_assert(sizeof(Contact) == 13 * sizeof(uint32_t), "Contact has padding, snapshots would copy undefined bytes");
+	static_assert(std::is_trivially_copyable_v<Contact>, "unused manifold slots are cleared with memset");
+	static_assert(sizeof(ContactManifold) == offsetof(ContactManifold, padding) + sizeof(uint32_t), "ContactManifold has tail padding");
 
 	struct OBB { //OBB (Oriented Bounding Box)
 		glm::vec3 center;
@@ -55,96 +210,621 @@ namespace mve{
 		bool hit;
 		float penetration;
 		glm::vec3 normal;
+		//axis the penetration was measured on: 0-2 face of A, 3-5 face of B, 6 + i * 3 + j for edge A[i] x B[j]. -1 for no hit
+		int axis = -1;
 	};
 
-	//AABB (Axis-Aligned Bounding Box) collisions
-	struct AABB {
-		glm::vec3 min;
-		glm::vec3 max;
+	//which pairs of colliders the broadphase hands to the narrowphase, see PhysicsClass::setCollisionFilter
+	struct CollisionFilter {
+		uint32_t layers = 1; //bit mask of the collision layers the collider is on
+		uint32_t mask = 0xFFFFFFFFu; //layers it collides with, both sides have to accept the other
+		//colliders sharing a nonzero group skip the masks: a positive group always collides, a negative one never does (ragdoll parts)
+		int32_t group = 0;
+
+		bool accepts(const CollisionFilter& other) const {
+			if (group != 0 && group == other.group) return group > 0;
+			return (layers & other.mask) && (other.layers & mask);
+		}
 	};
 
-	struct BoxCollider {
+	//every shape lives in the same collider list so the broadphase, the tree leaves and the manifold keys share one index space
+	struct Collider {
+		ColliderShape shape = ColliderShape::Box;
 		//half extents is half the size of the box in each dimension
-		glm::vec3 halfSize;
-		uint32_t bodyIndex;
+		glm::vec3 halfSize{ 0.f };
+		float radius = 0.f; //sphere only
+		uint32_t hull = 0; //convex only, index of the hull from PhysicsClass::createConvexHull
+		uint32_t mesh = 0; //mesh only, index of the mesh from PhysicsClass::createTriangleMesh
+		uint32_t heightField = 0; //heightfield only, index from PhysicsClass::createHeightField
+		uint32_t bodyIndex; //index of the rigid body in the physics system
+		CollisionFilter filter;
+		bool trigger = false; //see PhysicsClass::setTrigger
+	};
+
+	struct Ray {
+		glm::vec3 origin;
+		glm::vec3 direction; //doesn't need to be normalized
+		float maxDistance;
+	};
+
+	enum class ContactEventType : uint8_t {
+		Begin, //the pair started touching this step
+		Stay, //touched last step too. a pair that falls asleep stays touching without a Stay every step
+		End, //stopped touching, or one of the bodies was removed
 	};
 
-	struct SphereCollider {
-		float radius;
-		uint32_t bodyIndex; //index of the rigid body in the physics system 
+	//a pair of colliders starting, keeping or ending contact, see PhysicsClass::getContactEvents
+	struct ContactEvent {
+		ContactEventType type;
+		bool trigger; //one of the two is a trigger, they overlap but nothing pushes them apart
+		BodyHandle bodyA, bodyB; //a removed body's handle no longer resolves, its objId still tells which one it was
+		int objIdA, objIdB;
+		glm::vec3 normal; //from A to B, zero for triggers and End
+		float impulse; //normal impulse the solver applied this step over all contact points, zero for triggers and End
+	};
+
+	//closest hit of a raycast or sphere cast
+	struct RaycastHit {
+		bool hit = false;
+		BodyHandle body; //invalid when nothing was hit
+		int objId = -1;
+		float distance = 0.f; //along the normalized direction, 0 when the query started inside the shape
+		glm::vec3 point{ 0.f }; //on the surface of the shape that was hit
+		glm::vec3 normal{ 0.f }; //surface normal there, facing back along the ray
 	};
 
 	struct Cell { //for a uniform grid
 		int x, y, z;
 	};
 
-	class PhysicsClass {
-	public:
-		PhysicsClass();
-		~PhysicsClass();
+	//one (cell, collider) entry of the sorted broadphase grid
+	struct CellEntry {
+		uint64_t key; //morton code of the cell
+		uint32_t collider;
+	};
 
-		void step(float dt); //step is a single update per frame
+	enum class BroadphaseType {
+		SortedGrid, //rebuilt from scratch every step, good when most things move
+		AABBTree, //persistent static and dynamic trees, only moving bodies pay, good for mostly static levels
+	};
 
-		void addRigidBody(MveGameObject& obj, float mass = 1.f);
+	enum class SolverType {
+		Sequential, //one pass over the manifolds in key order on the calling thread
+		GraphColored, //manifolds are split into colors that share no dynamic body, each color is solved in parallel on the job pool
+	};
+
+	struct PhysicsSettings {
+		BroadphaseType broadphase = BroadphaseType::SortedGrid;
+		float treeMargin = 0.1f; //how far a collider can move before its AABBTree leaf gets reinserted
+		uint32_t workerThreads = 1; //threads used by the parallel phases including the calling thread, 1 keeps everything serial
+		uint32_t narrowPhaseChunkSize = 256; //aabbPairs handed to a worker at a time
+		float fixedTimeStep = 1.f / 60.f; //dt of every step taken by update
+		uint32_t maxSubSteps = 4; //most steps update takes per call, time past that is dropped instead of piling up
+		glm::vec3 gravity{ 0.f }; //acceleration on every awake dynamic body. +y is down
+		float sleepVelocity = 0.05f; //bodies slower than this count as resting
+		float sleepAngularVelocity = 0.1f; //radians per second, bodies spinning faster don't count as resting
+		float sleepTime = 0.5f; //an island falls asleep once every body in it has been resting this long
+		uint32_t solverIterations = 8; //sequential impulse passes over the contacts per step. stacks taller than about 8 bodies want more
+		SolverType solver = SolverType::Sequential;
+		uint32_t solverChunkSize = 64; //manifolds of one color handed to a worker at a time
+		//bodies and colliders get sorted along a morton curve so bodies close in space sit close in memory. checked every
+		//reorderInterval steps (0 turns it off), sorted once the share of contacts between bodies far apart in memory has grown
+		//by reorderThreshold since the last sort
+		uint32_t reorderInterval = 30;
+		float reorderThreshold = 0.1f;
+		bool contactEvents = true; //off skips building getContactEvents, triggers then only keep their colliders from being resolved
+	};
 
-		void addSphereCollider(int objId, float radius);
-		void addBoxCollider(int objId, const glm::vec3& halfSize);
+	//what the last step cost, overwritten by every step. only counters and a clock read per phase, so it stays on in release builds
+	struct PhysicsStats {
+		uint64_t step = 0; //steps taken by this PhysicsClass, restoring a snapshot doesn't reset it
+
+		//milliseconds per phase
+		double integrateForcesMs = 0.0; //includes updating the body axes
+		double broadPhaseMs = 0.0;
+		double detectCollisionsMs = 0.0; //includes waking touched islands
+		double resolveCollisionsMs = 0.0; //includes building the contact events
+		double integrateMs = 0.0; //velocity, rotation and islands
+		double stepMs = 0.0;
+
+		//broadphase
+		float gridCellSize = 0.f; //0 with the AABB tree
+		uint32_t gridCells = 0; //occupied cells of the awake grid
+		uint32_t restingGridCells = 0; //occupied cells of the resting grid, it is only rebuilt when something falls asleep or wakes up
+		uint32_t rawPairs = 0; //candidates whose AABBs were compared, a pair counts again for every cell it shares or tree it is found in
+		uint32_t pairs = 0; //unique broadphase pairs handed to the narrowphase
+		uint32_t filteredPairs = 0; //overlapping pairs the broadphase dropped because of their collision filters
+
+		//narrowphase
+		uint32_t satTests = 0; //box vs box pairs and mesh triangles vs boxes
+		uint32_t satHits = 0; //within the speculative margin
+		uint32_t gjkTests = 0; //pairs with a hull and mesh triangles vs hulls
+		uint32_t gjkHits = 0;
+		uint32_t manifolds = 0;
+		uint32_t contacts = 0; //points over all manifolds
+
+		//solver
+		uint32_t solverIterations = 0; //velocity passes over the manifolds, 0 when nothing touched
+		uint32_t solverColors = 0; //graph colored solver only, including the overflow color
+		uint32_t awakeBodies = 0;
+		uint32_t sleepingBodies = 0;
+
+		//comma separated column names, then one row per writeCsv call
+		static void writeCsvHeader(std::ostream& out);
+		void writeCsv(std::ostream& out) const;
+		//one object on a single line, so a log of them is JSON lines
+		void writeJson(std::ostream& out) const;
+	};
 
-		void setSpeed(int objId, const glm::vec3& speed);
-		void applyForce(int objId, const glm::vec3& force);
+	enum class StatsFormat {
+		Csv, //header before the first row
+		Json, //one object per line
+	};
 
-		Cell getCell(const glm::vec3& pos, float cellSize);
+	class PhysicsClass {
+	public:
+		PhysicsClass(const PhysicsSettings& settings = PhysicsSettings{});
+		~PhysicsClass();
 
-		std::vector<RigidBody> rBodies; //probably better to keep this as a vector for cache efficiency
+		void step(float dt); //a single simulation step of dt, use update to run at a fixed rate
+
+		//adds frameTime to the accumulator and takes as many fixed steps as fit, up to maxSubSteps.
+		//returns the number of steps taken, which can be 0 when rendering faster than the physics rate
+		uint32_t update(float frameTime);
+		//how far between the last two steps the leftover accumulator time is, 0 to 1
+		float getInterpolationAlpha() const { return interpolationAlpha; }
+		const PhysicsStats& getStats() const { return stats; }
+		//writes the stats of every following step to out until called with nullptr. out has to outlive the logging,
+		//flushing is left to the stream
+		void setStatsLog(std::ostream* out, StatsFormat format = StatsFormat::Csv);
+		const PhysicsSettings& getSettings() const { return settings; }
+
+		//everything the next steps depend on: bodies, colliders, handles, sleep state and the contact cache (warm starting impulses).
+		//restoring and stepping again gives exactly the steps taken after the save. settings and the job pool are not part of it,
+		//restore into a PhysicsClass made with the same settings. out is overwritten and keeps its capacity
+		void saveSnapshot(PhysicsSnapshot& out) const;
+		//false, leaving the state alone, if the snapshot is damaged or from an incompatible build
+		bool restoreSnapshot(const PhysicsSnapshot& snapshot);
+		//writes positions and rotations blended between the last two steps by the interpolation alpha into each body's game object transform.
+		//the rotation is written as the YXZ euler angles TransformComponent uses. bodies that fell asleep or became static since
+		//the last call get their final pose once, after that only awake bodies are written
+		void syncTransforms(MveGameObject::Map& objects);
+		//the previous and current pose of every dynamic body, for blending on another thread. static bodies never move and are left out.
+		//out is overwritten and keeps its capacity
+		void writeTransforms(std::vector<BodyTransform>& out) const;
+		//previous and current blended by alpha into transform's translation and YXZ euler rotation
+		static void blendPose(const BodyPose& previous, const BodyPose& current, float alpha, TransformComponent& transform);
+
+		//the handle stays valid until the body is removed. the objId overloads below look the handle up in a hash map,
+		//code touching many bodies per frame should keep the handles
+		//the body starts with the game object's translation and rotation
+		BodyHandle addRigidBody(MveGameObject& obj, float mass = 1.f);
+		//same without a game object, for headless code like the benchmarks. objId is what the other calls and syncTransforms use
+		BodyHandle addRigidBody(int objId, const glm::vec3& position, float mass = 1.f);
+		//swap-and-pop of the body and its colliders, wakes whatever was resting on it. other handles stay valid
+		void removeBody(BodyHandle handle);
+		void removeBody(int objId);
+
+		//invalid handle if objId has no body
+		BodyHandle getHandle(int objId) const;
+		bool isValid(BodyHandle handle) const { return resolve(handle) >= 0; }
+
+		//mass 0 makes the body immovable and moves it into the static partition of the body store
+		void setMass(BodyHandle handle, float mass);
+		void setMass(int objId, float mass) { setMass(getHandle(objId), mass); }
+
+		//one collider of each shape per body, adding another one replaces its size.
+		//the inertia comes from the colliders and the mass, a body with several shapes takes the larger value per axis
+		void addSphereCollider(BodyHandle handle, float radius);
+		void addSphereCollider(int objId, float radius) { addSphereCollider(getHandle(objId), radius); }
+		void addBoxCollider(BodyHandle handle, const glm::vec3& halfSize);
+		void addBoxCollider(int objId, const glm::vec3& halfSize) { addBoxCollider(getHandle(objId), halfSize); }
+
+		//convex hull of the points in body space, cut down to at most maxVertices corners. hulls are shared by any number of
+		//bodies and live as long as the PhysicsClass. returns invalidHull if the points are flat or fewer than 4
+		static constexpr uint32_t invalidHull = 0xFFFFFFFFu;
+		uint32_t createConvexHull(const std::vector<glm::vec3>& points, uint32_t maxVertices = 32);
+		//hull of a model's vertices scaled the way its game object is, a vase costs one collider instead of a box per part
+		uint32_t createConvexHull(const MveModel::Builder& model, const glm::vec3& scale = glm::vec3{ 1.f }, uint32_t maxVertices = 32);
+		const ConvexHull& getConvexHull(uint32_t hull) const { return convexHulls[hull]; }
+		//the inertia treats the hull as its bounding box
+		void addConvexCollider(BodyHandle handle, uint32_t hull);
+		void addConvexCollider(int objId, uint32_t hull) { addConvexCollider(getHandle(objId), hull); }
+
+		//triangle mesh with its BVH in body space, built once when the level loads. meshes are shared and live as long as the
+		//PhysicsClass like hulls. returns invalidMesh if no triangle is left after dropping degenerate ones
+		static constexpr uint32_t invalidMesh = 0xFFFFFFFFu;
+		uint32_t createTriangleMesh(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices);
+		uint32_t createTriangleMesh(const MveModel::Builder& model, const glm::vec3& scale = glm::vec3{ 1.f });
+		//takes a mesh that was built or loaded elsewhere, e.g. TriangleMesh::loadFromFile of one saved at export time
+		uint32_t addTriangleMesh(TriangleMesh&& mesh);
+		const TriangleMesh& getTriangleMesh(uint32_t mesh) const { return triangleMeshes[mesh]; }
+		//meant for static bodies: the mesh adds no inertia, triangles only collide from their front side and pairs of meshes are skipped
+		void addMeshCollider(BodyHandle handle, uint32_t mesh);
+		void addMeshCollider(int objId, uint32_t mesh) { addMeshCollider(getHandle(objId), mesh); }
+
+		//terrain from a grid of heights, heights[z * columns + x] cellSize apart and centered on the body's origin, see HeightField.
+		//shared and kept like meshes, invalidHeightField if the sizes don't fit. static bodies only, like meshes
+		static constexpr uint32_t invalidHeightField = 0xFFFFFFFFu;
+		uint32_t createHeightField(const std::vector<float>& heights, uint32_t columns, uint32_t rows, float cellSize);
+		const HeightField& getHeightField(uint32_t heightField) const { return heightFields[heightField]; }
+		void addHeightFieldCollider(BodyHandle handle, uint32_t heightField);
+		void addHeightFieldCollider(int objId, uint32_t heightField) { addHeightFieldCollider(getHandle(objId), heightField); }
+
+		//both wake the body's island if it is asleep
+		void setSpeed(BodyHandle handle, const glm::vec3& speed);
+		void setSpeed(int objId, const glm::vec3& speed) { setSpeed(getHandle(objId), speed); }
+		void applyForce(BodyHandle handle, const glm::vec3& force);
+		void applyForce(int objId, const glm::vec3& force) { applyForce(getHandle(objId), force); }
+		void setAngularVelocity(BodyHandle handle, const glm::vec3& angularVelocity);
+		void setAngularVelocity(int objId, const glm::vec3& angularVelocity) { setAngularVelocity(getHandle(objId), angularVelocity); }
+		//torque is summed until the next step, which applies it and clears it
+		void applyTorque(BodyHandle handle, const glm::vec3& torque);
+		void applyTorque(int objId, const glm::vec3& torque) { applyTorque(getHandle(objId), torque); }
+		//adds the force and the torque it makes around the center. unlike applyForce, which replaces the force, both are summed until the next step
+		void applyForceAtPoint(BodyHandle handle, const glm::vec3& force, const glm::vec3& point);
+		void applyForceAtPoint(int objId, const glm::vec3& force, const glm::vec3& point) { applyForceAtPoint(getHandle(objId), force, point); }
+
+		//continuous collision for fast bodies like projectiles. the broadphase sweeps the body's AABB over the step and the narrowphase
+		//makes contacts up to the distance the pair can close this step (speculative contacts), so the solver stops the body at a thin
+		//wall instead of it tunnelling through between two steps. it costs extra pairs and contacts, so only flag bodies that need it
+		void setContinuous(BodyHandle handle, bool continuous);
+		void setContinuous(int objId, bool continuous) { setContinuous(getHandle(objId), continuous); }
+
+		//bit mask of the query layers a body is on, layer 0 (bit 1) by default. raycasts, sweeps and overlaps only see bodies on a
+		//layer in their layerMask. collisions don't look at these, they go by the CollisionFilter below
+		static constexpr uint32_t allLayers = 0xFFFFFFFFu;
+		void setQueryLayers(BodyHandle handle, uint32_t layers);
+		void setQueryLayers(int objId, uint32_t layers) { setQueryLayers(getHandle(objId), layers); }
+
+		//collision layers, masks and groups of the body's colliders, or only the one of the given shape. pairs rejected by the filters
+		//are dropped in the broadphase before the narrowphase ever sees them. these are separate from the query layers above.
+		//adding a collider of a shape the body already has keeps that collider's filter, a new one starts with the default
+		void setCollisionFilter(BodyHandle handle, const CollisionFilter& filter);
+		void setCollisionFilter(int objId, const CollisionFilter& filter) { setCollisionFilter(getHandle(objId), filter); }
+		void setCollisionFilter(BodyHandle handle, ColliderShape shape, const CollisionFilter& filter);
+
+		//trigger colliders are found by the broadphase and narrowphase like any other, but the pair is reported through the contact
+		//events and never resolved or used to wake and link islands. applies to all colliders of the body
+		void setTrigger(BodyHandle handle, bool trigger);
+		void setTrigger(int objId, bool trigger) { setTrigger(getHandle(objId), trigger); }
+
+		//contact events of the last step, every touching collider pair once as Begin or Stay and every pair that stopped touching
+		//as End, sorted by body pair. found by diffing this step's pairs against the last step's, no callbacks.
+		//the events of bodies removed since then come first in the next step's list
+		const std::vector<ContactEvent>& getContactEvents() const { return contactEvents; }
+
+		//scene queries. candidates come from the broadphase structure of the last step (the grid or the trees) and are tested against
+		//the shapes where the bodies are now. colliders added or removed since the last step are found by testing every collider.
+		//they share scratch memory, so don't run queries from several threads at once. raycastBatch spreads its rays over the job pool itself
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit, uint32_t layerMask = allLayers) const;
+		//closest hit of every ray, hits[i] for rays[i]. rays go through the broadphase in packets of 8 (AVX) or 4 (SSE) with SIMD slab tests.
+		//rays that start close together and point the same way (line of sight from one agent) share the most work
+		void raycastBatch(const Ray* rays, uint32_t count, RaycastHit* hits, uint32_t layerMask = allLayers) const;
+		//a sphere of radius moved along the ray. hit.point is where it first touches the shape
+		bool sphereCast(const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, RaycastHit& hit, uint32_t layerMask = allLayers) const;
+		//append each body with a collider overlapping the shape once, return how many were appended
+		uint32_t overlapBox(const glm::vec3& center, const glm::vec3& halfSize, const glm::quat& rotation, std::vector<BodyHandle>& out, uint32_t layerMask = allLayers) const;
+		uint32_t overlapSphere(const glm::vec3& center, float radius, std::vector<BodyHandle>& out, uint32_t layerMask = allLayers) const;
+
+		static Cell getCell(const glm::vec3& pos, float cellSize);
+
+		//scalar SAT, one pair at a time with normalized axes. with a margin, boxes up to margin apart still hit and the result
+		//has a negative penetration along the axis with the largest gap
+		static SATResult testOBBvsOBB(const OBB& a, const OBB& b, float margin = 0.f);
+		//SAT of a triangle against a box over the triangle normal, the box axes and the 9 edge crosses. the normal points from
+		//the triangle to the box and prefers the triangle normal when it is about as shallow as the best axis
+		static SATResult testTriangleVsOBB(const glm::vec3* triangle, const OBB& box, float margin = 0.f);
+		//SAT for count pairs a[i] vs b[i], 8 (AVX) or 4 (SSE) pairs per kernel call and a 1 lane kernel for the rest.
+		//projections come from the rotation between the boxes so cross axes never get normalized, lanes stop as soon as all are separated
+		static void testOBBvsOBBBatch(const OBB* a, const OBB* b, uint32_t count, SATResult* out);
+
+		//compatibility accessors for code that used to read rBodies[i] directly
+		uint32_t bodyCount() const { return bodies.size(); }
+		RigidBody getBody(uint32_t index) const { return bodies.get(index); }
+		//the handle must be valid
+		RigidBody getBody(BodyHandle handle) const { return bodies.get(static_cast<uint32_t>(resolve(handle))); }
 
 
 	private:
-		void buildGrid(float cellSize);
-
-		
-		bool sphereSphere(const RigidBody& a, const RigidBody& b, float rA, float rB, Contact& out);
+		//returns the body index of the handle or -1 if it was removed
+		int resolve(BodyHandle handle) const;
+		//swaps two bodies in the store and fixes their slots and colliders so handles and colliders keep pointing at the same body
+		void swapBodies(uint32_t a, uint32_t b);
+		//adds the collider or replaces the body's collider of the same shape
+		void addCollider(BodyHandle handle, const Collider& collider);
+		//swap-and-pop of one collider, the last collider takes its index in the trees and the manifold cache
+		void removeCollider(uint32_t collider);
+		//copies the current positions and rotations into previousPose before a fixed step
+		void savePreviousState();
+		//local inverse inertia from the body's colliders and mass
+		void updateInertia(uint32_t body);
+
+		//islands: bodies connected by contacts (not counting static bodies) sleep and wake as one
+		//union-find over this step's contacts, islands where every body has been resting for sleepTime fall asleep
+		void updateIslands();
+		//wakes every island in pendingWake
+		void wakeIslands();
+		//contacts against a sleeping body wake its island before the solver runs
+		void wakeTouchedIslands();
+		//wakes the island of body i if it sleeps, returns the body's new index
+		uint32_t wakeBody(uint32_t i);
+		//stable partition of the dynamic range into awake then sleeping bodies, fills bodyRemap with old -> new index
+		void partitionSleeping();
+		//share of the contacts between two dynamic bodies more than reorderGap apart in the store
+		float contactScatter() const;
+		//sorts each partition of the body store by morton code, then the colliders by body, and renames everything that holds an index
+		void reorderBodies();
+		//splits colliders into awake and resting (sleeping or static) after bodies fell asleep, woke up or were added
+		void updateRestingColliders();
+
+		//sphere narrowphase, normal from A to B. one contact point halfway between the surfaces.
+		//both also report shapes up to margin apart, with a negative penetration
+		static bool sphereSphere(const glm::vec3& centerA, float rA, const glm::vec3& centerB, float rB, Contact& out, float margin = 0.f);
+		//sphere against the closest point of the box, a center inside the box is pushed out through the nearest face
+		static bool sphereOBB(const glm::vec3& center, float radius, const OBB& box, Contact& out, float margin = 0.f);
+		//how far two colliders can close in on each other this step, 0 unless one of the bodies is continuous
+		float speculativeMargin(const Collider& a, const Collider& b) const;
+		//the simplex GJK ended with for a pair with a hull, keyed like the manifolds
+		struct ConvexCacheEntry {
+			uint64_t key;
+			GjkCache cache;
+		};
+		//narrowphase of a pair with a hull, normal from A to B. GJK starts from last step's simplex of the pair and gives the gap,
+		//EPA the depth once the cores overlap. two polytopes clip faces for up to 4 points, a sphere gets one point halfway
+		//between the surfaces. the simplex GJK ended with goes into cacheOut
+		bool convexManifold(uint32_t colliderA, uint32_t colliderB, float margin, ContactManifold& m, std::vector<ConvexCacheEntry>& cacheOut) const;
+		//narrowphase of a mesh or heightfield against another collider. the other collider's AABB picks the triangles from the mesh
+		//BVH or the heightfield cells, each is tested one sided and the contacts are grouped by normal into up to maxMeshManifolds
+		//manifolds appended to out
+		static constexpr uint32_t maxMeshManifolds = 8;
+		//narrowphase tests of a range of pairs, kept per chunk and summed into PhysicsStats
+		struct NarrowPhaseCounts {
+			uint32_t satTests = 0, satHits = 0;
+			uint32_t gjkTests = 0, gjkHits = 0;
+		};
+		void meshManifolds(uint32_t meshCollider, uint32_t otherCollider, float margin, std::vector<ContactManifold>& out, NarrowPhaseCounts& counts) const;
+		//the collider placed at its body's position with rotation, a box collider's corners and faces come from box
+		ConvexShape convexShape(uint32_t collider, const glm::mat3& rotation, const BoxPolytope& box) const;
+		//center and half extents of the collider's world AABB for a body rotated by rot
+		void colliderBounds(const Collider& collider, const glm::mat3& rot, glm::vec3& center, glm::vec3& extent) const;
 
 
 		// broad phase collision detection using uniform grid
 		void detectCollisions();
-
-		//collision response: Impulse solver
+		//runs the narrowphase over aabbPairs[begin, end) and appends hits to out and the GJK simplices of pairs with a hull to convexOut.
+		//reads shared state only, so chunks can run on any thread
+		void detectCollisionsRange(size_t begin, size_t end, std::vector<ContactManifold>& out, std::vector<ConvexCacheEntry>& convexOut, NarrowPhaseCounts& counts);
+		//fills m.points for a box pair from its SAT result without testing the axes again.
+		//face axes clip the incident face of one box against the side planes of the reference face of the other, up to 4 points.
+		//edge axes give the single closest point between the two edges. incident points up to margin above the reference face are kept as speculative points
+		static void boxContactPoints(const OBB& a, const OBB& b, const SATResult& sat, ContactManifold& m, float margin = 0.f);
+		//sorts this step's manifolds by key and copies the impulses of points that existed last step
+		void matchManifolds();
+		//moves the manifolds with a trigger collider out of manifolds into triggerManifolds
+		void splitTriggers();
+		void updateContactEvents();
+
+		//collision response: sequential impulse solver. https://box2d.org/files/ErinCatto_SequentialImpulses_GDC2006.pdf
+		//every iteration applies an impulse per contact point, clamped on the accumulated total, so contacts sharing a body converge together
 		void resolveCollisions();
-
-		//Penetration correction. To prevent sinking due to numerical errors
-		void positionalCorrection(RigidBody& a, RigidBody& b, const Contact& c);
+		//lever arms, effective masses and restitution targets from the velocities before any impulse this step
+		void prepareContacts();
+		//splits manifolds into colors whose manifolds share no dynamic body, fills colorOrder and colorOffsets
+		void colorContacts();
+		//calls fn(manifold) for every manifold, in key order or color by color on the job pool
+		template<typename Fn>
+		void solverPass(Fn&& fn);
+		//applies last step's impulses of one manifold
+		void warmStart(uint32_t manifold);
+		//one sequential impulse pass over the points of one manifold
+		void solveManifold(uint32_t manifold);
+
+		//Penetration correction. To prevent sinking due to numerical errors.
+		//pushes every point of the manifold apart along the normal with the same effective mass as the velocity solve, so a tilted
+		//resting box is turned flat again instead of only lifted. the corrections collect in correctionLinear/correctionAngular
+		void positionalCorrection(uint32_t manifold);
+		//moves and turns the awake bodies by the collected corrections
+		void applyCorrections();
 
 		// https://research.ncl.ac.uk/game/mastersdegree/gametechnologies/physicstutorials/6accelerationstructures/Physics%20-%20Spatial%20Acceleration%20Structures.pdf
 		// broad phase: determine which objects can possibly collide against each other, and then store the potential object collision in a list called collision pair
 		// Narrow phase collision detection: iterates over the list of potential collision pairs, and determines whether they really are colliding, 
 		// and if so, resolves the collision
 		void broadPhase();
-
-		void insertCollider(uint32_t colliderIndex, const AABB& aabb, float cellSize);
-		AABB computeAABB(const RigidBody& body, const BoxCollider& box);
+		void gridBroadPhase();
+		void treeBroadPhase();
+		//gives new colliders a tree proxy and moves proxies whose body switched between static and dynamic
+		void syncTreeProxies();
+
+		//picks the grid cell size from the median collider extent, colliders much bigger than a cell go in oversizedColliders
+		float chooseCellSize();
+		void insertCollider(uint32_t colliderIndex, const AABB& aabb, float cellSize, std::vector<CellEntry>& cells, std::vector<uint32_t>& oversized);
+		//pairs every oversized collider against all other colliders with a plain AABB test. resting oversized colliders only check awake ones
+		void oversizedPairs();
+		//world AABB of the rotated box, swept over the step for continuous bodies
+		AABB computeAABB(uint32_t bodyIndex, const Collider& collider);
 		//AABB vs AABB collision and outputs contact info
 		bool AABBAABB(const AABB& a, const AABB& b, Contact& out);
 		bool aabbIntersect(const AABB& a, const AABB& b);
 
-		OBB buildOBB(uint32_t colliderIndex);
-		SATResult testOBBvsOBB(const OBB& a, const OBB& b);
+		//queries
+		BodyHandle handleOf(uint32_t body) const;
+		//box of a collider from the body's current rotation, bodyAxes is from before the last step's integration
+		OBB currentOBB(uint32_t collider) const;
+		//how far any collider's current AABB sticks out of the AABB the broadphase stored for it. queries grow the stored AABBs by this,
+		//worked out on the first query after a step
+		float queryMargin() const;
+		//the grid or trees hold every collider at its stored AABB. false after colliders were added or removed until the next broadphase
+		bool queryIndexValid() const;
+		//calls fn(collider) for each collider whose stored AABB grown by the query margin overlaps region. the grid can report a collider more than once
+		template<typename Fn>
+		void queryRegion(const AABB& region, Fn&& fn) const;
+		//calls fn(collider) for the colliders whose stored AABB a sphere of radius moved along the segment may touch (radius 0 for rays).
+		//fn returns the new maxDistance so a hit prunes everything behind it, the grid walks its cells nearest first. direction is unit length
+		template<typename Fn>
+		void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float radius, Fn&& fn) const;
+		//shared by overlapBox and overlapSphere, test(collider) is the exact shape test
+		template<typename Test>
+		uint32_t overlapQuery(const AABB& bounds, uint32_t layerMask, std::vector<BodyHandle>& out, Test&& test) const;
+		//exact tests against one collider, direction is unit length. hit is only written when the collider is closer than maxDistance
+		bool raycastCollider(uint32_t collider, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+		bool sphereCastCollider(uint32_t collider, const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+		//calls fn(triangle, corners) with the corners in world space of the triangles of a mesh or heightfield collider that may
+		//overlap region, with the body turned by rotation
+		template<typename Fn>
+		void meshTriangles(uint32_t collider, const glm::mat3& rotation, const AABB& region, Fn&& fn) const;
+		//raycastBatch for rays [begin, end), candidates is scratch for the grid
+		void raycastRange(const Ray* rays, uint32_t begin, uint32_t end, RaycastHit* hits, uint32_t layerMask, std::vector<uint32_t>& candidates) const;
+
+		//mat3_cast for every awake body once per step (every body after the layout changed), buildOBB and computeAABB read the axes from here.
+		//the world inverse inertia R * I^-1 * R^T is cached next to it for the torque integration and the solver
+		void updateBodyAxes();
+		OBB buildOBB(uint32_t colliderIndex) const;
 
 		void project(const std::vector<glm::vec3>& vertices, const glm::vec3& axis, float& min, float& max);
 
-		uint64_t hashCell(const Cell& c);
+		//exact cell key: 21 bits per axis interleaved (morton order) so unrelated cells never share a key
+		static uint64_t cellKey(const Cell& c);
 
 		//Integration (semi-implicit Euler): https://math.libretexts.org/Bookshelves/Differential_Equations/Numerically_Solving_Ordinary_Differential_Equations_(Brorson)/01%3A_Chapters/1.07%3A_Symplectic_integrators
 		void integrateForces(float dt);
 		void integrateVelocity(float dt);
-		void applySleep(float dt);
-
-		std::vector<SphereCollider> sphereColliders;
-		std::vector<BoxCollider> boxColliders;
-		std::vector<Contact> contacts;
+		//quaternion integration of the awake bodies, flat arrays so it runs a register of bodies at a time
+		void integrateRotation(float dt);
+
+		PhysicsSettings settings;
+		float stepDt = 1.f / 60.f; //dt of the step being taken, for the sweeps and speculative contacts
+		//changes whenever a body or collider is added or removed and never repeats, a snapshot with the same version has the
+		//same bodies and colliders so restoring it can keep the handle map and the tree proxies
+		uint64_t structureVersion = 0;
+		uint64_t lastStructureVersion = 0;
+		void structureChanged() { structureVersion = ++lastStructureVersion; }
+		bool treeRefitAll = false; //after a restore every dynamic tree leaf is refit, sleeping bodies may have moved
+		//calls fn on every field that goes into a snapshot in snapshot order, self is a PhysicsClass or a const PhysicsClass
+		template<typename Self, typename Fn>
+		static void snapshotFields(Self& self, Fn&& fn);
+		PhysicsStats stats;
+		std::ostream* statsLog = nullptr;
+		StatsFormat statsLogFormat = StatsFormat::Csv;
+		bool statsLogHeader = false; //the csv header still has to be written
+		//counted by the broadphase, see PhysicsStats
+		uint32_t filteredPairs = 0;
+		uint32_t rawPairs = 0;
+		uint32_t gridCells = 0;
+		uint32_t restingGridCells = 0;
+
+		//fixed step driver
+		float accumulator = 0.f;
+		float interpolationAlpha = 0.f;
+		std::vector<BodyPose> previousPose; //position and rotation of each body before the last fixed step
+		//slots of bodies that left the awake range since the last syncTransforms, each slot at most once
+		std::vector<uint32_t> settledSlots;
+		std::vector<uint8_t> slotSettled; //per slot, 1 while it is in settledSlots
+		void markSettled(uint32_t body);
+
+		//islands and sleeping
+		std::vector<uint32_t> islandParent; //union-find forest over the awake bodies
+		std::vector<float> islandTimer; //per root, smallest sleep timer in the island
+		std::vector<uint32_t> islandSleepId; //per root, id handed to the island if it falls asleep
+		uint32_t nextIslandId = 0;
+		std::vector<uint32_t> pendingWake; //island ids to wake
+		std::vector<uint32_t> bodyOrder; //partitionSleeping scratch, new -> old
+		std::vector<uint32_t> bodyRemap; //old -> new index from the last partitionSleeping
+		std::vector<BodyPose> previousScratch;
+		std::vector<uint8_t> permuteVisited; //permuteStream scratch
+		//spatial reordering
+		static constexpr uint32_t reorderGap = 32; //two cache lines of a float stream
+		uint32_t stepsSinceReorderCheck = 0;
+		float scatterAfterReorder = 0.f; //-1 right after a sort, the next check measures what the sort left
+		std::vector<std::pair<uint64_t, uint32_t>> mortonKeys; //(morton code, body) per body
+		std::vector<uint32_t> colliderOrder; //new -> old
+		std::vector<uint32_t> colliderRemap; //old -> new
+		bool restingDirty = true; //awakeColliders/restingColliders and the resting grid need rebuilding
+		std::vector<uint32_t> awakeColliders; //colliders of awake bodies, ascending
+		std::vector<uint32_t> restingColliders; //colliders of sleeping and static bodies, ascending
+		BodyStore bodies; //probably better to keep this as flat arrays for cache efficiency
+		//handle slots: body index and generation of each slot, freed slots are reused
+		std::vector<uint32_t> slotIndex;
+		std::vector<uint32_t> slotGeneration;
+		std::vector<uint32_t> freeSlots;
+		std::unordered_map<int, BodyHandle> objIdHandles; //for the objId overloads
+
+		std::vector<Collider> colliders;
+		std::vector<ConvexHull> convexHulls; //append only, colliders refer to them by index
+		std::vector<TriangleMesh> triangleMeshes; //append only like the hulls
+		std::vector<HeightField> heightFields; //append only like the hulls
+		//GJK warm start: this step's simplices sorted by key and last step's, looked up by the narrowphase. they are only a
+		//starting point, dropping them (removed colliders, reordering) costs a few iterations and nothing else
+		std::vector<ConvexCacheEntry> convexCache;
+		std::vector<ConvexCacheEntry> previousConvexCache;
+		std::vector<ContactManifold> manifolds; //this step's contacts sorted by key, the cache for the next step
+		std::vector<ContactManifold> previousManifolds;
+		std::vector<ContactManifold> triggerManifolds; //this step's overlaps with a trigger, never solved
+
+		//contact events. a collider is named by its body's slot and its shape (slot << 3 | shape) so pairs survive bodies and
+		//colliders moving around the stores, a pair key is the lower name << 32 | the higher one
+		struct TouchingPair {
+			uint64_t key;
+			uint32_t manifold; //index into manifolds or triggerManifolds, noManifold for a pair carried over while asleep
+			uint16_t trigger;
+			uint16_t flipped; //the manifold's A is the pair's B, its normal points the other way
+		};
+		static constexpr uint32_t noManifold = 0xFFFFFFFFu;
+		struct RemovedBody {
+			uint32_t slot;
+			BodyHandle handle;
+			int objId;
+		};
+		std::vector<TouchingPair> touching; //pairs touching at the end of the last step sorted by key
+		std::vector<TouchingPair> touchingScratch;
+		std::vector<TouchingPair> carriedPairs;
+		std::vector<ContactEvent> contactEvents;
+		std::vector<RemovedBody> removedBodies; //since the last step, their pairs end at the start of the next events
+		uint32_t awakeAtBroadphase = 0; //bodies woken by contacts this step sit in [awakeAtBroadphase, awakeCount)
+		uint32_t colliderName(uint32_t collider) const { return bodies.slot[colliders[collider].bodyIndex] << 3 | static_cast<uint32_t>(colliders[collider].shape); }
+		std::vector<glm::vec3> correctionLinear; //per body, position change from positionalCorrection this step
+		std::vector<glm::vec3> correctionAngular; //per body, small rotation (axis * angle) from positionalCorrection this step
+		std::vector<SolverPoint> solverPoints; //per manifold point, manifold i owns [i * maxPoints, i * maxPoints + pointCount)
+		//graph colored solver. a body's used colors are a bit mask, manifolds past the last color go into one extra color solved serially
+		static constexpr uint32_t maxSolverColors = 64;
+		std::vector<uint64_t> bodyColors;
+		std::vector<uint8_t> manifoldColors;
+		std::vector<uint32_t> colorOrder; //manifold indices grouped by color
+		std::vector<uint32_t> colorOffsets; //color c is colorOrder[colorOffsets[c], colorOffsets[c + 1])
+		std::vector<glm::mat3> bodyAxes; //rotation matrix of each body, columns are the local x, y, z axes
+		std::vector<glm::mat3> invInertiaWorld; //world space inverse inertia of each body, refreshed with bodyAxes
+		std::unique_ptr<JobPool> jobPool; //only created when settings.workerThreads > 1
+		std::vector<std::vector<ContactManifold>> chunkManifolds; //narrowphase output per chunk, merged in chunk order
+		std::vector<std::vector<ConvexCacheEntry>> chunkConvexCache;
+		std::vector<NarrowPhaseCounts> chunkCounts;
 		//std::vector<MveGameObject>* debugPoints;
-		//build grid
-		std::unordered_map<uint64_t, std::vector<uint32_t>> grid; //maps cell keys to rigid body indices
-		std::vector<std::pair<uint32_t, uint32_t>> aabbPairs; //maps rigid body indices to their AABBs potential collision pairs
+		//build grid. every vector here keeps its capacity between steps so the broadphase doesn't allocate once warmed up
+		float gridCellSize = 1.f;
+		std::vector<CellEntry> grid; //(cell key, collider) entries of awake colliders radix sorted by key, so each cell is a contiguous run
+		std::vector<CellEntry> restingGrid; //same for resting colliders, only rebuilt when restingDirty
+		std::vector<CellEntry> gridScratch; //radix sort ping-pong buffer
+		std::vector<uint32_t> oversizedColliders; //awake colliders too big for the grid
+		std::vector<uint32_t> restingOversized; //resting colliders too big for the grid, e.g. the ground box
+		std::vector<uint8_t> oversizedFlags; //per collider, 1 if it is in oversizedColliders or restingOversized
+		std::vector<float> extentScratch; //for the median extent
+
+		//AABB tree broadphase. static colliders go in their own tree once and are never touched again
+		AABBTree staticTree;
+		AABBTree dynamicTree;
+		std::vector<int32_t> colliderProxies; //tree leaf of each collider
+		std::vector<uint8_t> colliderInStaticTree;
+		bool treeDirty = false; //set when a body changes mass so syncTreeProxies revisits every collider
+		std::vector<AABB> colliderAABBs; //world AABB of each collider. rebuilt every step by the grid, only for moving colliders by the tree
+		std::vector<std::pair<uint32_t, uint32_t>> aabbPairs; //unique potential collision pairs of collider indices, lower index first
+		bool queryIndexStale = true; //colliders were added or removed after the last broadphase
+
+		//query scratch, see queryMargin
+		mutable float cachedQueryMargin = 0.f;
+		mutable bool queryMarginDirty = true;
+		mutable std::vector<uint32_t> queryCandidates;
+		mutable std::vector<uint32_t> queryBodies;
+		mutable std::vector<std::vector<uint32_t>> queryChunkCandidates; //per raycastBatch job
 	};
 }
 /*
@@ -157,11 +837,11 @@ aabbPairs:
 	6: (4,5)
 
 
-grid:
-	CellKey1: [0, 1]
-	CellKey2: [0, 2]
-	CellKey3: [1, 2]
-	CellKey4: [2, 3]
-	CellKey5: [3, 4]
-	CellKey6: [4, 5]
+grid (sorted by key):
+	{CellKey1, 0}, {CellKey1, 1}
+	{CellKey2, 0}, {CellKey2, 2}
+	{CellKey3, 1}, {CellKey3, 2}
+	{CellKey4, 2}, {CellKey4, 3}
+	{CellKey5, 3}, {CellKey5, 4}
+	{CellKey6, 4}, {CellKey6, 5}
 */
\ No newline at end of file
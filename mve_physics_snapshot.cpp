@@ -0,0 +1,132 @@
+#include "mve_physics_snapshot.h"
+
+#include <algorithm>
+
+namespace mve {
+	//delta layout: target size, base size and base hash, then pairs of (zero run, literal run) as varints with the literal
+	//bytes (target XOR base) after each pair, until the target size is covered
+
+	//FNV-1a, only to catch a delta applied to the wrong base
+	static uint64_t hashBytes(const uint8_t* data, size_t size) {
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	static bool readVarint(const std::vector<uint8_t>& in, size_t& offset, uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (offset >= in.size()) return false;
+			uint8_t byte = in[offset++];
+			value |= uint64_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+
+	void PhysicsSnapshot::encodeDelta(const PhysicsSnapshot& base, std::vector<uint8_t>& delta) const {
+		delta.clear();
+		writeVarint(delta, bytes.size());
+		writeVarint(delta, base.bytes.size());
+		uint64_t hash = hashBytes(base.bytes.data(), base.bytes.size());
+		for (int i = 0; i < 8; i++) delta.push_back(static_cast<uint8_t>(hash >> (i * 8)));
+
+		//past the end of base counts as zeros, so a grown snapshot stores its tail as literals
+		auto diff = [&](size_t i) { return static_cast<uint8_t>(bytes[i] ^ (i < base.bytes.size() ? base.bytes[i] : 0)); };
+		size_t i = 0;
+		const size_t size = bytes.size();
+		while (i < size) {
+			size_t zeros = i;
+			while (zeros < size && diff(zeros) == 0) zeros++;
+			//a literal run ends at the first stretch of zeros long enough to be worth a new pair
+			size_t literals = zeros;
+			while (literals < size) {
+				if (diff(literals) != 0) {
+					literals++;
+					continue;
+				}
+				size_t run = literals;
+				while (run < size && run - literals < 4 && diff(run) == 0) run++;
+				if (run - literals >= 4 || run == size) break;
+				literals = run;
+			}
+			writeVarint(delta, zeros - i);
+			writeVarint(delta, literals - zeros);
+			for (size_t k = zeros; k < literals; k++) delta.push_back(diff(k));
+			i = literals;
+		}
+	}
+
+	bool PhysicsSnapshot::decodeDelta(const PhysicsSnapshot& base, const std::vector<uint8_t>& delta) {
+		size_t offset = 0;
+		uint64_t size = 0, baseSize = 0;
+		if (!readVarint(delta, offset, size) || !readVarint(delta, offset, baseSize)) return false;
+		if (baseSize != base.bytes.size() || delta.size() - offset < 8) return false;
+		uint64_t hash = 0;
+		for (int i = 0; i < 8; i++) hash |= uint64_t(delta[offset++]) << (i * 8);
+		if (hash != hashBytes(base.bytes.data(), base.bytes.size())) return false;
+
+		bytes.resize(size);
+		//unchanged bytes come straight from base
+		size_t shared = std::min<size_t>(size, base.bytes.size());
+		if (shared > 0) std::memcpy(bytes.data(), base.bytes.data(), shared);
+		if (size > shared) std::memset(bytes.data() + shared, 0, size - shared);
+
+		size_t i = 0;
+		while (i < size) {
+			uint64_t zeros = 0, literals = 0;
+			if (!readVarint(delta, offset, zeros) || !readVarint(delta, offset, literals)) return false;
+			if (zeros > size - i || literals > size - i - zeros || literals > delta.size() - offset) return false;
+			i += zeros;
+			for (uint64_t k = 0; k < literals; k++) bytes[i++] ^= delta[offset++];
+		}
+		return offset == delta.size();
+	}
+
+	PhysicsHistory::PhysicsHistory(uint32_t capacity) : deltas(std::max(capacity, 2u) - 1) {}
+
+	void PhysicsHistory::push(const PhysicsSnapshot& snapshot) {
+		if (!newest.empty()) {
+			//the old newest frame becomes a delta against the new one, the oldest delta is overwritten once the ring is full
+			head = (head + static_cast<uint32_t>(deltas.size()) - 1) % static_cast<uint32_t>(deltas.size());
+			newest.encodeDelta(snapshot, deltas[head]);
+			deltaCount = std::min(deltaCount + 1, static_cast<uint32_t>(deltas.size()));
+		}
+		newest = snapshot;
+	}
+
+	bool PhysicsHistory::get(uint32_t framesBack, PhysicsSnapshot& out) {
+		if (framesBack >= size()) return false;
+		out = newest;
+		for (uint32_t k = 0; k < framesBack; k++) {
+			//each delta was made against the frame after it, which is what out holds at this point
+			const std::vector<uint8_t>& delta = deltas[(head + k) % deltas.size()];
+			std::swap(scratch, out);
+			if (!out.decodeDelta(scratch, delta)) return false;
+		}
+		return true;
+	}
+
+	void PhysicsHistory::clear() {
+		newest.clear();
+		head = 0;
+		deltaCount = 0;
+	}
+
+	size_t PhysicsHistory::memoryUsed() const {
+		size_t total = newest.size();
+		for (uint32_t k = 0; k < deltaCount; k++) total += deltas[(head + k) % deltas.size()].size();
+		return total;
+	}
+}
@@ -0,0 +1,110 @@
+//binary snapshots of the physics state for rollback and what-if simulation, see PhysicsClass::saveSnapshot.
+//a snapshot is the flat arrays of the simulation copied back to back, so saving and restoring is a handful of memcpys
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace mve {
+	class PhysicsSnapshot {
+	public:
+		const uint8_t* data() const { return bytes.data(); }
+		size_t size() const { return bytes.size(); }
+		bool empty() const { return bytes.empty(); }
+		//keeps the capacity, saving into the same snapshot every frame stops allocating once it has grown to fit
+		void clear() { bytes.clear(); }
+
+		//XOR of this snapshot with base, runs of zero bytes (anything that didn't change) stored as a count.
+		//sleeping and static bodies sit at the end of every stream, so most of a settled scene shrinks to a few bytes
+		void encodeDelta(const PhysicsSnapshot& base, std::vector<uint8_t>& delta) const;
+		//turns this into the snapshot the delta was encoded from, base has to be another snapshot.
+		//false if the delta is damaged or was made against another base
+		bool decodeDelta(const PhysicsSnapshot& base, const std::vector<uint8_t>& delta);
+
+		//writing and reading, used by PhysicsClass
+		template<typename T>
+		void write(const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "snapshots only hold flat data");
+			size_t at = bytes.size();
+			bytes.resize(at + sizeof(T));
+			std::memcpy(bytes.data() + at, &value, sizeof(T));
+		}
+		template<typename T>
+		void write(const std::vector<T>& values) {
+			static_assert(std::is_trivially_copyable_v<T>, "snapshots only hold flat data");
+			write(static_cast<uint32_t>(values.size()));
+			size_t at = bytes.size();
+			bytes.resize(at + values.size() * sizeof(T));
+			if (!values.empty()) std::memcpy(bytes.data() + at, values.data(), values.size() * sizeof(T));
+		}
+
+		class Reader {
+		public:
+			//a dry run only walks the sizes and writes nothing, to check a snapshot before overwriting anything with it
+			explicit Reader(const PhysicsSnapshot& snapshot, bool dryRun = false) : snapshot{ snapshot }, dryRun{ dryRun } {}
+
+			//reads nothing once the snapshot ran out, check ok() at the end
+			template<typename T>
+			void read(T& value) {
+				if (!take(sizeof(T)) || dryRun) return;
+				std::memcpy(&value, snapshot.bytes.data() + offset - sizeof(T), sizeof(T));
+			}
+			//resize only allocates when the array grew past its capacity
+			template<typename T>
+			void read(std::vector<T>& values) {
+				uint32_t count = 0;
+				if (!take(sizeof(count))) return;
+				std::memcpy(&count, snapshot.bytes.data() + offset - sizeof(count), sizeof(count));
+				if (!take(size_t(count) * sizeof(T)) || dryRun) return;
+				values.resize(count);
+				if (count > 0) std::memcpy(values.data(), snapshot.bytes.data() + offset - count * sizeof(T), count * sizeof(T));
+			}
+			bool ok() const { return !failed && offset == snapshot.bytes.size(); }
+
+		private:
+			bool take(size_t count) {
+				if (failed || snapshot.bytes.size() - offset < count) {
+					failed = true;
+					return false;
+				}
+				offset += count;
+				return true;
+			}
+
+			const PhysicsSnapshot& snapshot;
+			bool dryRun;
+			size_t offset = 0;
+			bool failed = false;
+		};
+
+	private:
+		std::vector<uint8_t> bytes;
+	};
+
+	//the last few frames for rolling back. the newest frame is kept whole, each older one as a delta against the frame after it,
+	//so the memory is one snapshot plus what actually changed per frame
+	class PhysicsHistory {
+	public:
+		explicit PhysicsHistory(uint32_t capacity = 16);
+
+		//the frame just saved, it becomes get(0)
+		void push(const PhysicsSnapshot& snapshot);
+		//framesBack = 0 is the newest frame. false if the history doesn't go back that far
+		bool get(uint32_t framesBack, PhysicsSnapshot& out);
+		//how many frames get can reach
+		uint32_t size() const { return newest.empty() ? 0 : deltaCount + 1; }
+		void clear();
+		//bytes held by the frames, without unused capacity
+		size_t memoryUsed() const;
+
+	private:
+		PhysicsSnapshot newest;
+		std::vector<std::vector<uint8_t>> deltas; //ring, deltas[head] is the delta of the frame before newest
+		uint32_t head = 0;
+		uint32_t deltaCount = 0;
+		PhysicsSnapshot scratch;
+	};
+}
@@ -0,0 +1,113 @@
+#include "mve_physics_thread.h"
+
+#include <algorithm>
+
+namespace mve {
+	//sleep_until can overshoot by a whole scheduler tick (around 15 ms on windows), which is most of a 60 Hz step.
+	//sleep until this much before the step is due and yield for the rest
+	static constexpr std::chrono::microseconds spinMargin{ 2000 };
+
+	PhysicsThread::PhysicsThread(PhysicsClass& physics, uint32_t commandCapacity) : physics{ physics } {
+		uint32_t capacity = 1;
+		while (capacity < commandCapacity) capacity <<= 1;
+		commands.resize(capacity);
+		commandMask = capacity - 1;
+	}
+
+	PhysicsThread::~PhysicsThread() {
+		stop();
+	}
+
+	void PhysicsThread::start() {
+		if (thread.joinable()) return;
+		quit.store(false, std::memory_order_relaxed);
+		thread = std::thread([this] { run(); });
+	}
+
+	void PhysicsThread::stop() {
+		if (!thread.joinable()) return;
+		quit.store(true, std::memory_order_relaxed);
+		thread.join();
+	}
+
+	bool PhysicsThread::push(const Command& command) {
+		uint32_t tail = commandTail.load(std::memory_order_relaxed);
+		if (tail - commandHead.load(std::memory_order_acquire) > commandMask) return false;
+		commands[tail & commandMask] = command;
+		//release so the physics thread sees the command written before the new tail
+		commandTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	void PhysicsThread::applyCommands() {
+		uint32_t head = commandHead.load(std::memory_order_relaxed);
+		const uint32_t tail = commandTail.load(std::memory_order_acquire);
+		for (; head != tail; head++) {
+			const Command& command = commands[head & commandMask];
+			BodyHandle handle = physics.isValid(command.handle) ? command.handle : physics.getHandle(command.objId);
+			switch (command.type) {
+			case Command::Type::ApplyForce: physics.applyForce(handle, command.value); break;
+			case Command::Type::SetSpeed: physics.setSpeed(handle, command.value); break;
+			}
+		}
+		//the slots can be reused once the commands are applied
+		commandHead.store(head, std::memory_order_release);
+	}
+
+	void PhysicsThread::publish(Clock::time_point stepTime) {
+		Frame& frame = frames[back];
+		physics.writeTransforms(frame.transforms);
+		frame.stats = physics.getStats();
+		frame.stepTime = stepTime;
+		//acq_rel: release the frame just written, acquire whatever the render thread left in the frame we get back
+		back = middle.exchange(back | freshFrame, std::memory_order_acq_rel) & ~freshFrame;
+		stepCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void PhysicsThread::run() {
+		const PhysicsSettings& settings = physics.getSettings();
+		const auto dt = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(settings.fixedTimeStep));
+		Clock::time_point due = Clock::now() + dt;
+
+		while (!quit.load(std::memory_order_relaxed)) {
+			Clock::time_point now = Clock::now();
+			if (now + spinMargin < due) {
+				std::this_thread::sleep_until(due - spinMargin);
+				continue;
+			}
+			if (now < due) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			applyCommands();
+			//update with exactly one step of time takes exactly one step, it keeps previousPose current for writeTransforms
+			uint32_t steps = 0;
+			while (due <= now && steps < settings.maxSubSteps) {
+				physics.update(settings.fixedTimeStep);
+				due += dt;
+				steps++;
+			}
+			//same as update: out of substeps, drop the backlog instead of trying to catch up (spiral of death)
+			if (due <= now) due = now + dt;
+			publish(due - dt);
+		}
+	}
+
+	void PhysicsThread::syncTransforms(MveGameObject::Map& objects) {
+		if (middle.load(std::memory_order_relaxed) & freshFrame) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & ~freshFrame;
+		}
+		const Frame& frame = frames[front];
+		if (frame.transforms.empty()) return;
+
+		const float dt = physics.getSettings().fixedTimeStep;
+		float alpha = std::chrono::duration<float>(Clock::now() - frame.stepTime).count() / dt;
+		alpha = std::clamp(alpha, 0.f, 1.f);
+		for (const BodyTransform& body : frame.transforms) {
+			auto it = objects.find(body.objId);
+			if (it == objects.end()) continue;
+			PhysicsClass::blendPose(body.previous, body.current, alpha, it->second.transform);
+		}
+	}
+}
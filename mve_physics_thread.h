@@ -0,0 +1,88 @@
+//runs a PhysicsClass on its own thread at the fixed time step, so stepping no longer adds to the frame time of the render loop.
+//the render thread talks to it through a lock-free command queue and reads the results from a lock-free triple buffer
+
+#pragma once
+
+#include "mve_physics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace mve {
+	class PhysicsThread {
+	public:
+		//commandCapacity is rounded up to a power of two. physics has to outlive this
+		explicit PhysicsThread(PhysicsClass& physics, uint32_t commandCapacity = 1024);
+		~PhysicsThread();
+
+		PhysicsThread(const PhysicsThread&) = delete;
+		PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+		//between start and stop physics belongs to the physics thread, only touch it through the calls below.
+		//add and remove bodies while stopped
+		void start();
+		//waits for the step in progress, commands still queued are applied by the next start
+		void stop();
+		bool isRunning() const { return thread.joinable(); }
+
+		//commands are applied in order before the next step. one producer only, normally the render thread.
+		//false if the queue is full, which means the physics thread fell behind by more than commandCapacity commands
+		bool applyForce(BodyHandle handle, const glm::vec3& force) { return push({ Command::Type::ApplyForce, -1, handle, force }); }
+		bool applyForce(int objId, const glm::vec3& force) { return push({ Command::Type::ApplyForce, objId, BodyHandle{}, force }); }
+		bool setSpeed(BodyHandle handle, const glm::vec3& speed) { return push({ Command::Type::SetSpeed, -1, handle, speed }); }
+		bool setSpeed(int objId, const glm::vec3& speed) { return push({ Command::Type::SetSpeed, objId, BodyHandle{}, speed }); }
+
+		//render thread only. takes the newest published step and writes every dynamic body blended between its last two poses
+		//by how far the clock is into the step after it, so the picture runs one step behind the simulation
+		void syncTransforms(MveGameObject::Map& objects);
+		//stats of the step syncTransforms last picked up
+		const PhysicsStats& getStats() const { return frames[front].stats; }
+		//steps taken since construction, readable from any thread
+		uint64_t getStepCount() const { return stepCount.load(std::memory_order_relaxed); }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Command {
+			enum class Type : uint8_t { ApplyForce, SetSpeed };
+			Type type;
+			int objId; //used when handle is invalid, looked up on the physics thread since the handle map isn't safe to read from here
+			BodyHandle handle;
+			glm::vec3 value;
+		};
+
+		//one published step
+		struct Frame {
+			std::vector<BodyTransform> transforms;
+			PhysicsStats stats;
+			Clock::time_point stepTime{}; //when the step was due, the blend towards current starts here
+		};
+
+		bool push(const Command& command);
+		void applyCommands();
+		void publish(Clock::time_point stepTime);
+		void run();
+
+		PhysicsClass& physics;
+		std::thread thread;
+		std::atomic<bool> quit{ false };
+		std::atomic<uint64_t> stepCount{ 0 };
+
+		//single producer single consumer ring, head and tail only ever grow and wrap through the mask
+		std::vector<Command> commands;
+		uint32_t commandMask;
+		alignas(64) std::atomic<uint32_t> commandHead{ 0 }; //next command to apply, written by the physics thread
+		alignas(64) std::atomic<uint32_t> commandTail{ 0 }; //next free slot, written by the producer
+
+		//triple buffer: the physics thread fills frames[back], then swaps it with the middle frame. the render thread swaps
+		//front with the middle frame when freshFrame says it holds a step it hasn't seen. nobody waits on anybody
+		static constexpr uint32_t freshFrame = 4;
+		Frame frames[3];
+		uint32_t back = 0; //physics thread only
+		uint32_t front = 2; //render thread only
+		alignas(64) std::atomic<uint32_t> middle{ 1 };
+	};
+}
@@ -0,0 +1,120 @@
+//thin wrappers over SSE/AVX float registers so a kernel can be written once as a template and compiled for 8, 4 or 1 lanes.
+//the widest type is picked at compile time: MSVC defines __AVX__ under /arch:AVX and /arch:AVX2, x64 always has SSE2
+
+#pragma once
+
+#if defined(__AVX__)
+#define MVE_PHYSICS_AVX 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MVE_PHYSICS_SSE 1
+#endif
+
+#if defined(MVE_PHYSICS_AVX) || defined(MVE_PHYSICS_SSE)
+#include <immintrin.h>
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace mve {
+	namespace simd {
+		//comparisons return a mask in the same type (all bits set for true lanes) like the intrinsics do
+
+		struct Float1 {
+			static constexpr int width = 1;
+			float v;
+
+			static Float1 load(const float* p) { return { *p }; }
+			static Float1 set1(float x) { return { x }; }
+			void store(float* p) const { *p = v; }
+
+			friend Float1 operator+(Float1 a, Float1 b) { return { a.v + b.v }; }
+			friend Float1 operator-(Float1 a, Float1 b) { return { a.v - b.v }; }
+			friend Float1 operator*(Float1 a, Float1 b) { return { a.v * b.v }; }
+			friend Float1 operator/(Float1 a, Float1 b) { return { a.v / b.v }; }
+
+			static Float1 fromBits(uint32_t bits) { Float1 r; std::memcpy(&r.v, &bits, 4); return r; }
+			uint32_t bits() const { uint32_t b; std::memcpy(&b, &v, 4); return b; }
+			static Float1 mask(bool m) { return fromBits(m ? 0xFFFFFFFFu : 0u); }
+
+			friend Float1 operator&(Float1 a, Float1 b) { return fromBits(a.bits() & b.bits()); }
+			friend Float1 operator|(Float1 a, Float1 b) { return fromBits(a.bits() | b.bits()); }
+			friend Float1 abs(Float1 a) { return { std::fabs(a.v) }; }
+			friend Float1 sqrt(Float1 a) { return { std::sqrt(a.v) }; }
+			friend Float1 min(Float1 a, Float1 b) { return { b.v < a.v ? b.v : a.v }; }
+			friend Float1 max(Float1 a, Float1 b) { return { b.v > a.v ? b.v : a.v }; }
+			friend Float1 cmplt(Float1 a, Float1 b) { return mask(a.v < b.v); }
+			friend Float1 cmpgt(Float1 a, Float1 b) { return mask(a.v > b.v); }
+			friend Float1 cmple(Float1 a, Float1 b) { return mask(a.v <= b.v); }
+			//mask ? a : b
+			friend Float1 select(Float1 m, Float1 a, Float1 b) { return m.bits() ? a : b; }
+			friend int movemask(Float1 m) { return static_cast<int>(m.bits() >> 31); }
+		};
+
+#if defined(MVE_PHYSICS_SSE)
+		struct Float4 {
+			static constexpr int width = 4;
+			__m128 v;
+
+			static Float4 load(const float* p) { return { _mm_loadu_ps(p) }; }
+			static Float4 set1(float x) { return { _mm_set1_ps(x) }; }
+			void store(float* p) const { _mm_storeu_ps(p, v); }
+
+			friend Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+			friend Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+			friend Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+			friend Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+			friend Float4 operator&(Float4 a, Float4 b) { return { _mm_and_ps(a.v, b.v) }; }
+			friend Float4 operator|(Float4 a, Float4 b) { return { _mm_or_ps(a.v, b.v) }; }
+			//clearing the sign bit
+			friend Float4 abs(Float4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.f), a.v) }; }
+			friend Float4 sqrt(Float4 a) { return { _mm_sqrt_ps(a.v) }; }
+			friend Float4 min(Float4 a, Float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+			friend Float4 max(Float4 a, Float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+			friend Float4 cmplt(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+			friend Float4 cmpgt(Float4 a, Float4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+			friend Float4 cmple(Float4 a, Float4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+			friend Float4 select(Float4 m, Float4 a, Float4 b) { return { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) }; }
+			friend int movemask(Float4 m) { return _mm_movemask_ps(m.v); }
+		};
+#endif
+
+#if defined(MVE_PHYSICS_AVX)
+		struct Float8 {
+			static constexpr int width = 8;
+			__m256 v;
+
+			static Float8 load(const float* p) { return { _mm256_loadu_ps(p) }; }
+			static Float8 set1(float x) { return { _mm256_set1_ps(x) }; }
+			void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+			friend Float8 operator+(Float8 a, Float8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+			friend Float8 operator-(Float8 a, Float8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+			friend Float8 operator*(Float8 a, Float8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+			friend Float8 operator/(Float8 a, Float8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+			friend Float8 operator&(Float8 a, Float8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+			friend Float8 operator|(Float8 a, Float8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+			friend Float8 abs(Float8 a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v) }; }
+			friend Float8 sqrt(Float8 a) { return { _mm256_sqrt_ps(a.v) }; }
+			friend Float8 min(Float8 a, Float8 b) { return { _mm256_min_ps(a.v, b.v) }; }
+			friend Float8 max(Float8 a, Float8 b) { return { _mm256_max_ps(a.v, b.v) }; }
+			friend Float8 cmplt(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+			friend Float8 cmpgt(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+			friend Float8 cmple(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+			friend Float8 select(Float8 m, Float8 a, Float8 b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+			friend int movemask(Float8 m) { return _mm256_movemask_ps(m.v); }
+		};
+#endif
+
+		//widest register the build supports
+#if defined(MVE_PHYSICS_AVX)
+		using FloatN = Float8;
+#elif defined(MVE_PHYSICS_SSE)
+		using FloatN = Float4;
+#else
+		using FloatN = Float1;
+#endif
+	}
+}